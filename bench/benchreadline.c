@@ -0,0 +1,97 @@
+/*
+ * bench/benchreadline.c - tab completion latency benchmark
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "../src/readline.h"
+#include <stdio.h>
+#include <time.h>
+
+/* synthetic symbols and completions timed per run */
+#define BENCH_SYMS	200000
+#define BENCH_TABS	200
+
+extern struct id_list comp_list;
+
+/* prefixes typed before hitting tab */
+static char const *const prefixes[] = {"s", "str", "mem", "pthread_mutex_", "zz"};
+
+/*
+ * the linear `generator()` used before completions were indexed,
+ * kept verbatim as the baseline
+ */
+static char *legacy_generator(char const *text, int state)
+{
+	static size_t list_index, len;
+	char *name, *buf;
+	if (!state) {
+		list_index = 0;
+		len = strlen(text);
+	}
+	for (;;) {
+		if (list_index >= comp_list.cnt)
+			break;
+		name = pool_str(&str_pool, comp_list.list[list_index++]);
+		if (strncmp(name, text, len) == 0) {
+			if (!(buf = calloc(1, strlen(name) + 1))) {
+				WARN("%s", "error allocating generator string");
+				return NULL;
+			}
+			strmv(0, buf, name);
+			return buf;
+		}
+	}
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* return mean seconds per tab, storing the match count in `found` */
+static double run(char *(*gen)(char const *, int), char const *prefix, size_t *found)
+{
+	double beg = now();
+	for (size_t i = 0; i < BENCH_TABS; i++) {
+		char *match;
+		for (*found = 0; (match = gen(prefix, *found)); ++*found)
+			free(match);
+	}
+	return (now() - beg) / BENCH_TABS;
+}
+
+int main(void)
+{
+	static char const *const stems[] = {"str", "mem", "pthread_mutex_", "sig", "__builtin_", "f", "x", "_IO_"};
+	char name[0x40];
+	size_t found[2];
+
+	/* shuffled names with a share of duplicates, like libc and header symbols */
+	srand(1);
+	for (size_t i = 0; i < BENCH_SYMS; i++) {
+		snprintf(name, sizeof name, "%s%x", stems[rand() % ARR_LEN(stems)], (unsigned)rand() % (BENCH_SYMS * 3 / 4));
+		push_id_list(&comp_list, intern_str(&str_pool, name));
+	}
+	double beg = now();
+	index_comps(&comp_list);
+	printf("[%d symbols, %zu unique, indexed in %.3f ms]\n", BENCH_SYMS, comp_list.cnt, (now() - beg) * 1e3);
+
+	for (size_t i = 0; i < ARR_LEN(prefixes); i++) {
+		double secs[2] = {
+			run(legacy_generator, prefixes[i], &found[0]),
+			run(generator, prefixes[i], &found[1]),
+		};
+		printf("%-16s linear %9.3f ms  indexed %9.3f ms  (%zu/%zu matches)  %.1fx\n",
+				prefixes[i], secs[0] * 1e3, secs[1] * 1e3, found[0], found[1], secs[0] / secs[1]);
+	}
+
+	free_id_list(&comp_list);
+	free_pool(&str_pool);
+
+	return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * bench/benchscan.c - microbenchmark for scan.h kernels
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "../src/defs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* size of the simulated paste */
+#define BENCH_SIZE	(0x20 * 0x100000)
+/* passes over the buffer per kernel */
+#define BENCH_REPS	8
+
+/* statements typical of a large paste into the repl */
+static char const *const snippets[] = {
+	"int foo = 5, *bar = &foo;",
+	"char const *str = \"hello; world {}\";",
+	"for (size_t i = 0; i < sizeof arr / sizeof *arr; i++) { total += arr[i] * scale; }",
+	"struct point { double x, y; } origin = {0}, unit = {.x = 1.0, .y = 1.0};",
+	"printf(\"%s: %d\\n\", __func__, (int)strlen(str));",
+	"unsigned long long mask = (1ULL << shift) - 1;",
+	"if (ptr && *ptr == '\\n') { ptr++; continue; }",
+	"double res = sqrt(origin.x * origin.x + unit.y * unit.y) / 1000.0;",
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* walk the whole buffer the way `strsplit()` does and count stops */
+static double run_kernel(scan_fn *kernel, char const *buf, size_t len, size_t *stops)
+{
+	double beg = now();
+	for (size_t rep = 0; rep < BENCH_REPS; rep++) {
+		*stops = 0;
+		for (size_t i = 0; (i += kernel(buf + i, len - i)) < len; i++)
+			(*stops)++;
+	}
+	return (now() - beg) / BENCH_REPS;
+}
+
+static void report(char const *name, double secs, double base, size_t len, size_t stops)
+{
+	printf("%-10s %9.3f ms %9.1f MiB/s %7.2fx  (%zu stops)\n",
+			name, secs * 1e3, len / secs / 0x100000, base / secs, stops);
+}
+
+int main(void)
+{
+	char *buf;
+	size_t len = 0, stops;
+
+	/* build a large pasted input */
+	xmalloc(char, &buf, BENCH_SIZE + 1, "main()");
+	for (size_t i = 0; len < BENCH_SIZE - 0x100; i++) {
+		char const *snip = snippets[i % (sizeof snippets / sizeof *snippets)];
+		size_t sz = strlen(snip);
+		memcpy(buf + len, snip, sz);
+		len += sz;
+		buf[len++] = (i % 4 == 3) ? '\n' : ' ';
+	}
+	buf[len] = 0;
+	printf("[scanning %zu bytes, %d passes]\n", len, BENCH_REPS);
+
+	double base = run_kernel(scan_split_scalar, buf, len, &stops);
+	report("scalar", base, base, len, stops);
+#if defined(SCAN_SIMD)
+	double secs = run_kernel(scan_split_sse2, buf, len, &stops);
+	report("sse2", secs, base, len, stops);
+	if (__builtin_cpu_supports("avx2")) {
+		secs = run_kernel(scan_split_avx2, buf, len, &stops);
+		report("avx2", secs, base, len, stops);
+	}
+	printf("[dispatching to %s]\n", (scan_split_kernel() == scan_split_avx2) ? "avx2" : "sse2");
+#endif
+
+	/* end-to-end splitter using the dispatched kernel */
+	struct span_list spans;
+	double beg = now();
+	for (size_t rep = 0; rep < BENCH_REPS; rep++) {
+		strsplit(&spans, buf);
+		if (rep < BENCH_REPS - 1)
+			free_span_list(&spans);
+	}
+	double split = (now() - beg) / BENCH_REPS;
+	printf("%-10s %9.3f ms %9.1f MiB/s  (%zu statements)\n",
+			"strsplit", split * 1e3, len / split / 0x100000, spans.cnt);
+	free_span_list(&spans);
+	free(buf);
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * bench/benchsearch.c - history search latency benchmark
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "../src/search.h"
+#include <stdio.h>
+#include <time.h>
+
+/* synthetic history lines and searches timed per run */
+#define BENCH_LINES	100000
+#define BENCH_RUNS	50
+
+/* queries typed after `;hist` */
+static char const *const queries[] = {"printf", "memcpy(dst", "v4242", "for (", "zzz"};
+
+/* the linear scan over every line the index replaces, kept as the baseline */
+static size_t legacy_search(struct hist_search *search, char const *query)
+{
+	size_t found = 0;
+	for (size_t i = 0; i < search->lines.cnt; i++)
+		found += !!strstr(pool_str(&search->text, search->lines.list[i].id), query);
+	return found;
+}
+
+static size_t indexed_search(struct hist_search *search, char const *query)
+{
+	struct search_line_list found;
+	size_t cnt = search_hist(search, query, false, SEARCH_SHOWN, &found);
+	free_search_line_list(&found);
+	return cnt;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* return mean seconds per search, storing the match count in `found` */
+static double run(size_t (*find)(struct hist_search *, char const *), struct hist_search *search,
+		char const *query, size_t *found)
+{
+	double beg = now();
+	for (size_t i = 0; i < BENCH_RUNS; i++)
+		*found = find(search, query);
+	return (now() - beg) / BENCH_RUNS;
+}
+
+int main(void)
+{
+	static char const *const fmts[] = {
+		"printf(\"%%d\\n\", v%u);", "int v%u = %u;", "memcpy(dst + %u, src, %u);",
+		"for (int i = 0; i < %u; i++) sum += v%u;", "puts(\"%u\");", "v%u *= %u;",
+	};
+	struct hist_search search = {0};
+	char line[0x80];
+	size_t found[2];
+
+	/* shuffled lines like a long-lived history */
+	srand(1);
+	double beg = now();
+	for (size_t i = 0; i < BENCH_LINES; i++) {
+		unsigned a = rand() % BENCH_LINES, b = rand() % 0x1000;
+		snprintf(line, sizeof line, fmts[rand() % ARR_LEN(fmts)], a, b);
+		add_search_line(&search, line);
+	}
+	post_search_lines(&search);
+	printf("[%d lines, %zu unique, %zu trigrams, indexed in %.3f ms]\n", BENCH_LINES, search.lines.cnt,
+			search.tris.cnt, (now() - beg) * 1e3);
+
+	for (size_t i = 0; i < ARR_LEN(queries); i++) {
+		double secs[2] = {
+			run(legacy_search, &search, queries[i], &found[0]),
+			run(indexed_search, &search, queries[i], &found[1]),
+		};
+		printf("%-16s linear %9.3f ms  indexed %9.3f ms  (%zu matches, newest %zu)  %.1fx\n",
+				queries[i], secs[0] * 1e3, secs[1] * 1e3, found[0], found[1], secs[0] / secs[1]);
+	}
+
+	free_hist_search(&search);
+
+	return 0;
+}
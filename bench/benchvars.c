@@ -0,0 +1,378 @@
+/*
+ * bench/benchvars.c - declaration scanner throughput benchmark
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "../src/vars.h"
+#include <regex.h>
+#include <time.h>
+
+/* lines scanned per scanner (the regex path is far slower) */
+#define BENCH_LINES	20000
+#define REGEX_LINES	20
+
+/* globals normally provided by the other modules */
+struct str_list ld_list = {0};
+struct str_pool str_pool;
+char const *prog_end = "\n\treturn 0;\n}\n";
+
+/* declarations from t/testvars.c */
+static char const src[] =
+	"unsigned long long a = 5;"
+	"int b[];"
+	"int c = 0, d = 0, *e = &c, *f = &d;"
+	"char wark[] = \"wark\", *ptr = wark;"
+	"long foo = 1, bar = 456;"
+	"short baz = 50; int *quix = &baz;"
+	"double res = foo + (double)bar / 1000;"
+	"ssize_t boop = -5; wchar_t florp = L'x';"
+	"int plonk[5] = {1,2,3,4,5}, vroom[5] = {0};"
+	"struct foo { int boop; } kabonk = {0}, *klakow = &kabonk;";
+
+/*
+ * the regex scanner `find_vars()` used before the declaration parser,
+ * kept verbatim as the baseline
+ */
+
+static enum var_type legacy_extract_type(char const *restrict ln, size_t len, char const *restrict id)
+{
+	regex_t reg;
+	regmatch_t matches[7];
+	/* return early if passed NULL pointers */
+	if (!ln || !id)
+		ERRX("%s", "NULL pointer passed to legacy_extract_type()");
+
+	/* strip parentheses */
+	for (char *lparens = strchr(id, '('); lparens; (lparens = strchr(id, '(')))
+		*lparens = '.';
+	for (char *rparens = strchr(id, ')'); rparens; (rparens = strchr(id, ')')))
+		*rparens = '.';
+
+	/* first/third/fourth captures are ignored */
+	char *regex, *type_str;
+	char const beg_regex[] =
+			"(^[[:blank:]]*|[^,;]*[(){};[:blank:]]*)"
+			"(struct[^=]+|struct|union[^=]+|union"
+			"|_?[Bb]ool|[rs]?size_t|u?int[0-9]+_t"
+			"|ptrdiff_t|intptr_t|intmax_t|uintmax_t"
+			"|char|char[0-9]+_t|float|float_t|double"
+			"|wchar_t|int|long|short|unsigned|void)"
+			"[[:blank:]]+([^;]*,[^&,;=]*|[^&;]*)(";
+	char const end_regex[] = ")(\\[*)";
+	size_t regex_sz[2] = {
+		strlen(id) + sizeof beg_regex + sizeof end_regex - 1,
+		0,
+	};
+
+	/* append identifier to regex */
+	xcalloc(char, &regex, 1, regex_sz[0], "legacy_extract_type()");
+	strmv(0, regex, beg_regex);
+	strmv(CONCAT, regex, id);
+	strmv(CONCAT, regex, end_regex);
+
+	if (regcomp(&reg, regex, REG_EXTENDED|REG_NEWLINE))
+		ERR("%s", "failed to compile regex");
+
+	/* only match within the first `len` bytes */
+	matches[0].rm_so = 0;
+	matches[0].rm_eo = len;
+	/* non-zero return or -1 value in rm_so means no captures */
+	if (regexec(&reg, ln, 6, matches, REG_STARTEND) || matches[2].rm_so == -1) {
+		free(regex);
+		regfree(&reg);
+		return T_ERR;
+	}
+
+	/* regex capture offsets */
+	size_t match_sz[2] = {
+		/* from beginning of second capture to end of third capture */
+		matches[3].rm_eo - matches[2].rm_so,
+		/* from beginning of fifth capture to end of fifth capture */
+		matches[5].rm_eo - matches[5].rm_so,
+	};
+	/* sum length of relevant capture lengths */
+	regex_sz[1] = matches[3].rm_eo - matches[2].rm_so + matches[5].rm_eo - matches[5].rm_so + 1;
+
+	/* allocate space for second regex */
+	xcalloc(char, &type_str, 1, regex_sz[1], "legacy_extract_type()");
+	/* copy matched string */
+	memcpy(type_str, ln + matches[2].rm_so, match_sz[0]);
+	memcpy(type_str + match_sz[0], ln + matches[5].rm_so, match_sz[1]);
+	regfree(&reg);
+
+	/* string `char[]` */
+	if (regcomp(&reg, "char[[:blank:]]*[^*\\*]+\\[", REG_EXTENDED|REG_NOSUB))
+		ERR("%s", "failed to compile regex");
+	if (!regexec(&reg, type_str, 1, 0, 0)) {
+		free(regex);
+		free(type_str);
+		regfree(&reg);
+		return T_STR;
+	}
+	regfree(&reg);
+
+	/* string */
+	if (regcomp(&reg, "char[[:blank:]]*(|const)[[:blank:]]*\\*$", REG_EXTENDED|REG_NOSUB))
+		ERR("%s", "failed to compile regex");
+	if (!regexec(&reg, type_str, 1, 0, 0)) {
+		free(regex);
+		free(type_str);
+		regfree(&reg);
+		return T_STR;
+	}
+	regfree(&reg);
+
+	/* struct/union */
+	if (regcomp(&reg, "(struct|union)[^\\*\\[]+", REG_EXTENDED|REG_NOSUB))
+		ERR("%s", "failed to compile regex");
+	if (!regexec(&reg, type_str, 1, 0, 0)) {
+		free(regex);
+		free(type_str);
+		regfree(&reg);
+		return T_OTHER;
+	}
+	regfree(&reg);
+
+	/* pointer */
+	if (regcomp(&reg, "(\\*|\\[)", REG_EXTENDED|REG_NOSUB))
+		ERR("%s", "failed to compile regex");
+	if (!regexec(&reg, type_str, 1, 0, 0)) {
+		free(regex);
+		free(type_str);
+		regfree(&reg);
+		return T_PTR;
+	}
+	regfree(&reg);
+
+	/* char */
+	if (regcomp(&reg, "^char([[:blank:]]+|)$", REG_EXTENDED|REG_NOSUB))
+		ERR("%s", "failed to compile regex");
+	if (!regexec(&reg, type_str, 1, 0, 0)) {
+		free(regex);
+		free(type_str);
+		regfree(&reg);
+		return T_CHR;
+	}
+	regfree(&reg);
+
+	/* double */
+	if (regcomp(&reg, "(float|float_t|double)", REG_EXTENDED|REG_NOSUB))
+		ERR("%s", "failed to compile regex");
+	if (!regexec(&reg, type_str, 1, 0, 0)) {
+		free(regex);
+		free(type_str);
+		regfree(&reg);
+		return T_FLT;
+	}
+	regfree(&reg);
+
+	/* unsigned integral */
+	if (regcomp(&reg, "^(_?[Bb]ool|unsigned|char[0-9]+|wchar|uint|r?size)", REG_EXTENDED|REG_NOSUB))
+		ERR("%s", "failed to compile regex");
+	if (!regexec(&reg, type_str, 1, 0, 0)) {
+		free(regex);
+		free(type_str);
+		regfree(&reg);
+		return T_UINT;
+	}
+	regfree(&reg);
+
+	/* signed integral */
+	if (regcomp(&reg, "(short|int|long|ptrdiff|ssize)", REG_EXTENDED|REG_NOSUB))
+		ERR("%s", "failed to compile regex");
+	if (!regexec(&reg, type_str, 1, 0, 0)) {
+		free(regex);
+		free(type_str);
+		regfree(&reg);
+		return T_INT;
+	}
+	regfree(&reg);
+
+	/* return fallback type */
+	free(regex);
+	free(type_str);
+	return T_OTHER;
+}
+
+static size_t legacy_extract_id(char const *restrict ln, size_t len, size_t *restrict id, size_t *restrict off)
+{
+	regex_t reg;
+	regmatch_t matches[5];
+	/* second capture is ignored */
+	char const initial_regex[] =
+		"^[^,(){};&|=]+[^,({;&|=[:alnum:]_]+"
+		"([[:alpha:]_][[:alnum:]_]*)[[:blank:]]*"
+		"(=[^,(){;'\"_=!<>[:alnum:]]+"
+		"|<>{2}=[^,({;'\"_=!<>[:alnum:]]*|[^=,;]+=)";
+
+	/* return early if passed NULL pointers */
+	if (!ln || !id || !off)
+		ERRX("%s", "NULL pointer passed to legacy_extract_id()");
+
+#ifdef _DEBUG
+	if (len)
+		DPRINTF("extract_id(): \"%.*s\"\n", (int)len, ln);
+#endif
+
+	if (regcomp(&reg, initial_regex, REG_EXTENDED|REG_NEWLINE))
+		ERR("%s", "failed to compile regex");
+	/* only match within the first `len` bytes */
+	matches[0].rm_so = 0;
+	matches[0].rm_eo = len;
+	/* non-zero return or -1 value in rm_so means no captures */
+	if (regexec(&reg, ln, 3, matches, REG_STARTEND) || matches[1].rm_so == -1) {
+		/* fallback branch */
+		regfree(&reg);
+		/* first/second/fourth capture is ignored */
+		char const middle_regex[] =
+			"(^|^[^;,]*;+[[:blank:]]*|^[^=,(){};&|'\"]+)"
+			"(struct[^=]+|struct|union[^=]+|union"
+			"|_?[Bb]ool|[rs]?size_t|u?int[0-9]+_t"
+			"|ptrdiff_t|intptr_t|intmax_t|uintmax_t"
+			"|char|char[0-9]+_t|float|float_t|double"
+			"|wchar_t|int|long|short|unsigned|void)"
+			"[^=,(){};&|'\"[:alpha:]]+[[:blank:]]*\\**[[:blank:]]*"
+			"([[:alpha:]_][[:alnum:]_]*)[[:blank:]]*"
+			"([^=,(){};&|'\"[:alnum:][:blank:]]+$|[^;]*,|$|\\[|,)";
+
+		if (regcomp(&reg, middle_regex, REG_EXTENDED|REG_NEWLINE))
+			ERR("%s", "failed to compile regex");
+		matches[0].rm_so = 0;
+		matches[0].rm_eo = len;
+		if (regexec(&reg, ln, 5, matches, REG_STARTEND) || matches[3].rm_so == -1) {
+			regfree(&reg);
+			/* first/second capture is ignored */
+			char const final_regex[] =
+				"(^[^,;]+\\{[^}]*\\}[^,;]*|[^,(){};|]+)"
+				"(|struct[^=]+|struct|union[^=]+|union"
+				"|_?[Bb]ool|[rs]?size_t|u?int[0-9]+_t"
+				"|ptrdiff_t|intptr_t|intmax_t|uintmax_t"
+				"|char|char[0-9]+_t|float|float_t|double"
+				"|wchar_t|int|long|short|unsigned|void)"
+				",[[:blank:]]*\\**[[:blank:]]*"
+				"([[:alpha:]_][[:alnum:]_]*)";
+
+			if (regcomp(&reg, final_regex, REG_EXTENDED|REG_NEWLINE))
+				ERR("%s", "failed to compile regex");
+			matches[0].rm_so = 0;
+			matches[0].rm_eo = len;
+			if (regexec(&reg, ln, 4, matches, REG_STARTEND) || matches[3].rm_so == -1) {
+				regfree(&reg);
+				return 0;
+			}
+
+			/* intern the identifier, set the output parameter and return the offset */
+			*id = intern_len(&str_pool, ln + matches[3].rm_so, matches[3].rm_eo - matches[3].rm_so);
+			regfree(&reg);
+			*off = matches[3].rm_eo;
+#ifdef _DEBUG
+			DPRINTF("regex [3]: %s\n", pool_str(&str_pool, *id));
+#endif
+			return matches[3].rm_eo;
+		}
+
+		/* intern the identifier, set the output parameter and return the offset */
+		*id = intern_len(&str_pool, ln + matches[3].rm_so, matches[3].rm_eo - matches[3].rm_so);
+		regfree(&reg);
+		*off = matches[3].rm_eo;
+#ifdef _DEBUG
+		DPRINTF("regex [2]: %s\n", pool_str(&str_pool, *id));
+#endif
+		return matches[3].rm_eo;
+	}
+
+	/* intern the identifier, set the output parameter and return the offset */
+	*id = intern_len(&str_pool, ln + matches[1].rm_so, matches[1].rm_eo - matches[1].rm_so);
+	regfree(&reg);
+	*off = matches[1].rm_eo;
+#ifdef _DEBUG
+	DPRINTF("regex [1]: %s\n", pool_str(&str_pool, *id));
+#endif
+	return matches[1].rm_eo;
+}
+
+
+static int legacy_find_vars(struct program *restrict prog, char const *restrict code, size_t len)
+{
+	size_t off, id_tmp;
+	char const *cur = code, *const end = code + len;
+
+	/* sanity checks */
+	if (!prog || !code)
+		return -1;
+
+	/* reuse the previous line's storage */
+	truncate_type_list(&prog->type_list, 0);
+	truncate_id_list(&prog->id_list, 0);
+
+	/* extract all identifiers from the line */
+	size_t count = prog->id_list.cnt;
+	while (cur < end && legacy_extract_id(cur, end - cur, &id_tmp, &off) != 0) {
+		push_id_list(&prog->id_list, id_tmp);
+		cur += off;
+		count++;
+	}
+
+	/* second pass */
+	while (cur < end && (cur = memchr(cur, ';', end - cur))) {
+		for (cur++; cur < end && legacy_extract_id(cur, end - cur, &id_tmp, &off); count++) {
+			push_id_list(&prog->id_list, id_tmp);
+			cur += off;
+		}
+	}
+
+	/* return early if nothing to do */
+	if (!count || prog->id_list.cnt < 1)
+		return 0;
+
+	/* get the type of each identifier */
+	for (size_t i = 0; i < prog->id_list.cnt; i++) {
+		enum var_type type_tmp;
+		type_tmp = legacy_extract_type(code, len, pool_str(&str_pool, prog->id_list.list[i]));
+		push_type_list(&prog->type_list, type_tmp);
+	}
+
+	return count;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* return lines per second */
+static double run(int (*scan)(struct program *, char const *, size_t), size_t lines, struct program *prg, int *found)
+{
+	double beg = now();
+	for (size_t i = 0; i < lines; i++)
+		*found = scan(prg, src, sizeof src - 1);
+	return lines / (now() - beg);
+}
+
+int main(void)
+{
+	struct program prg = {0};
+	int found[2];
+
+	double rate[2] = {
+		run(legacy_find_vars, REGEX_LINES, &prg, &found[0]),
+		run(find_vars, BENCH_LINES, &prg, &found[1]),
+	};
+
+	printf("[scanning a %zu byte line of declarations]\n", sizeof src - 1);
+	printf("%-8s %12.1f lines/s %9.1f KiB/s  (%d names)\n",
+			"regex", rate[0], rate[0] * (sizeof src - 1) / 0x400, found[0]);
+	printf("%-8s %12.1f lines/s %9.1f KiB/s  (%d names)  %.1fx\n",
+			"parser", rate[1], rate[1] * (sizeof src - 1) / 0x400, found[1], rate[1] / rate[0]);
+
+	free_id_list(&prg.id_list);
+	free_type_list(&prg.type_list);
+	free_var_list(&prg.typedef_list);
+	free_pool(&str_pool);
+
+	return 0;
+}
@@ -20,11 +20,13 @@ DEBUG_LDFLAGS = $(LDFLAGS) $(DEBUG)
 MKALL = $(MKCFG) $(DEP)
 OBJ = $(SRC:.c=.o)
 TOBJ = $(TSRC:.c=.o)
-DEP = $(SRC:.c=.d) $(TSRC:.c=.d)
+DEP = $(SRC:.c=.d) $(TSRC:.c=.d) $(BSRC:.c=.d)
 TEST = $(filter-out $(TAP),$(TSRC:.c=))
+BENCH = $(BSRC:.c=)
 UTEST = $(filter-out src/$(TARGET).o,$(SRC:.c=.o))
 SRC := $(wildcard src/*.c)
 TSRC := $(wildcard t/*.c)
+BSRC := $(wildcard bench/*.c)
 HDR := $(wildcard src/*.h) $(wildcard t/*.h)
 ASAN := -fsanitize=address,alignment,leak,undefined
 CPPFLAGS := -D_FORTIFY_SOURCE=2 -D_GNU_SOURCE -MMD -MP
@@ -46,7 +48,7 @@ IGNORES := -Wno-conversion -Wno-cpp -Wno-discarded-qualifiers		\
 		-Wno-sign-conversion -Wno-strict-prototypes		\
 		-Wno-unused-variable -Wno-write-strings
 LDLIBS += -D_GNU_SOURCE -D_DEFAULT_SOURCE
-LDLIBS += -lreadline -lhistory -lelf
+LDLIBS += -lreadline -lhistory -lelf -lm -lpthread
 LDLIBS += $(shell pkg-config ncursesw --cflags --libs || pkg-config ncurses --cflags --libs)
 MKALL += Makefile asan.mk
 DEBUG += -O1 -no-pie -D_DEBUG
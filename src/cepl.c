@@ -10,10 +10,14 @@
 #define _GNU_SOURCE
 
 #include "compile.h"
+#include "dwarf.h"
 #include "errs.h"
 #include "hist.h"
+#include "layout.h"
+#include "lex.h"
 #include "parseopts.h"
 #include "readline.h"
+#include "timeit.h"
 #include "vars.h"
 #include <setjmp.h>
 #include <sys/stat.h>
@@ -32,6 +36,72 @@ static struct program program_state;
 /* string to compile */
 extern char const *prologue, *prog_start, *prog_start_user, *prog_end;
 extern enum asm_type asm_dialect;
+extern struct hdr_index hdr_index;
+extern struct id_list comp_list;
+extern struct sess_comps sess_comps;
+extern struct hist_index hist_index;
+extern struct hist_journal hist_journal;
+
+/* search index of the entered line until its run is journaled or -1 */
+static ptrdiff_t hist_pending = -1;
+
+/* add a line read from the history journal */
+static void merge_hist_line(char const *restrict line, bool ok)
+{
+	ptrdiff_t idx = dedup_history_add(&hist_index, &(char *){(char *)line});
+	if (idx != -1)
+		hist_index.search.lines.list[idx].ok = ok;
+}
+
+/* journal the entered line with how its run went, compacting the file once it is mostly duplicates */
+static inline void journal_hist_line(bool ok)
+{
+	char *line;
+	if (hist_pending == -1)
+		return;
+	struct search_line *ent = &hist_index.search.lines.list[hist_pending];
+	ent->ok = ok;
+	hist_pending = -1;
+	if (!program_state.sflags.hist_flag)
+		return;
+	/* merging lines from other instances can move the search index's line pool */
+	size_t len = strlen(pool_str(&hist_index.search.text, ent->id)) + 1;
+	xmalloc(char, &line, len, "journal_hist_line()");
+	memcpy(line, pool_str(&hist_index.search.text, ent->id), len);
+	if (append_journal(&hist_journal, line, ok, merge_hist_line))
+		WARN("%s", "error appending to history journal");
+	free(line);
+	maybe_compact_journal(&hist_journal, hist_index.map.cnt);
+}
+
+/* step through lines containing what was typed before the first ^R, newest first */
+static int search_hist_key(int count, int key)
+{
+	static struct search_line_list found;
+	static size_t pos;
+
+	if (rl_last_func != &search_hist_key) {
+		/* an empty line falls back to the incremental search */
+		if (!rl_end)
+			return rl_reverse_search_history(count, key);
+		char *query = rl_copy_text(0, rl_end);
+		free_search_line_list(&found);
+		/* a numeric argument only steps through lines that ran successfully */
+		search_hist(&hist_index.search, query, rl_explicit_arg, SEARCH_STEPS, &found);
+		free(query);
+		pos = 0;
+	}
+	/* skip matches identical to what is already shown */
+	while (pos < found.cnt && !strcmp(pool_str(&hist_index.search.text, found.list[pos].id), rl_line_buffer))
+		pos++;
+	if (pos >= found.cnt) {
+		rl_ding();
+		return 0;
+	}
+	rl_replace_line(pool_str(&hist_index.search.text, found.list[pos++].id), 0);
+	rl_point = rl_end;
+	return 0;
+}
 
 static inline char *read_line(struct program *restrict prog)
 {
@@ -40,6 +110,9 @@ static inline char *read_line(struct program *restrict prog)
 	/* return early if executed with `-e` argument */
 	if (prog->sflags.eval_flag)
 		return prog->cur_line = prog->eval_arg;
+	/* pick up lines other instances journaled since the last prompt */
+	if (prog->sflags.hist_flag)
+		sync_journal(&hist_journal, merge_hist_line);
 	/* use an empty prompt if stdin is a pipe */
 	if (isatty(STDIN_FILENO))
 		return prog->cur_line = readline(">>> ");
@@ -55,15 +128,10 @@ static inline char *read_line(struct program *restrict prog)
 
 static inline void init_vars(void)
 {
-	if (program_state.type_list.list) {
-		free(program_state.type_list.list);
-		program_state.type_list.list = NULL;
-	}
-	if (program_state.var_list.list) {
-		for (size_t i = 0; i < program_state.var_list.cnt; i++)
-			free(program_state.var_list.list[i].id);
-		free(program_state.var_list.list);
-	}
+	free_type_list(&program_state.type_list);
+	free_var_list(&program_state.var_list);
+	free_id_map(&program_state.var_map);
+	free_dwarf(&program_state.dwarf);
 	init_var_list(&program_state.var_list);
 }
 
@@ -73,17 +141,406 @@ static inline void undo_last_line(void)
 	if (program_state.src[0].flags.cnt < 1 || program_state.src[1].flags.cnt < 1)
 		return;
 	pop_history(&program_state);
-	/* break early if tracking disabled */
-	if (!program_state.sflags.track_flag)
+	/* forget only what the undone line declared */
+	pop_vars(&program_state, program_state.src[0].flags.cnt);
+}
+
+/* map line `decl` of the `funcs` + `body` debug source back to the history line that wrote it (0 if none did) */
+static inline size_t decl_hist_line(struct source_code const *restrict src, size_t decl)
+{
+	char const *sect = src->funcs.buf;
+	enum src_flag kind = NOT_IN_MAIN;
+	/* the prologue ends in `#line 1`, so numbering starts after it */
+	size_t off = strlen(prologue), line = 0;
+
+	for (size_t cur = 1; cur < decl;) {
+		char const *nl = strchr(sect + off, '\n');
+		if (nl) {
+			off = nl - sect + 1;
+			cur++;
+		} else if (kind == NOT_IN_MAIN) {
+			sect = src->body.buf;
+			kind = IN_MAIN;
+			off = 0;
+		} else {
+			return 0;
+		}
+	}
+	/* a line starting where `funcs` ends lies in `body` */
+	if (kind == NOT_IN_MAIN && !sect[off]) {
+		kind = IN_MAIN;
+		off = 0;
+	}
+	/* history entries are where each line starts in its section */
+	for (size_t i = 0; i < src->flags.cnt && i < src->hist.cnt; i++) {
+		if (src->flags.list[i] == kind && src->hist.list[i] <= off)
+			line = i + 1;
+	}
+	return line;
+}
+
+/* set a tracked variable's type from debug info, tracking it from its declaring line if the parser missed it */
+static inline void sync_var(struct dwarf_var const *restrict var, bool *restrict seen, size_t seen_cnt)
+{
+	struct program *prg = &program_state;
+	enum var_type type = dwarf_var_type(&prg->dwarf, var->type);
+	ptrdiff_t idx = find_id(&prg->var_map, var->id);
+
+	if (idx < 0) {
+		idx = prg->var_list.cnt;
+		push_var_list(&prg->var_list, (struct var_entry){
+			.id = var->id,
+			/* undoing a later line must not forget it */
+			.line = var->line ? decl_hist_line(&prg->src[1], var->line) : prg->src[0].flags.cnt,
+			.shadow = -1,
+			.type_spec = type,
+		});
+		set_id(&prg->var_map, var->id, idx);
 		return;
-	init_vars();
-	/* add vars from previous lines */
-	for (size_t i = 1; i < program_state.src[0].lines.cnt; i++) {
-		if (program_state.src[0].lines.list[i] && program_state.src[0].flags.list[i] == IN_MAIN) {
-			if (find_vars(&program_state, program_state.src[0].lines.list[i]))
-				gen_var_list(&program_state);
+	}
+	prg->var_list.list[idx].type_spec = type;
+	if ((size_t)idx < seen_cnt)
+		seen[idx] = true;
+}
+
+/*
+ * replace parsed variable types with the exact ones from a `-g` build
+ * and run it under trace to read their values, returning 1 if it ran
+ * (storing its exit status in `ret`), 0 if the printf fallback has to
+ * show them instead, or -1 if the session doesn't build
+ */
+static inline int trace_line(char **argv, int *restrict ret)
+{
+	struct program *prg = &program_state;
+	struct source_code const *src = &prg->src[1];
+	size_t arg_cnt = prg->cc_list.cnt, seen_cnt = prg->var_list.cnt;
+	char *dbg_args[arg_cnt + 1], *dbg_src;
+	bool seen[seen_cnt + 1];
+	uint64_t key;
+	int elf_fd;
+
+	/* `cc_list` is NULL-terminated */
+	memcpy(dbg_args, prg->cc_list.list, sizeof *dbg_args * (arg_cnt - 1));
+	dbg_args[arg_cnt - 1] = "-g";
+	dbg_args[arg_cnt] = NULL;
+	xmalloc(char, &dbg_src, strlen(src->funcs.buf) + strlen(src->body.buf)
+			+ strlen(VAR_TRAP) + strlen(prog_end) + 1, "trace_line()");
+	sprintf(dbg_src, "%s%s%s%s", src->funcs.buf, src->body.buf, VAR_TRAP, prog_end);
+	/* the debug build only changes with its source and flags */
+	key = hash_mem(dbg_src, strlen(dbg_src));
+	for (size_t i = 0; dbg_args[i]; i++)
+		key = key * 31 + hash_mem(dbg_args[i], strlen(dbg_args[i]));
+	key += !key;
+	if (key != prg->dwarf_key) {
+		if (prg->dwarf_key)
+			close(prg->dwarf_fd);
+		prg->dwarf_key = 0;
+		elf_fd = build_elf(dbg_src, dbg_args, false);
+		/* keep the parsed types if the line doesn't build */
+		if (elf_fd == -1) {
+			free(dbg_src);
+			return -1;
+		}
+		if (read_dwarf(&prg->dwarf, elf_fd, "main") == -1) {
+			close(elf_fd);
+			free(dbg_src);
+			return 0;
+		}
+		prg->dwarf_fd = elf_fd;
+		prg->dwarf_key = key;
+	}
+	free(dbg_src);
+
+	memset(seen, 0, sizeof seen);
+	/* locals shadow file scope definitions */
+	for (size_t i = 0; i < prg->dwarf.vars.cnt; i++) {
+		if (prg->dwarf.vars.list[i].is_global)
+			sync_var(&prg->dwarf.vars.list[i], seen, seen_cnt);
+	}
+	for (size_t i = 0; i < prg->dwarf.vars.cnt; i++) {
+		if (!prg->dwarf.vars.list[i].is_global)
+			sync_var(&prg->dwarf.vars.list[i], seen, seen_cnt);
+	}
+	/* anything else the parser found isn't a variable */
+	for (size_t i = 0; i < seen_cnt; i++) {
+		if (!seen[i] && find_id(&prg->var_map, prg->var_list.list[i].id) == (ptrdiff_t)i)
+			prg->var_list.list[i].type_spec = T_ERR;
+	}
+
+	return trace_vars(prg, prg->dwarf_fd, argv, ret) == 0;
+}
+
+/* run the finished line once, showing the values it touched, and return its exit status */
+static inline int run_line(char **argv)
+{
+	struct program *prg = &program_state;
+	struct source_code const *src = &prg->src[1];
+	struct char_list dbg_src;
+	int ret, mem_fd, rec_fd;
+
+	/* nothing to show if the line touched nothing tracked */
+	if (!prg->sflags.track_flag || (!prg->dump_all && !prg->touch_list.cnt))
+		return compile(src->total.buf, prg->cc_list.list, argv, true);
+	switch (trace_line(argv, &ret)) {
+	case 1:
+		return ret;
+	case -1:
+		/* let the normal build report the errors */
+		return compile(src->total.buf, prg->cc_list.list, argv, true);
+	}
+
+	/* printf fallback */
+	init_char_list(&dbg_src);
+	append_fmt(&dbg_src, "%s%s", src->funcs.buf, src->body.buf);
+	rec_fd = print_vars(prg, &dbg_src);
+	append_fmt(&dbg_src, "%s", prog_end);
+	if (rec_fd == -1 || (mem_fd = build_elf(dbg_src.list, prg->cc_list.list, false)) == -1) {
+		if (rec_fd != -1)
+			close(rec_fd);
+		free_char_list(&dbg_src);
+		return compile(src->total.buf, prg->cc_list.list, argv, true);
+	}
+	free_char_list(&dbg_src);
+	ret = exec_elf(mem_fd, argv, -1, true);
+	show_vars(prg, rec_fd);
+	return ret;
+}
+
+/* complete the names a `;f` or `;m` line defines until it is undone */
+static inline void add_def_comps(char const *tbuf)
+{
+	struct hdr_index defs = {0};
+	size_t line = program_state.src[0].flags.cnt;
+
+	/* skip the command name */
+	tbuf += strcspn(tbuf, " \t");
+	tbuf += strspn(tbuf, " \t");
+	/* definitions read the same as header declarations */
+	init_hdrs(&defs);
+	parse_hdrs(&defs, tbuf, strlen(tbuf));
+	for (size_t i = 0; i < defs.ents.cnt; i++) {
+		char const *name = hdr_str(&defs, defs.ents.list[i].name);
+		add_sess_comp(&sess_comps, &comp_list, intern_len(&str_pool, name, strlen(name)), line);
+	}
+	free_hdrs(&defs);
+}
+
+/* keep session completions in step with the history and `var_list` */
+static inline void sync_sess_comps(void)
+{
+	pop_sess_comps(&sess_comps, &comp_list, program_state.src[0].flags.cnt, program_state.var_list.cnt);
+	add_var_comps(&sess_comps, &comp_list, &program_state.var_list);
+}
+
+/* print the prologue header declarations of the name after `;explain` */
+static inline void show_decls(char const *tbuf)
+{
+	char name[0x100];
+
+	/* skip the command name */
+	tbuf += strcspn(tbuf, " \t");
+	tbuf += strspn(tbuf, " \t");
+	if (!*tbuf) {
+		WARNX("%s", "usage: ;explain <name>");
+		return;
+	}
+	snprintf(name, sizeof name, "%.*s", (int)strcspn(tbuf, " \t\n("), tbuf);
+	if (!print_hdrs(stdout, &hdr_index, name))
+		WARNX("no declaration of \"%s\" in the prologue headers", name);
+}
+
+/* print the most recent history lines containing the text after `;hist` */
+static inline void show_hist(char const *tbuf)
+{
+	struct search_line_list found;
+	size_t cnt = 0, self = hist_pending == -1 ? 0 : hist_index.search.lines.list[hist_pending].id;
+	bool ok_only = false;
+
+	/* skip the command name */
+	tbuf += strcspn(tbuf, " \t");
+	tbuf += strspn(tbuf, " \t");
+	/* `-s` keeps only lines that compiled and ran successfully */
+	if (!strncmp(tbuf, "-s", 2) && (!tbuf[2] || tbuf[2] == ' ' || tbuf[2] == '\t')) {
+		ok_only = true;
+		tbuf += 2;
+		tbuf += strspn(tbuf, " \t");
+	}
+	if (!*tbuf) {
+		WARNX("%s", "usage: ;hist [-s] <query>");
+		return;
+	}
+	/* one extra for the `;hist` line itself and one to tell if any were left out */
+	search_hist(&hist_index.search, tbuf, ok_only, SEARCH_SHOWN + 2, &found);
+	for (size_t i = 0; i < found.cnt; i++) {
+		if (found.list[i].id != self)
+			found.list[cnt++] = found.list[i];
+	}
+	if (!cnt)
+		WARNX("no history line contains \"%s\"", tbuf);
+	if (cnt > SEARCH_SHOWN) {
+		cnt = SEARCH_SHOWN;
+		printf("%s\n", "[older matches not shown]");
+	}
+	/* print oldest first so the newest match ends up next to the prompt */
+	for (size_t i = cnt; i-- > 0;)
+		printf("%c %s\n", found.list[i].ok ? '+' : ' ', pool_str(&hist_index.search.text, found.list[i].id));
+	free_search_line_list(&found);
+}
+
+/* print the layout of the type named after `;layout` using a `-g` probe build */
+static inline void show_layout(char const *tbuf)
+{
+	struct program *prg = &program_state;
+	struct source_code const *src = &prg->src[1];
+	struct dwarf_info info;
+	size_t arg_cnt = prg->cc_list.cnt, probe_id;
+	char *dbg_args[arg_cnt + 1], *dbg_src;
+	char const probe_fmt[] = "\n\t__typeof__(%s) *cepl_layout_ = 0;";
+	int elf_fd;
+
+	/* skip the command name */
+	tbuf += strcspn(tbuf, " \t");
+	tbuf += strspn(tbuf, " \t");
+	if (!*tbuf) {
+		WARNX("%s", "usage: ;layout <type>");
+		return;
+	}
+	memcpy(dbg_args, prg->cc_list.list, sizeof *dbg_args * (arg_cnt - 1));
+	dbg_args[arg_cnt - 1] = "-g";
+	dbg_args[arg_cnt] = NULL;
+	xmalloc(char, &dbg_src, strlen(src->funcs.buf) + strlen(src->body.buf)
+			+ sizeof probe_fmt + strlen(tbuf) + strlen(prog_end) + 1, "show_layout()");
+	sprintf(dbg_src, "%s%s", src->funcs.buf, src->body.buf);
+	sprintf(dbg_src + strlen(dbg_src), probe_fmt, tbuf);
+	strcat(dbg_src, prog_end);
+	elf_fd = build_elf(dbg_src, dbg_args, true);
+	free(dbg_src);
+	if (elf_fd == -1)
+		return;
+
+	init_dwarf(&info);
+	probe_id = intern_str(&str_pool, "cepl_layout_");
+	if (read_dwarf(&info, elf_fd, "main") != -1) {
+		for (size_t i = 0; i < info.vars.cnt; i++) {
+			struct dwarf_var const *var = &info.vars.list[i];
+			ptrdiff_t ptr = dwarf_strip(&info, var->type);
+			if (var->id != probe_id || var->is_global || ptr < 0)
+				continue;
+			if (print_layout(stderr, &info, info.types.list[ptr].base, tbuf) == -1 && dwarf_size(&info, info.types.list[ptr].base))
+				WARNX("`%s` is not a struct or union", tbuf);
+			break;
 		}
 	}
+	free_dwarf(&info);
+	close(elf_fd);
+}
+
+/* copy `str` with its preprocessor lines blanked out, since the declaration parser doesn't follow them */
+static inline void strip_directives(struct char_list *restrict out, char const *restrict str)
+{
+	init_char_list(out);
+	extend_char_list(out, str, strlen(str) + 1);
+	for (char *ln = out->list; *ln; ln += strcspn(ln, "\n")) {
+		ln += strspn(ln, " \t\n");
+		if (*ln == '#')
+			memset(ln, ' ', strcspn(ln, "\n"));
+	}
+}
+
+/* collect the session variables `stmt` mentions so `;bench` can hide their values from the optimizer */
+static inline void find_bench_vars(struct str_list *restrict names, char const *restrict stmt)
+{
+	struct source_code const *src = &program_state.src[1];
+	struct char_list funcs, body;
+	struct token prev = {0};
+	size_t len = strlen(stmt);
+
+	strip_directives(&funcs, src->funcs.buf);
+	strip_directives(&body, src->body.buf + strlen(prog_start));
+	init_str_list(names);
+	for (size_t pos = 0;;) {
+		struct token tok = lex_next(stmt, len, &pos);
+		if (tok.type == TOK_END)
+			break;
+		if (tok.type == TOK_ID && !lex_is(stmt, prev, ".") && !lex_is(stmt, prev, "->")) {
+			char name[tok.len + 1];
+			memcpy(name, stmt + tok.off, tok.len);
+			name[tok.len] = 0;
+			if (extract_type(body.list, body.cnt - 1, name) != T_ERR || extract_type(funcs.list, funcs.cnt - 1, name) != T_ERR)
+				append_str(names, name, 0);
+		}
+		prev = tok;
+	}
+	append_str(names, NULL, 0);
+	free_char_list(&funcs);
+	free_char_list(&body);
+}
+
+/*
+ * time the statement after `;bench` in a calibrated loop appended to an
+ * optimized build of the session, whose earlier lines (and their side
+ * effects) run once first
+ */
+static inline void run_bench(char const *tbuf, char **argv)
+{
+	struct program *prg = &program_state;
+	struct source_code const *src = &prg->src[1];
+	struct timeit_stats stats;
+	struct char_list bench_src;
+	struct str_list names;
+	size_t arg_cnt = prg->cc_list.cnt;
+	char *opt_args[arg_cnt + 1];
+	int elf_fd = -1, null_fd, rec_fd, ret;
+
+	/* skip the command name */
+	tbuf += strcspn(tbuf, " \t");
+	tbuf += strspn(tbuf, " \t");
+	if (!*tbuf) {
+		WARNX("%s", "usage: ;bench <stmt>");
+		return;
+	}
+	/* the last `-O` wins, so the loop is timed the way hot-path code ships */
+	memcpy(opt_args, prg->cc_list.list, sizeof *opt_args * (arg_cnt - 1));
+	opt_args[arg_cnt - 1] = "-O2";
+	opt_args[arg_cnt] = NULL;
+	/* samples come back over `rec_fd` */
+	if ((rec_fd = syscall(SYS_memfd_create, "cepl_bench", 0)) == -1)
+		ERR("%s", "error creating rec_fd");
+
+	/*
+	 * try `tbuf` as an expression whose value must be kept before falling
+	 * back to a plain statement, and only then to leaving the variables it
+	 * uses visible (a `register` variable has no address to hide)
+	 */
+	find_bench_vars(&names, tbuf);
+	init_char_list(&bench_src);
+	for (size_t i = 0; i < 4 && elf_fd == -1; i++) {
+		truncate_char_list(&bench_src, 0);
+		extend_char_list(&bench_src, src->funcs.buf, strlen(src->funcs.buf));
+		extend_char_list(&bench_src, src->body.buf, strlen(src->body.buf));
+		build_timeit(&bench_src, tbuf, !(i & 1), (i < 2) ? (char const *const *)names.list : NULL, rec_fd);
+		append_fmt(&bench_src, "%s", prog_end);
+		elf_fd = build_elf(bench_src.list, opt_args, i == 3);
+	}
+	free_char_list(&bench_src);
+	free_str_list(&names);
+	if (elf_fd == -1) {
+		close(rec_fd);
+		return;
+	}
+
+	/* the session runs once before the loop, so keep its input and output out of the way */
+	if ((null_fd = open("/dev/null", O_RDWR)) == -1)
+		ERR("%s", "open()");
+	fflush(stdout);
+	if ((ret = exec_elf(elf_fd, argv, null_fd, false)))
+		WARNX("benchmark exited with status %d", ret);
+	else if (read_timeit(rec_fd, &stats) == -1)
+		WARNX("%s", "benchmark wrote no samples");
+	else
+		print_timeit(stdout, tbuf, &stats);
+	close(null_fd);
+	close(rec_fd);
 }
 
 /* exit handler registration */
@@ -157,6 +614,8 @@ static void sig_handler(int sig)
 	 * to abort running code early
 	 */
 	if (sig == SIGINT) {
+		/* a traced child stops on SIGINT instead of dying */
+		kill_trace(&program_state);
 		/*
 		 * else abort current input line and
 		 * siglongjmp() back to loop beginning
@@ -210,15 +669,15 @@ static void reg_handlers(void)
 		WARN("%s", "at_quick_exit(&free_bufs)");
 }
 
-static inline char *gen_bin_str(char const *restrict in_str)
+static inline char *gen_bin_str(char const *restrict in_str, size_t in_len)
 {
-	size_t in_len = 0, cnt = 0, num_octets = 0;
+	size_t cnt = 0, num_octets = 0;
 	char base_arr[65] = {0}, *base_ptr = base_arr, *end_ptr;
 	char rev_arr[sizeof base_arr + sizeof base_arr / 8] = {0}, *rev_ptr = rev_arr;
 	static char final_array[sizeof rev_arr], *final_ptr = NULL;
 
 	/* return early if NULL or empty string */
-	if (!in_str || !(in_len = strlen(in_str))) {
+	if (!in_str || !in_len) {
 #ifdef _DEBUG
 		DPRINTF("%s", "NULL or empty string passed to gen_bin_str()");
 #endif
@@ -231,8 +690,13 @@ static inline char *gen_bin_str(char const *restrict in_str)
 	DPRINTF("endptr: \"%s\"\n*endptr = '%c'\n", end_ptr, *end_ptr);
 #endif
 	/* return empty string on parse error */
-	if (errno || !in_len || (*end_ptr && (strspn(end_ptr, " \t;") != strlen(end_ptr))))
+	if (errno || end_ptr > in_str + in_len)
 		return "";
+	/* only trailing blanks are allowed after the number */
+	for (; end_ptr < in_str + in_len; end_ptr++) {
+		if (!strchr(" \t;", *end_ptr))
+			return "";
+	}
 
 	/* build base binary string */
 	while (num) {
@@ -281,7 +745,7 @@ static void eval_line(int argc, char **restrict argv, char const *restrict optst
 
 	char const *const term = getenv("TERM");
 	struct program prg = {0};
-	struct str_list temp = strsplit(program_state.cur_line);
+	struct span_list temp;
 	bool has_color = term
 		&& isatty(STDOUT_FILENO)
 		&& isatty(STDERR_FILENO)
@@ -294,6 +758,7 @@ static void eval_line(int argc, char **restrict argv, char const *restrict optst
 	char const *const ln_hex[] = {"(unsigned long long)(", "), \""};
 	char const *const ln_end = "\");";
 
+	strsplit(&temp, program_state.cur_line);
 	/* bit bucket */
 	parse_opts(&prg, argc, argv, optstring);
 	init_buffers(&prg);
@@ -302,19 +767,22 @@ static void eval_line(int argc, char **restrict argv, char const *restrict optst
 	prg.sflags = (struct state_flags){0};
 
 	for (size_t i = 0; i < temp.cnt; i++) {
-		char const *const ln_bin = gen_bin_str(temp.list[i]);
+		/* statements are spans into the original line */
+		char const *const ln = program_state.cur_line + temp.list[i].off;
+		int const ln_len = temp.list[i].len;
+		char const *const ln_bin = gen_bin_str(ln, ln_len);
 		char const *const ln_bin_pre = strlen(ln_bin) ? ", " : "";
 		char const *const ln_bin_end = "]";
 		size_t sz = 1 + strlen(ln_beg) + strlen(ln_end)
 			+ strlen(ln_long[0]) + strlen(ln_long[1])
 			+ strlen(ln_hex[0]) + strlen(ln_hex[1])
 			+ strlen(ln_bin_pre) + strlen(ln_bin) + strlen(ln_bin_end)
-			+ strlen(temp.list[i]) * 2;
+			+ ln_len * 2;
 		/* initialize source buffers */
 		xcalloc(char, &prg.cur_line, 1, sz, "eval_line() calloc");
-		sprintf(prg.cur_line, "%s%s%s%s%s%s%s%s%s%s%s", ln_beg,
-				ln_long[0], temp.list[i], ln_long[1],
-				ln_hex[0], temp.list[i], ln_hex[1],
+		sprintf(prg.cur_line, "%s%s%.*s%s%s%.*s%s%s%s%s%s", ln_beg,
+				ln_long[0], ln_len, ln, ln_long[1],
+				ln_hex[0], ln_len, ln, ln_hex[1],
 				ln_bin_pre, ln_bin, ln_bin_end,
 				ln_end);
 #ifdef _DEBUG
@@ -325,7 +793,7 @@ static void eval_line(int argc, char **restrict argv, char const *restrict optst
 			resize_sect(&prg, &prg.src[j].total, sz);
 		}
 		/* extract identifiers and types */
-		if (temp.list[i][0] != ';' && !find_vars(&prg, temp.list[i])) {
+		if (!find_vars(&prg, ln, ln_len)) {
 			build_body(&prg);
 			build_final(&prg, argv);
 		}
@@ -338,11 +806,60 @@ static void eval_line(int argc, char **restrict argv, char const *restrict optst
 	dup2(null_fd, STDOUT_FILENO);
 	compile(prg.src[1].total.buf, program_state.cc_list.list, argv, false);
 	free_buffers(&prg);
-	free_str_list(&temp);
+	free_span_list(&temp);
 	dup2(program_state.saved_fd, STDOUT_FILENO);
 	close(null_fd);
 }
 
+/* set the array elements shown from each end and the step between them */
+static inline void set_dump_opts(char const *tbuf)
+{
+	struct dump_opts *opts = &program_state.dump_opts;
+	size_t *fields[] = {&opts->head, &opts->tail, &opts->stride};
+
+	/* skip the command name */
+	tbuf += strcspn(tbuf, " \t");
+	for (size_t i = 0; i < ARR_LEN(fields); i++) {
+		char *end;
+		tbuf += strspn(tbuf, " \t");
+		unsigned long val = strtoul(tbuf, &end, 10);
+		if (end == tbuf)
+			break;
+		*fields[i] = val;
+		tbuf = end;
+	}
+	/* a zero step would never advance */
+	opts->stride = DEFAULT(opts->stride, 1);
+	fprintf(stderr, "dump: head %zu, tail %zu, stride %zu\n", opts->head, opts->tail, opts->stride);
+}
+
+/* set the vector lane view, returning false if there was no argument */
+static inline bool set_lane_view(char const *tbuf)
+{
+	struct dump_opts *opts = &program_state.dump_opts;
+	char *end;
+
+	/* skip the command name */
+	tbuf += strcspn(tbuf, " \t");
+	tbuf += strspn(tbuf, " \t");
+	if (!*tbuf)
+		return false;
+	if (!strncmp(tbuf, "auto", 4)) {
+		opts->lane_kind = 0;
+		opts->lane_size = 0;
+		return true;
+	}
+	unsigned long bits = strtoul(tbuf + 1, &end, 10);
+	bool valid = strchr("iux", *tbuf) ? (bits == 8 || bits == 16 || bits == 32 || bits == 64) : (*tbuf == 'f' && (bits == 32 || bits == 64));
+	if (end == tbuf + 1 || !valid) {
+		WARNX("%s", "lane view must be one of i8-64, u8-64, x8-64, f32, f64, or auto");
+		return true;
+	}
+	opts->lane_kind = *tbuf;
+	opts->lane_size = bits / 8;
+	return true;
+}
+
 static inline void toggle_att(char *tbuf)
 {
 	/* if file was open, flip it and break early */
@@ -430,7 +947,7 @@ static inline void toggle_output_file(char *tbuf)
 
 static inline void parse_macro(void)
 {
-	struct str_list tmp_list;
+	struct span_list tmp_list;
 	char *saved, *tmp_buf;
 	/* remove trailing ' ' and '\t' */
 	for (size_t i = strlen(program_state.cur_line) - 1; i > 0; i--) {
@@ -491,13 +1008,15 @@ static inline void parse_macro(void)
 			for (size_t i = 0; i < 2; i++)
 				strmv(CONCAT, program_state.src[i].funcs.buf, "\n");
 
-			tmp_list = strsplit(program_state.cur_line);
+			strsplit(&tmp_list, program_state.cur_line);
 			for (size_t i = 0; i < tmp_list.cnt; i++) {
 				/* extract identifiers and types */
-				if (program_state.sflags.track_flag && find_vars(&program_state, tmp_list.list[i]))
+				struct span const stmt = tmp_list.list[i];
+				if (program_state.sflags.track_flag
+						&& find_vars(&program_state, program_state.cur_line + stmt.off, stmt.len))
 					gen_var_list(&program_state);
 			}
-			free_str_list(&tmp_list);
+			free_span_list(&tmp_list);
 			break;
 
 		default:
@@ -505,13 +1024,15 @@ static inline void parse_macro(void)
 			/* append ';' if no trailing '}', ';', or '\' */
 			for (size_t i = 0; i < 2; i++)
 				strmv(CONCAT, program_state.src[i].funcs.buf, ";\n");
-			tmp_list = strsplit(program_state.cur_line);
+			strsplit(&tmp_list, program_state.cur_line);
 			for (size_t i = 0; i < tmp_list.cnt; i++) {
 				/* extract identifiers and types */
-				if (program_state.sflags.track_flag && find_vars(&program_state, tmp_list.list[i]))
+				struct span const stmt = tmp_list.list[i];
+				if (program_state.sflags.track_flag
+						&& find_vars(&program_state, program_state.cur_line + stmt.off, stmt.len))
 					gen_var_list(&program_state);
 			}
-			free_str_list(&tmp_list);
+			free_span_list(&tmp_list);
 		}
 	}
 	program_state.cur_line = saved;
@@ -519,12 +1040,10 @@ static inline void parse_macro(void)
 
 static inline void parse_normal(void)
 {
-	/* remove trailing ' ' and '\t' */
-	for (size_t i = strlen(program_state.cur_line) - 1; i > 0; i--) {
-		if (program_state.cur_line[i] != ' ' && program_state.cur_line[i] != '\t')
-			break;
-		program_state.cur_line[i] = '\0';
-	}
+	/* remove trailing whitespace and comments so an appended ';' isn't commented out */
+	size_t code_end = lex_code_end(program_state.cur_line, strlen(program_state.cur_line));
+	if (code_end > 0)
+		program_state.cur_line[code_end] = '\0';
 	switch(program_state.cur_line[strlen(program_state.cur_line) - 1]) {
 	case '{': /* fallthough */
 	case '}': /* fallthough */
@@ -543,13 +1062,16 @@ static inline void parse_normal(void)
 				}
 				strmv(CONCAT, prg->src[i].body.buf, "\n");
 			}
-			struct str_list tmp = strsplit(program_state.cur_line);
+			struct span_list tmp;
+			strsplit(&tmp, program_state.cur_line);
 			for (size_t i = 0; i < tmp.cnt; i++) {
 				/* extract identifiers and types */
-				if (program_state.sflags.track_flag && find_vars(&program_state, tmp.list[i]))
+				struct span const stmt = tmp.list[i];
+				if (program_state.sflags.track_flag
+						&& find_vars(&program_state, program_state.cur_line + stmt.off, stmt.len))
 					gen_var_list(&program_state);
 			}
-			free_str_list(&tmp);
+			free_span_list(&tmp);
 			break;
 		   }
 
@@ -558,13 +1080,16 @@ static inline void parse_normal(void)
 			/* append ';' if no trailing '}', ';', or '\' */
 			for (size_t i = 0; i < 2; i++)
 				strmv(CONCAT, program_state.src[i].body.buf, ";\n");
-			struct str_list tmp = strsplit(program_state.cur_line);
+			struct span_list tmp;
+			strsplit(&tmp, program_state.cur_line);
 			for (size_t i = 0; i < tmp.cnt; i++) {
 				/* extract identifiers and types */
-				if (program_state.sflags.track_flag && find_vars(&program_state, tmp.list[i]))
+				struct span const stmt = tmp.list[i];
+				if (program_state.sflags.track_flag
+						&& find_vars(&program_state, program_state.cur_line + stmt.off, stmt.len))
 					gen_var_list(&program_state);
 			}
-			free_str_list(&tmp);
+			free_span_list(&tmp);
 		}
 	}
 }
@@ -578,13 +1103,12 @@ static inline void scan_input_file(void)
 	char *prog_buf = strchr(prog_start_user, '{');
 	if (!prog_buf)
 		return;
-	if (program_state.sflags.track_flag && find_vars(&program_state, ++prog_buf))
+	if (program_state.sflags.track_flag && find_vars(&program_state, prog_buf + 1, strlen(prog_buf + 1)))
 		gen_var_list(&program_state);
 }
 
 static inline void build_hist_name(void)
 {
-	struct stat hist_stat;
 	size_t buf_sz = sizeof hist_name, hist_len = 0;
 	char const *const home_env = getenv("HOME");
 	FILE *make_hist = NULL;
@@ -606,9 +1130,11 @@ static inline void build_hist_name(void)
 	/* enable completion */
 	rl_completion_entry_function = &generator;
 	rl_attempted_completion_function = &completer;
-	rl_basic_word_break_characters = " \t\n\"\\'`@$><=|&{}()[]";
+	/* `.` so struct members from the header index complete after `var.` */
+	rl_basic_word_break_characters = " \t\n\"\\'`@$><=|&{}()[].";
 	rl_completion_suppress_append = 1;
 	rl_bind_key('\t', &rl_complete);
+	rl_bind_key(CTRL('r'), &search_hist_key);
 
 	/* initialize history sesssion */
 	using_history();
@@ -619,18 +1145,9 @@ static inline void build_hist_name(void)
 		fclose(make_hist);
 		program_state.sflags.hist_flag = true;
 	}
-	/* read program_state.hist_file if size is non-zero */
-	stat(program_state.hist_file, &hist_stat);
-	if (hist_stat.st_size > 0) {
-		if (read_history(program_state.hist_file)) {
-			char hist_pre[] = "error reading history from ";
-			char hist_full[sizeof hist_pre + strlen(program_state.hist_file)];
-			char *hist_ptr = hist_full;
-			strmv(0, hist_ptr, hist_pre);
-			strmv(sizeof hist_pre - 1, hist_ptr, program_state.hist_file);
-			WARN("%s", hist_ptr);
-		}
-	}
+	/* map the journal once, keeping the last copy of each line */
+	if (program_state.sflags.hist_flag)
+		load_journal(&hist_journal, program_state.hist_file, merge_hist_line);
 }
 
 static inline void save_flag_state(struct state_flags *restrict sflags)
@@ -643,6 +1160,7 @@ static inline void save_flag_state(struct state_flags *restrict sflags)
 	sflags->parse_flag = program_state.sflags.parse_flag;
 	sflags->track_flag = program_state.sflags.track_flag;
 	sflags->warn_flag = program_state.sflags.warn_flag;
+	sflags->simd_flag = program_state.sflags.simd_flag;
 }
 
 static inline void restore_flag_state(struct state_flags *restrict sflags)
@@ -655,18 +1173,20 @@ static inline void restore_flag_state(struct state_flags *restrict sflags)
 	program_state.sflags.parse_flag = sflags->parse_flag;
 	program_state.sflags.track_flag = sflags->track_flag;
 	program_state.sflags.warn_flag = sflags->warn_flag;
+	program_state.sflags.simd_flag = sflags->simd_flag;
 }
 
 int main(int argc, char **argv)
 {
 	struct state_flags saved_flags = STATE_FLAG_DEF_INIT;
-	char const *const optstring = "hptvwc:a:f:e:i:l:I:o:";
+	char const *const optstring = "hpstvwc:a:f:e:i:l:I:o:";
 
 	/* initialize compiler arg array */
 	build_hist_name();
 	save_flag_state(&saved_flags);
 	parse_opts(&program_state, argc, argv, optstring);
 	init_buffers(&program_state);
+	program_state.dump_opts = DUMP_OPTS_DEF_INIT;
 	scan_input_file();
 	/* save stderr for signal handler */
 	program_state.saved_fd = dup(STDERR_FILENO);
@@ -701,6 +1221,9 @@ int main(int argc, char **argv)
 		rl_line_buffer[rl_point = rl_end = rl_mark = 0] = 0;
 		rl_initialize();
 		fputc('\n', stderr);
+		/* an aborted run still gets journaled */
+		journal_hist_line(false);
+		program_state.dump_all = false;
 	}
 
 	/* loop readline() until EOF is read */
@@ -716,7 +1239,8 @@ int main(int argc, char **argv)
 		tty_break(&program_state);
 		/* re-enable completion if disabled */
 		rl_bind_key('\t', &rl_complete);
-		dedup_history_add(&program_state.cur_line);
+		/* the line is journaled once its run finishes */
+		hist_pending = dedup_history_add(&hist_index, &program_state.cur_line);
 		/* re-allocate enough memory for line + '\t' + ';' + '\n' + '\0' */
 		for (size_t i = 0; i < 2; i++) {
 			/* keep line length to a minimum */
@@ -727,6 +1251,8 @@ int main(int argc, char **argv)
 		stripped = program_state.cur_line;
 		stripped += strspn(stripped, " \t");
 		eval_line(argc, argv, optstring);
+		/* only what this line touches gets dumped */
+		truncate_id_list(&program_state.touch_list, 0);
 
 		/* control sequence and preprocessor directive parsing */
 		switch (stripped[0]) {
@@ -745,6 +1271,41 @@ int main(int argc, char **argv)
 				parse_opts(&program_state, argc, argv, optstring);
 				break;
 
+			/* set array display limits */
+			case 'd':
+				set_dump_opts(stripped);
+				/* redisplay everything with the new limits */
+				program_state.dump_all = true;
+				break;
+
+			/* show declarations from the headers */
+			case 'e':
+				show_decls(stripped);
+				break;
+
+			/* show struct layout */
+			case 'l':
+				show_layout(stripped);
+				break;
+
+			/* dump every tracked variable */
+			case 'v':
+				program_state.dump_all = true;
+				break;
+
+			/* set the vector lane view or toggle `<immintrin.h>` */
+			case 's':
+				/* redisplay everything in the new view */
+				if (set_lane_view(stripped)) {
+					program_state.dump_all = true;
+					break;
+				}
+				restore_flag_state(&saved_flags);
+				program_state.sflags.simd_flag ^= true;
+				save_flag_state(&saved_flags);
+				parse_opts(&program_state, argc, argv, optstring);
+				break;
+
 			/* toggle writing intel-dialect asm output */
 			case 'i':
 				restore_flag_state(&saved_flags);
@@ -805,15 +1366,26 @@ int main(int argc, char **argv)
 			case 'm': /* fallthrough */
 			case 'f':
 				parse_macro();
+				add_def_comps(stripped);
 				break;
 
-			/* show usage information */
+			/* time a statement */
+			case 'b':
+				run_bench(stripped, argv);
+				break;
+
+			/* search history or show usage information */
 			case 'h':
+				if (!strncmp(stripped + 1, "hist", 4) && (!stripped[5] || stripped[5] == ' ' || stripped[5] == '\t')) {
+					show_hist(stripped);
+					break;
+				}
 				fprintf(stderr, "%s %s %s\n", "Usage:", argv[0], USAGE_STRING);
 				break;
 
 			/* clean up and exit program */
 			case 'q':
+				journal_hist_line(true);
 				free_buffers(&program_state);
 				cleanup(&program_state);
 				exit(EXIT_SUCCESS);
@@ -843,6 +1415,8 @@ int main(int argc, char **argv)
 			parse_normal();
 		}
 
+		/* complete what the line declared and forget what it undid */
+		sync_sess_comps();
 		/* set to true before compiling */
 		program_state.sflags.exec_flag = true;
 		/* finalize source */
@@ -854,10 +1428,12 @@ int main(int argc, char **argv)
 			fprintf(stderr, "%s\n", program_state.src[0].total.buf);
 			fprintf(stderr, "==========\n");
 		}
-		int ret = compile(program_state.src[1].total.buf, program_state.cc_list.list, argv, true);
+		int ret = run_line(argv);
+		program_state.dump_all = false;
 		/* print output and exit code if non-zero */
 		if (ret || (isatty(STDIN_FILENO) && !program_state.sflags.eval_flag))
 			fprintf(stderr, "[exit status: %d]\n", ret);
+		journal_hist_line(!ret);
 
 		/* reset io stream buffering modes */
 		tty_fix(&program_state);
@@ -30,39 +30,41 @@ static char *const ld_alt_list[] = {
 
 extern char **environ;
 
-int compile(char const *restrict src, char *const cc_args[], char *const exec_args[], bool show_errors)
+/* build `src` into a memfd, storing the compiler or linker exit status in `ret` if either fails */
+static int build_status(char const *restrict src, char *const cc_args[], bool show_errors, int *restrict ret)
 {
 	int null_fd, mem_fd, status;
-	int pipe_cc[2], pipe_ld[2], pipe_exec[2];
-	size_t len = strlen(src);
+	int pipe_cc[2], pipe_ld[2];
+	pid_t pid;
 
-	if (!src || !cc_args || !exec_args)
-		ERRX("%s", "NULL pointer passed to compile()");
+	*ret = -1;
+	if (!src || !cc_args)
+		ERRX("%s", "NULL pointer passed to build_elf()");
+	size_t len = strlen(src);
 	if (!len)
-		return 0;
+		return -1;
 
 	/* bit bucket */
 	if ((null_fd = open("/dev/null", O_WRONLY, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH)) == -1)
 		ERR("%s", "open()");
+	/* seekable output so the result can be inspected as well as executed */
+	if ((mem_fd = syscall(SYS_memfd_create, "cepl_memfd", MFD_CLOEXEC)) == -1)
+		ERR("%s", "error creating mem_fd");
 
 	/* create pipes */
 	if (pipe2(pipe_cc, O_CLOEXEC) == -1)
 		ERR("%s", "error making pipe_cc pipe");
 	if (pipe2(pipe_ld, O_CLOEXEC) == -1)
 		ERR("%s", "error making pipe_ld pipe");
-	if (pipe2(pipe_exec, O_CLOEXEC) == -1)
-		ERR("%s", "error making pipe_exec pipe");
 
 	/* fork compiler */
-	switch (fork()) {
+	switch ((pid = fork())) {
 	/* error */
 	case -1:
 		close(pipe_cc[0]);
 		close(pipe_cc[1]);
 		close(pipe_ld[0]);
 		close(pipe_ld[1]);
-		close(pipe_exec[0]);
-		close(pipe_exec[1]);
 		ERR("%s", "error forking compiler");
 		break;
 
@@ -84,22 +86,25 @@ int compile(char const *restrict src, char *const cc_args[], char *const exec_ar
 		if (write(pipe_cc[1], src, len) == -1)
 			ERR("%s", "error writing to pipe_cc[1]");
 		close(pipe_cc[1]);
-		wait(&status);
+		/* a child abandoned by ^C must not be mistaken for this one */
+		waitpid(pid, &status, 0);
 		/* convert 255 to -1 since WEXITSTATUS() only returns the low-order 8 bits */
 		if (WIFEXITED(status) && WEXITSTATUS(status)) {
 			if (show_errors)
 				WARNX("%s", "compiler returned non-zero exit code");
-			return (WEXITSTATUS(status) != 0xff) ? WEXITSTATUS(status) : -1;
+			close(pipe_ld[0]);
+			close(null_fd);
+			close(mem_fd);
+			*ret = (WEXITSTATUS(status) != 0xff) ? WEXITSTATUS(status) : -1;
+			return -1;
 		}
 	}
 
 	/* fork linker */
-	switch (fork()) {
+	switch ((pid = fork())) {
 	/* error */
 	case -1:
 		close(pipe_ld[0]);
-		close(pipe_exec[0]);
-		close(pipe_exec[1]);
 		ERR("%s", "error forking linker");
 		break;
 
@@ -108,7 +113,7 @@ int compile(char const *restrict src, char *const cc_args[], char *const exec_ar
 		if (!show_errors)
 			dup2(null_fd, STDERR_FILENO);
 		dup2(pipe_ld[0], STDIN_FILENO);
-		dup2(pipe_exec[1], STDOUT_FILENO);
+		dup2(mem_fd, STDOUT_FILENO);
 		if (ld_list.list)
 			execvp(ld_list.list[0], ld_list.list);
 		/* fallback linker exec */
@@ -120,30 +125,53 @@ int compile(char const *restrict src, char *const cc_args[], char *const exec_ar
 	/* parent */
 	default:
 		close(pipe_ld[0]);
-		close(pipe_exec[1]);
-		wait(&status);
+		close(null_fd);
+		waitpid(pid, &status, 0);
 		/* convert 255 to -1 since WEXITSTATUS() only returns the low-order 8 bits */
 		if (WIFEXITED(status) && WEXITSTATUS(status)) {
 			if (show_errors)
 				WARNX("%s", "linker returned non-zero exit code");
-			return (WEXITSTATUS(status) != 0xff) ? WEXITSTATUS(status) : -1;
+			close(mem_fd);
+			*ret = (WEXITSTATUS(status) != 0xff) ? WEXITSTATUS(status) : -1;
+			return -1;
 		}
 	}
 
+	*ret = 0;
+	return mem_fd;
+}
+
+int build_elf(char const *restrict src, char *const cc_args[], bool show_errors)
+{
+	int ret;
+	return build_status(src, cc_args, show_errors, &ret);
+}
+
+int exec_elf(int mem_fd, char *const exec_args[], int null_fd, bool show_errors)
+{
+	int status;
+	pid_t pid;
+
+	if (!exec_args)
+		ERRX("%s", "NULL pointer passed to exec_elf()");
+
 	/* fork executable */
-	switch (fork()) {
+	switch ((pid = fork())) {
 	/* error */
 	case -1:
-		close(pipe_exec[0]);
+		close(mem_fd);
 		ERR("%s", "error forking executable");
 		break;
 
 	/* child */
 	case 0:
 		reset_handlers();
-		if ((mem_fd = syscall(SYS_memfd_create, "cepl_memfd", MFD_CLOEXEC)) == -1)
-			ERR("%s", "error creating mem_fd");
-		pipe_fd(pipe_exec[0], mem_fd);
+		/* runs whose results come back another way keep the terminal to themselves */
+		if (null_fd != -1) {
+			dup2(null_fd, STDIN_FILENO);
+			dup2(null_fd, STDOUT_FILENO);
+			dup2(null_fd, STDERR_FILENO);
+		}
 		fexecve(mem_fd, exec_args, environ);
 		/* fexecve() should never return */
 		ERR("%s", "error forking executable");
@@ -151,9 +179,8 @@ int compile(char const *restrict src, char *const cc_args[], char *const exec_ar
 
 	/* parent */
 	default:
-		close(pipe_exec[0]);
-		close(null_fd);
-		wait(&status);
+		close(mem_fd);
+		waitpid(pid, &status, 0);
 		/* convert 255 to -1 since WEXITSTATUS() only returns the low-order 8 bits */
 		if (WIFEXITED(status) && WEXITSTATUS(status)) {
 			if (show_errors)
@@ -165,3 +192,17 @@ int compile(char const *restrict src, char *const cc_args[], char *const exec_ar
 	/* program returned success */
 	return 0;
 }
+
+int compile(char const *restrict src, char *const cc_args[], char *const exec_args[], bool show_errors)
+{
+	int mem_fd, ret;
+
+	if (!src || !cc_args || !exec_args)
+		ERRX("%s", "NULL pointer passed to compile()");
+	if (!strlen(src))
+		return 0;
+	/* a failed build returns the compiler's or linker's exit status */
+	if ((mem_fd = build_status(src, cc_args, show_errors, &ret)) == -1)
+		return ret;
+	return exec_elf(mem_fd, exec_args, -1, show_errors);
+}
@@ -13,6 +13,8 @@
 #include <fcntl.h>
 
 /* prototypes */
+int build_elf(char const *restrict src, char *const cc_args[], bool show_errors);
+int exec_elf(int mem_fd, char *const exec_args[], int null_fd, bool show_errors);
 int compile(char const *restrict src, char *const cc_args[], char *const exec_args[], bool show_errors);
 
 static inline void set_cloexec(int set_fd[static 2])
@@ -14,9 +14,12 @@
 #endif
 
 #include "errs.h"
+#include "lex.h"
+#include "scan.h"
 #include <ctype.h>
 #include <limits.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <termio.h>
@@ -57,7 +60,7 @@
 /* global version and usage strings */
 #define VERSION_STRING	"CEPL v6.2.2"
 #define USAGE_STRING \
-	"[-hptvw] [-(a|i)<asm.s>] [-c<compiler>] [-e<code>] " \
+	"[-hpstvw] [-(a|i)<asm.s>] [-c<compiler>] [-e<code>] " \
 	"[-l<libs>] [-I<includes>] [-o<out.c>]\n\t" \
 	"-a, --att\t\tName of the file to output AT&T-dialect assembler code to\n\t" \
 	"-c, --cc\t\tSpecify alternate compiler\n\t" \
@@ -67,6 +70,7 @@
 	"-i, --intel\t\tName of the file to output Intel-dialect assembler code to\n\t" \
 	"-o, --output\t\tName of the file to output C source code to\n\t" \
 	"-p, --parse\t\tDisable addition of dynamic library symbols to readline completion\n\t" \
+	"-s, --simd\t\tInclude <immintrin.h> and compile with -march=native\n\t" \
 	"-t, --tracking\t\tToggle variable tracking\n\t" \
 	"-v, --version\t\tShow version information\n\t" \
 	"-w, --warnings\t\tCompile with \"-Wall -Wextra -pedantic\" flags\n\t" \
@@ -74,15 +78,22 @@
 	"-I\t\t\tSearch directory for header files (flag can be repeated)\n" \
 	"Lines prefixed with a \";\" are interpreted as commands ([] text is optional).\n\t" \
 	";a[tt]\t\t\tToggle -a (output AT&T-dialect assembler code) flag\n\t" \
+	";b[ench]\t\tRe-run the session's lines, side effects included, then time a statement or expression in a calibrated -O2 loop (e.g. \";b strlen(buf)\")\n\t" \
+	";d[ump]\t\t\tSet array elements shown from each end and the step (e.g. \";d 8 2 1\")\n\t" \
+	";e[xplain]\t\tShow header declarations of a name (e.g. \";e printf\")\n\t" \
 	";h[elp]\t\t\tShow help\n\t" \
+	";hist [-s] <query>\tSearch history, -s for lines that compiled and ran (Ctrl-R steps through matches)\n\t" \
 	";i[ntel]\t\tToggle -a (output Intel-dialect assembler code) flag\n\t" \
+	";l[ayout]\t\tShow size, padding, and cache-line use of a struct (e.g. \";l struct foo\")\n\t" \
 	";m[acro]\t\tDefine a function (e.g. \";f void bork(void) { puts(\"wark\"); }\")\n\t" \
 	";o[utput]\t\tToggle -o (output C source code) flag\n\t" \
 	";p[arse]\t\tToggle -p (shared library parsing) flag\n\t" \
 	";q[uit]\t\t\tExit CEPL\n\t" \
 	";r[eset]\t\tReset CEPL to its initial program state\n\t" \
+	";s[imd]\t\t\tToggle -s (<immintrin.h>) flag or view vector lanes as i8-64/u8-64/x8-64/f32/f64/auto\n\t" \
 	";t[racking]\t\tToggle variable tracking\n\t" \
 	";u[ndo]\t\t\tIncremental pop_history (can be repeated)\n\t" \
+	";v[ars]\t\t\tShow every tracked variable instead of only those the line touched\n\t" \
 	";w[arnings]\t\tToggle -w (pedantic warnings) flag"
 /* option default initializer */
 #define STATE_FLAG_DEF_INIT \
@@ -90,6 +101,11 @@
 		.asm_flag = false, .eval_flag = false, .exec_flag = false, \
 		.in_flag = false, .out_flag = false, .parse_flag = true, \
 		.track_flag = true, .warn_flag = false, .hist_flag = false, \
+		.simd_flag = false, \
+	}
+#define DUMP_OPTS_DEF_INIT \
+	(struct dump_opts){ \
+		.head = 8, .tail = 2, .stride = 1, \
 	}
 #define	RED		"\\033[31m"
 #define	GREEN		"\\033[32m"
@@ -102,7 +118,7 @@
 /* max eval string length */
 #define EVAL_LIMIT	PAGE_SIZE
 /* max possible types */
-#define TNUM		7
+#define TNUM		8
 /* `strmv() `concat constant */
 #define CONCAT		(-1)
 
@@ -125,34 +141,253 @@ enum asm_type {
 enum var_type {
 	T_ERR, T_CHR, T_STR,
 	T_INT, T_UINT, T_FLT,
-	T_PTR, T_OTHER,
+	T_PTR, T_VEC, T_OTHER,
+};
+
+/* element destructor for arrays of plain values */
+#define NO_DTOR(ELEM)		((void)(ELEM))
+/*
+ * generate `struct NAME`, a dynamic array of `TYPE` whose first `INL`
+ * elements are stored inside the struct itself; `list` points at `inl`
+ * until the array outgrows it (so never copy these structs by value).
+ * a zeroed struct is a valid empty array and `DTOR` is applied to each
+ * element when the array is freed.
+ */
+#define VEC_DEFINE(NAME, TYPE, INL, DTOR) \
+	struct NAME { \
+		size_t cnt, max; \
+		TYPE *list; \
+		TYPE inl[INL]; \
+	}; \
+	static inline void init_##NAME(struct NAME *restrict vec) \
+	{ \
+		vec->cnt = 0; \
+		vec->max = (INL); \
+		vec->list = vec->inl; \
+	} \
+	static inline void reserve_##NAME(struct NAME *restrict vec, size_t want) \
+	{ \
+		if (!vec->list) \
+			init_##NAME(vec); \
+		if (want <= vec->max) \
+			return; \
+		size_t max = vec->max; \
+		while ((max *= 2) < want); \
+		/* spill the inline buffer to the heap */ \
+		if (vec->list == vec->inl) { \
+			xmalloc(TYPE, &vec->list, sizeof *vec->list * max, "reserve_" #NAME "()"); \
+			memcpy(vec->list, vec->inl, sizeof *vec->list * vec->cnt); \
+		} else { \
+			xrealloc(TYPE, &vec->list, sizeof *vec->list * max, "reserve_" #NAME "()"); \
+		} \
+		vec->max = max; \
+	} \
+	static inline void push_##NAME(struct NAME *restrict vec, TYPE elem) \
+	{ \
+		reserve_##NAME(vec, vec->cnt + 1); \
+		vec->list[vec->cnt++] = elem; \
+	} \
+	static inline void extend_##NAME(struct NAME *restrict vec, TYPE const *restrict elems, size_t nmemb) \
+	{ \
+		reserve_##NAME(vec, vec->cnt + nmemb); \
+		if (nmemb) \
+			memcpy(vec->list + vec->cnt, elems, sizeof *elems * nmemb); \
+		vec->cnt += nmemb; \
+	} \
+	static inline void truncate_##NAME(struct NAME *restrict vec, size_t cnt) \
+	{ \
+		for (; vec->cnt > cnt; vec->cnt--) \
+			DTOR(vec->list[vec->cnt - 1]); \
+	} \
+	static inline ptrdiff_t free_##NAME(struct NAME *restrict vec) \
+	{ \
+		/* return -1 if never allocated */ \
+		if (!vec || !vec->list) \
+			return -1; \
+		ptrdiff_t cnt = vec->cnt; \
+		for (size_t i = 0; i < vec->cnt; i++) \
+			DTOR(vec->list[i]); \
+		if (vec->list != vec->inl) \
+			free(vec->list); \
+		vec->list = NULL; \
+		vec->cnt = vec->max = 0; \
+		return cnt; \
+	}
+
+/* struct definition for var-tracking array element */
+struct var_entry {
+	/* interned identifier and the history line count when it was declared */
+	size_t id, line;
+	/* index of the entry this one shadows or -1 */
+	ptrdiff_t shadow;
+	enum var_type type_spec;
+};
+
+/* struct definition for id map slot (id 0 is empty) */
+struct id_slot {
+	size_t id, idx;
+};
+
+/* struct definition for open-addressed hash map of nonzero id to index */
+struct id_map {
+	size_t cnt, slots;
+	struct id_slot *table;
+};
+
+/* NULL-terminated string dynamic array */
+VEC_DEFINE(str_list, char *, 16, free)
+/* interned string handle dynamic array */
+VEC_DEFINE(id_list, size_t, 16, NO_DTOR)
+/* flag dynamic array */
+VEC_DEFINE(flag_list, enum src_flag, 32, NO_DTOR)
+/* type dynamic array */
+VEC_DEFINE(type_list, enum var_type, 16, NO_DTOR)
+/* var-tracking array */
+VEC_DEFINE(var_list, struct var_entry, 16, NO_DTOR)
+/* offset/length dynamic array */
+VEC_DEFINE(size_list, size_t, 32, NO_DTOR)
+/* character dynamic array */
+VEC_DEFINE(char_list, char, 256, NO_DTOR)
+
+/*
+ * struct definition for interned string pool
+ *
+ * strings are stored once, NUL-separated, in one contiguous
+ * buffer and referred to by their byte offset into it; offset
+ * 0 is the empty string and doubles as the "no string" handle
+ */
+struct str_pool {
+	size_t len, max;
+	char *buf;
+	/* open-addressed index of offsets (0 is an empty slot) */
+	size_t cnt, slots;
+	size_t *index;
+};
+
+/* struct definition for a distinct line in the history search index */
+struct search_line {
+	/* line handle in the index's `text` pool, when it was last entered, and the `last` its postings carry (0 if unposted) */
+	size_t id, last, posted;
+	/* whether it last compiled and ran with exit status 0 */
+	bool ok;
+};
+
+/* struct definition for a link in a trigram's posting chain, newest first (`next` is a posting index + 1 or 0) */
+struct search_post {
+	/* `last` of the line when posted, so postings of lines entered again since are stale */
+	uint32_t line, next, seq;
+};
+
+/* struct definition for the newest posting of a trigram and how many postings in its chain are live */
+struct search_tri {
+	size_t head, cnt;
+};
+
+/* history search line array */
+VEC_DEFINE(search_line_list, struct search_line, 16, NO_DTOR)
+/* trigram posting array */
+VEC_DEFINE(search_post_list, struct search_post, 64, NO_DTOR)
+/* trigram chain array */
+VEC_DEFINE(search_tri_list, struct search_tri, 64, NO_DTOR)
+
+/* struct definition for the trigram index over history lines */
+struct hist_search {
+	/* every distinct line, freed with the index */
+	struct str_pool text;
+	struct search_line_list lines;
+	/* `text` handle to its index in `lines` */
+	struct id_map line_map;
+	/* trigram + 1 to its index in `tris` */
+	struct id_map tri_map;
+	struct search_tri_list tris;
+	struct search_post_list posts;
+	/* lines entered since the last search, waiting to be posted (`next` is unused) */
+	struct search_post_list pending;
+	/* last `last` handed out and postings left behind by lines posted again */
+	size_t seq, stale;
+};
+
+/* struct definition for history deduplication (lines are keyed by their own hash) */
+struct hist_index {
+	/* line hash to the sequence number stored in its entry's `data` */
+	struct id_map map;
+	/* last sequence number handed out */
+	size_t seq;
+	/* trigram index over every distinct line */
+	struct hist_search search;
+};
+
+/* kinds of type described by debug info */
+enum dwarf_kind {
+	K_VOID, K_BASE, K_PTR, K_ARRAY,
+	K_STRUCT, K_UNION, K_ENUM, K_FUNC,
+	K_TYPEDEF, K_QUAL, K_VECTOR,
+};
+
+/* where a variable lives */
+enum dwarf_loc {
+	LOC_NONE, LOC_FRAME, LOC_ADDR,
+};
+
+/* struct definition for a debug info type */
+struct dwarf_type {
+	enum dwarf_kind kind;
+	/* `DW_ATE_*` encoding of base types */
+	unsigned enc;
+	/* name in `dwarf_info.names` (0 if anonymous), byte size, and element count of arrays */
+	size_t name, size, cnt;
+	/* index of the pointee/element/aliased type or -1 for `void` */
+	ptrdiff_t base;
+	/* range of struct/union members in `dwarf_info.membs` */
+	size_t memb_off, memb_cnt;
+};
+
+/* struct definition for a struct/union member */
+struct dwarf_member {
+	size_t name, off;
+	/* non-zero for bit-fields */
+	unsigned bit_off, bit_size;
+	ptrdiff_t type;
 };
 
-/* struct definition for NULL-terminated string dynamic array */
-struct str_list {
-	size_t cnt, max;
-	char **list;
+/* struct definition for a local variable of the inspected function or a file scope definition */
+struct dwarf_var {
+	size_t id;
+	ptrdiff_t type;
+	/* source line of the definition (0 if unknown) */
+	size_t line;
+	bool is_global;
+	enum dwarf_loc loc_type;
+	/* frame base offset or absolute address */
+	int64_t loc;
 };
 
-/* struct definition for flag dynamic array */
-struct flag_list {
-	size_t cnt, max;
-	enum src_flag *list;
+/* debug info dynamic arrays */
+VEC_DEFINE(dwarf_type_list, struct dwarf_type, 16, NO_DTOR)
+VEC_DEFINE(dwarf_memb_list, struct dwarf_member, 16, NO_DTOR)
+VEC_DEFINE(dwarf_var_list, struct dwarf_var, 16, NO_DTOR)
+
+/* struct definition for the debug info of one executable */
+struct dwarf_info {
+	struct dwarf_type_list types;
+	struct dwarf_memb_list membs;
+	struct dwarf_var_list vars;
+	/* type and member names, which live only as long as the info (variable ids are in `str_pool`) */
+	struct str_pool names;
 };
 
-/* struct definition for type dynamic array */
-struct type_list {
-	size_t cnt, max;
-	enum var_type *list;
+/* struct definition for a substring of a larger buffer */
+struct span {
+	size_t off, len;
 };
 
-/* struct definition for var-tracking array */
-struct var_list {
-	size_t cnt, max;
-	struct {
-		char *id;
-		enum var_type type_spec;
-	} *list;
+/* span dynamic array */
+VEC_DEFINE(span_list, struct span, 16, NO_DTOR)
+
+/* struct definition for a stack of strings packed into one buffer */
+struct line_list {
+	struct size_list off;
+	struct char_list text;
 };
 
 /* struct definition for program source sections */
@@ -164,7 +399,8 @@ struct source_section {
 /* struct definition for generated program sources */
 struct source_code {
 	struct source_section body, funcs, total;
-	struct str_list hist, lines;
+	struct size_list hist;
+	struct line_list lines;
 	struct flag_list flags;
 };
 
@@ -174,6 +410,16 @@ struct state_flags {
 	bool exec_flag, parse_flag;
 	bool track_flag, warn_flag;
 	bool in_flag, out_flag, hist_flag;
+	bool simd_flag;
+};
+
+/* struct definition for array display limits */
+struct dump_opts {
+	/* elements shown from the front and back, and the step between them */
+	size_t head, tail, stride;
+	/* lane view of vector types ('i', 'u', 'f', or 'x' and the lane size, 0 for the declared one) */
+	char lane_kind;
+	size_t lane_size;
 };
 
 /* standard io stream state state */
@@ -190,10 +436,23 @@ struct program {
 	char *cur_line, *hist_file;
 	char *out_filename, *asm_filename;
 	struct str_list cc_list, ld_list;
-	struct str_list lib_list, sym_list;
-	struct str_list id_list;
+	struct str_list lib_list;
+	struct id_list sym_list, id_list;
+	/* identifiers the current line mentions */
+	struct id_list touch_list;
 	struct type_list type_list;
-	struct var_list var_list;
+	struct var_list var_list, typedef_list;
+	/* identifier to its visible `var_list`/`typedef_list` index */
+	struct id_map var_map, typedef_map;
+	struct dwarf_info dwarf;
+	/* debug build `dwarf` was read from and a hash of what built it (0 if none), so an unchanged session is reused */
+	int dwarf_fd;
+	uint64_t dwarf_key;
+	/* `trace_vars()` child to kill if ^C abandons it */
+	pid_t trace_pid;
+	struct dump_opts dump_opts;
+	/* show every tracked variable instead of only the touched ones */
+	bool dump_all;
 	struct source_code src[2];
 	struct state_flags sflags;
 	struct termio_state tty_state;
@@ -269,12 +528,11 @@ static inline void strmv(ptrdiff_t off, char *restrict dest, char const *restric
 		ERRX("%s", "NULL pointer passed to strmv()");
 	ptrdiff_t src_sz;
 	char *dest_ptr = dest;
-	char const *src_end = src;
-	/* find the end of the source string */
-	for (size_t i = 0; i < EVAL_LIMIT && *src_end; i++, src_end++);
+	/* find the end of the source string (libc scans this a word at a time) */
+	char const *src_end = src + strnlen(src, EVAL_LIMIT);
 	/* find the end of the desitnation string if offset is negative */
 	if (off < 0)
-		for (size_t i = 0; i < EVAL_LIMIT && *dest_ptr; i++, dest_ptr++);
+		dest_ptr += strnlen(dest, EVAL_LIMIT);
 	else
 		dest_ptr = dest + off;
 	if (!src_end || !dest_ptr)
@@ -285,150 +543,119 @@ static inline void strmv(ptrdiff_t off, char *restrict dest, char const *restric
 	memcpy(dest_ptr, src, (size_t)src_sz + 1);
 }
 
-static inline ptrdiff_t free_str_list(struct str_list *restrict plist)
+static inline void append_str(struct str_list *restrict list_struct, char const *restrict string, size_t pad)
 {
-	size_t null_cnt = 0;
-	/* return -1 if passed NULL pointers */
-	if (!plist || !plist->list)
-		return -1;
-	for (size_t i = 0; i < plist->cnt; i++) {
-		/* if NULL increment counter and skip */
-		if (!plist->list[i]) {
-			null_cnt++;
-			continue;
-		}
-		free(plist->list[i]);
-		plist->list[i] = NULL;
+	char *str = NULL;
+	/* NULL `string` appends a terminator */
+	if (string) {
+		xcalloc(char, &str, 1, strlen(string) + pad + 1, "append_str()");
+		strmv(pad, str, string);
 	}
-	free(plist->list);
-	plist->list = NULL;
-	plist->cnt = 0;
-	plist->max = 1;
-	return null_cnt;
+	push_str_list(list_struct, str);
 }
 
-static inline void init_str_list(struct str_list *restrict list_struct, char *restrict init_str)
+/* `printf()` onto the end of a character array */
+static inline void append_fmt(struct char_list *restrict list, char const *restrict fmt, ...)
 {
-	list_struct->cnt = 0;
-	list_struct->max = 1;
-	xcalloc(char, &list_struct->list, 1, sizeof *list_struct->list, "list_ptr calloc()");
-	if (!init_str)
-		return;
-	list_struct->cnt++;
-	xcalloc(char, &list_struct->list[list_struct->cnt - 1], 1, strlen(init_str) + 1, "init_str_list()");
-	strmv(0, list_struct->list[list_struct->cnt - 1], init_str);
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	if (len < 0)
+		ERR("%s", "vsnprintf()");
+	reserve_char_list(list, list->cnt + len + 1);
+	va_start(args, fmt);
+	vsnprintf(list->list + list->cnt, len + 1, fmt, args);
+	va_end(args);
+	list->cnt += len;
 }
 
-static inline void append_str(struct str_list *restrict list_struct, char const *restrict string, size_t pad)
+static inline void append_line(struct line_list *restrict lines, char const *restrict line)
 {
-	/* sanity checks */
-	if (!list_struct->list)
-		ERRX("%s", "NULL list_struct->list passed to append_str()");
-	/* realloc if cnt reaches current size */
-	if (++list_struct->cnt >= list_struct->max) {
-		list_struct->max *= 2;
-		xrealloc(char, &list_struct->list, sizeof *list_struct->list * list_struct->max, "append_str()");
-	}
-	if (!string) {
-		list_struct->list[list_struct->cnt - 1] = NULL;
-		return;
-	}
-	xcalloc(char, &list_struct->list[list_struct->cnt - 1], 1, strlen(string) + pad + 1, "append_str()");
-	strmv(pad, list_struct->list[list_struct->cnt - 1], string);
+	push_size_list(&lines->off, lines->text.cnt);
+	extend_char_list(&lines->text, line, strlen(line) + 1);
 }
 
-static inline void init_type_list(struct type_list *restrict list_struct)
+/* only valid until the next `append_line()` */
+static inline char *line_at(struct line_list const *restrict lines, size_t idx)
 {
-	list_struct->cnt = 0;
-	list_struct->max = 1;
-	xcalloc(int, &list_struct->list, 1, sizeof *list_struct->list, "init_type_list()");
+	return lines->text.list + lines->off.list[idx];
 }
 
-static inline void append_type(struct type_list *restrict list_struct, enum var_type type_spec)
+/* drop every line from `idx` onward */
+static inline void truncate_lines(struct line_list *restrict lines, size_t idx)
 {
-	/* realloc if cnt reaches current size */
-	if (++list_struct->cnt >= list_struct->max) {
-		list_struct->max *= 2;
-		xrealloc(int, &list_struct->list, sizeof *list_struct->list * list_struct->max, "append_type()");
-	}
-	list_struct->list[list_struct->cnt - 1] = type_spec;
+	if (idx >= lines->off.cnt)
+		return;
+	lines->text.cnt = lines->off.list[idx];
+	lines->off.cnt = idx;
 }
 
-static inline void init_flag_list(struct flag_list *restrict list_struct)
+static inline void free_line_list(struct line_list *restrict lines)
 {
-	list_struct->cnt = 0;
-	list_struct->max = 1;
-	xcalloc(int, &list_struct->list, 1, sizeof *list_struct->list, "init_flag_list()");
-	list_struct->cnt++;
-	list_struct->list[list_struct->cnt - 1] = EMPTY;
+	free_size_list(&lines->off);
+	free_char_list(&lines->text);
 }
 
-static inline void append_flag(struct flag_list *restrict list_struct, enum src_flag flag)
+/* append `str[beg]` through `str[end - 1]` minus leading whitespace unless empty */
+static inline void append_span(struct span_list *restrict list_struct, char const *restrict str, size_t beg, size_t end)
 {
-	/* realloc if cnt reaches current size */
-	if (++list_struct->cnt >= list_struct->max) {
-		list_struct->max *= 2;
-		xrealloc(int, &list_struct->list, sizeof *list_struct->list * list_struct->max, "append_flag()");
-	}
-	list_struct->list[list_struct->cnt - 1] = flag;
+	while (beg < end && isspace((unsigned char)str[beg]))
+		beg++;
+	if (beg < end)
+		push_span_list(list_struct, (struct span){.off = beg, .len = end - beg});
 }
 
-static inline struct str_list strsplit(char const *restrict str)
+/* split `str` into statements, returned as spans into `str` itself */
+static inline void strsplit(struct span_list *restrict list_struct, char const *restrict str)
 {
+	init_span_list(list_struct);
 	if (!str)
-		return (struct str_list){0};
-
-	struct str_list list_struct;
-	bool str_lit = false, chr_lit = false;
-	size_t memb_cnt = 0;
-	char arr[strlen(str) + 1], *ptr = arr;
+		return;
 
-	strmv(0, ptr, str);
-	init_str_list(&list_struct, NULL);
+	size_t memb_cnt = 0, beg = 0, len = strlen(str);
 
-	for (; *ptr; ptr++) {
-		switch (*ptr) {
+	/* jump straight to the next byte that can change state */
+	for (size_t i = 0; (i += scan_split(str + i, len - i)) < len; i++) {
+		size_t end;
+		switch (str[i]) {
 		case '\\':
-			ptr++;
+			/* skip escaped character */
+			if (i + 1 < len)
+				i++;
 			break;
 
-		case '"':
-			if (!chr_lit)
-				str_lit ^= true;
+		case '"': /* fallthrough */
+		case '\'':
+			/* jump to the closing quote */
+			i = lex_skip_literal(str, len, i) - 1;
 			break;
 
-		case '\'':
-			if (!str_lit)
-				str_lit ^= true;
-			chr_lit ^= true;
+		case '/':
+			/* jump past comments (but not the newline ending a line comment) */
+			if ((end = lex_skip_comment(str, len, i)) > i)
+				i = end - 1;
 			break;
 
 		case '{':
-			if (!str_lit && !chr_lit)
-				memb_cnt++;
+			memb_cnt++;
 			break;
 
 		case '}':
-			if (!str_lit && !chr_lit && memb_cnt > 0)
+			if (memb_cnt > 0)
 				memb_cnt--;
 			break;
 
 		case ';':
 		case '\n': /* fallthrough */
-			if (!str_lit && !chr_lit && !memb_cnt)
-				*ptr = '\x1c';
+			if (!memb_cnt) {
+				append_span(list_struct, str, beg, i);
+				beg = i + 1;
+			}
 			break;
 		}
 	}
-
-	ptr = arr;
-	for (char *tmp = strtok(ptr, "\x1c"); tmp; tmp = strtok(NULL, "\x1c")) {
-		while (isspace(*tmp))
-			tmp++;
-		append_str(&list_struct, tmp, 0);
-	}
-
-	return list_struct;
+	append_span(list_struct, str, beg, len);
 }
 
 #endif /* !defined(DEFS_H) */
@@ -0,0 +1,333 @@
+/*
+ * dump.h - element-aware display of arrays and structs
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(DUMP_H)
+#define DUMP_H 1
+
+#include "defs.h"
+#include "dwarf.h"
+#include "intern.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* nesting shown before aggregates are elided */
+#define DUMP_DEPTH	3
+/* bytes read at a time while summarizing an array */
+#define DUMP_CHUNK	0x10000
+/* largest element or struct copied whole */
+#define DUMP_READ_MAX	0x100000
+/* struct definition for array summary statistics */
+struct dump_stats {
+	size_t cnt, nan;
+	long double min, max, sum;
+	bool is_flt;
+};
+
+/* copy `len` bytes at offset `off` of the dumped object into `buf`, returning the number copied */
+typedef size_t dump_read_fn(void *ctx, void *buf, uint64_t off, size_t len);
+
+/* struct definition for an object already in memory */
+struct dump_mem {
+	char const *buf;
+	size_t len;
+};
+
+static inline size_t dump_read_mem(void *ctx, void *buf, uint64_t off, size_t len)
+{
+	struct dump_mem const *mem = ctx;
+	if (off >= mem->len)
+		return 0;
+	len = MIN(len, mem->len - off);
+	memcpy(buf, mem->buf + off, len);
+	return len;
+}
+
+/* decode an arithmetic value, returning false for anything else */
+static inline bool dump_scalar(struct dwarf_info const *restrict info, ptrdiff_t type,
+		char const *restrict buf, size_t len, long double *restrict val, bool *restrict is_flt)
+{
+	if ((type = dwarf_strip(info, type)) < 0)
+		return false;
+	struct dwarf_type const *cur = &info->types.list[type];
+	size_t sz = cur->size;
+	uint64_t raw = 0;
+
+	if ((cur->kind != K_BASE && cur->kind != K_ENUM) || !sz || sz > len)
+		return false;
+	*is_flt = cur->kind == K_BASE && cur->enc == ATE_FLOAT;
+	if (*is_flt) {
+		if (sz == sizeof(float)) {
+			float tmp;
+			memcpy(&tmp, buf, sizeof tmp);
+			*val = tmp;
+		} else if (sz == sizeof(double)) {
+			double tmp;
+			memcpy(&tmp, buf, sizeof tmp);
+			*val = tmp;
+		} else if (sz == sizeof(long double)) {
+			memcpy(val, buf, sizeof *val);
+		} else {
+			return false;
+		}
+		return true;
+	}
+	if (sz > sizeof raw)
+		return false;
+	memcpy(&raw, buf, sz);
+	/* enums are treated as signed */
+	bool is_signed = cur->kind == K_ENUM || cur->enc == ATE_SIGNED || cur->enc == ATE_SIGNED_CHAR;
+	if (is_signed && sz < sizeof raw)
+		*val = (int64_t)(raw << (64 - sz * 8)) >> (64 - sz * 8);
+	else if (is_signed)
+		*val = (int64_t)raw;
+	else
+		*val = raw;
+	return true;
+}
+
+static inline void dump_stats_add(struct dump_stats *restrict stats, long double val)
+{
+	if (isnan(val)) {
+		stats->nan++;
+		return;
+	}
+	if (!stats->cnt || val < stats->min)
+		stats->min = val;
+	if (!stats->cnt || val > stats->max)
+		stats->max = val;
+	stats->sum += val;
+	stats->cnt++;
+}
+
+static inline void dump_number(FILE *restrict out, long double val, bool is_flt)
+{
+	if (is_flt)
+		fprintf(out, "%Lg", val);
+	else
+		fprintf(out, "%.0Lf", val);
+}
+
+/* print the lanes of a vector as `kind` ('i', 'u', 'f', or 'x') elements `size` bytes wide, returning false if they can't be */
+static inline bool dump_lanes(FILE *restrict out, char kind, size_t size, char const *restrict buf, size_t len)
+{
+	bool is_int = size == 1 || size == 2 || size == 4 || size == 8;
+	if (!strchr("iuxf", kind) || !kind || !is_int || (kind == 'f' && size < 4) || len % size)
+		return false;
+
+	fprintf(out, "%c%zu {", kind, size * 8);
+	for (size_t off = 0; off < len; off += size) {
+		uint64_t raw = 0;
+		memcpy(&raw, buf + off, size);
+		if (off)
+			fputs(", ", out);
+		switch (kind) {
+		case 'f':
+			if (size == sizeof(float)) {
+				float tmp;
+				memcpy(&tmp, &raw, sizeof tmp);
+				fprintf(out, "%g", tmp);
+			} else {
+				double tmp;
+				memcpy(&tmp, &raw, sizeof tmp);
+				fprintf(out, "%g", tmp);
+			}
+			break;
+		case 'u':
+			fprintf(out, "%llu", (unsigned long long)raw);
+			break;
+		case 'x':
+			fprintf(out, "%#llx", (unsigned long long)raw);
+			break;
+		default:
+			/* sign extend narrower lanes */
+			fprintf(out, "%lld", (long long)(size < 8 ? (int64_t)(raw << (64 - size * 8)) >> (64 - size * 8) : (int64_t)raw));
+		}
+	}
+	fputc('}', out);
+	return true;
+}
+
+static inline void dump_value(FILE *restrict out, struct dwarf_info const *restrict info, ptrdiff_t type,
+		char const *restrict buf, size_t len, struct dump_opts const *restrict opts, unsigned depth);
+
+/* print an array through `read`, with a summary of every element if `want_stats` */
+static inline void dump_array(FILE *restrict out, struct dwarf_info const *restrict info, ptrdiff_t type,
+		dump_read_fn *read, void *ctx, struct dump_opts const *restrict opts, unsigned depth, bool want_stats)
+{
+	if ((type = dwarf_strip(info, type)) < 0 || info->types.list[type].kind != K_ARRAY) {
+		fputs("?", out);
+		return;
+	}
+	ptrdiff_t elem = info->types.list[type].base;
+	size_t cnt = info->types.list[type].cnt, elem_sz = dwarf_size(info, elem);
+	size_t stride = MAX(opts->stride, 1);
+	/* number of positions on the strided grid */
+	size_t slots = cnt ? (cnt - 1) / stride + 1 : 0;
+	size_t head = MIN(opts->head, slots), tail = MIN(opts->tail, slots - head);
+	char *elem_buf;
+
+	if (!elem_sz || elem_sz > DUMP_READ_MAX || depth >= DUMP_DEPTH) {
+		fputs("[...]", out);
+		return;
+	}
+	xmalloc(char, &elem_buf, elem_sz, "dump_array()");
+
+	fputc('[', out);
+	for (size_t i = 0; i < head + tail; i++) {
+		size_t slot = (i < head) ? i : slots - tail + (i - head);
+		if (i)
+			fputs(", ", out);
+		if (i == head && head + tail < slots)
+			fputs("..., ", out);
+		size_t got = read(ctx, elem_buf, (uint64_t)slot * stride * elem_sz, elem_sz);
+		if (got < elem_sz)
+			fputs("?", out);
+		else
+			dump_value(out, info, elem, elem_buf, elem_sz, opts, depth + 1);
+	}
+	if (!tail && head < slots)
+		fputs(head ? ", ..." : "...", out);
+	fputc(']', out);
+	free(elem_buf);
+
+	/* summaries cover every element, not just the ones shown */
+	long double val;
+	struct dump_stats stats = {0};
+	char *chunk;
+	if (!want_stats || cnt < 2 || elem_sz > sizeof(long double))
+		return;
+	xmalloc(char, &chunk, DUMP_CHUNK, "dump_array()");
+	size_t per_chunk = DUMP_CHUNK / elem_sz;
+	for (size_t beg = 0; beg < cnt; beg += per_chunk) {
+		size_t want = MIN(per_chunk, cnt - beg) * elem_sz;
+		size_t got = read(ctx, chunk, (uint64_t)beg * elem_sz, want);
+		for (size_t off = 0; off + elem_sz <= got; off += elem_sz) {
+			if (!dump_scalar(info, elem, chunk + off, elem_sz, &val, &stats.is_flt))
+				goto done;
+			dump_stats_add(&stats, val);
+		}
+		if (got < want)
+			break;
+	}
+	fprintf(out, " (%zu elements", cnt);
+	if (stats.cnt) {
+		fputs(", min ", out);
+		dump_number(out, stats.min, stats.is_flt);
+		fputs(", max ", out);
+		dump_number(out, stats.max, stats.is_flt);
+		fputs(", sum ", out);
+		dump_number(out, stats.sum, stats.is_flt);
+	}
+	if (stats.nan)
+		fprintf(out, ", %zu nan", stats.nan);
+	fputc(')', out);
+done:
+	free(chunk);
+}
+
+/* print the members of a struct or union */
+static inline void dump_members(FILE *restrict out, struct dwarf_info const *restrict info, struct dwarf_type const *restrict agg,
+		char const *restrict buf, size_t len, struct dump_opts const *restrict opts, unsigned depth)
+{
+	if (depth >= DUMP_DEPTH) {
+		fputs("{...}", out);
+		return;
+	}
+	fputc('{', out);
+	for (size_t i = 0; i < agg->memb_cnt; i++) {
+		struct dwarf_member const *memb = &info->membs.list[agg->memb_off + i];
+		size_t sz = dwarf_size(info, memb->type);
+		if (i)
+			fputs(", ", out);
+		if (memb->name)
+			fprintf(out, ".%s = ", pool_str(&info->names, memb->name));
+		/* bit-fields are shifted down into a scratch copy */
+		if (memb->bit_size) {
+			uint64_t raw = 0;
+			long double val;
+			bool is_flt;
+			memcpy(&raw, buf + memb->off, MIN(len - MIN(len, memb->off), sizeof raw));
+			raw = (raw >> memb->bit_off) & ((memb->bit_size < 64) ? ((uint64_t)1 << memb->bit_size) - 1 : ~(uint64_t)0);
+			char tmp[sizeof raw];
+			memcpy(tmp, &raw, sizeof tmp);
+			if (memb->off < len && dump_scalar(info, memb->type, tmp, sizeof tmp, &val, &is_flt)) {
+				/* sign extend signed fields */
+				if (val >= (long double)((uint64_t)1 << (memb->bit_size - 1)) && memb->bit_size < 64) {
+					ptrdiff_t base = dwarf_strip(info, memb->type);
+					if (base >= 0 && info->types.list[base].enc == ATE_SIGNED)
+						val -= (long double)((uint64_t)1 << memb->bit_size);
+				}
+				dump_number(out, val, false);
+			} else {
+				fputs("?", out);
+			}
+			continue;
+		}
+		if (memb->off > len || sz > len - memb->off)
+			fputs("?", out);
+		else
+			dump_value(out, info, memb->type, buf + memb->off, sz, opts, depth + 1);
+	}
+	fputc('}', out);
+}
+
+/* print a value already in memory */
+static inline void dump_value(FILE *restrict out, struct dwarf_info const *restrict info, ptrdiff_t type,
+		char const *restrict buf, size_t len, struct dump_opts const *restrict opts, unsigned depth)
+{
+	long double val;
+	bool is_flt;
+	uint64_t raw = 0;
+
+	if ((type = dwarf_strip(info, type)) < 0) {
+		fputs("?", out);
+		return;
+	}
+	struct dwarf_type const *cur = &info->types.list[type];
+
+	switch (cur->kind) {
+	case K_PTR:
+		memcpy(&raw, buf, MIN(len, sizeof raw));
+		fprintf(out, "%p", (void *)(uintptr_t)raw);
+		break;
+	case K_STRUCT: /* fallthrough */
+	case K_UNION:
+		dump_members(out, info, cur, buf, len, opts, depth);
+		break;
+	case K_VECTOR:
+		/* an explicit lane view wins over the declared element type */
+		if (opts->lane_kind && dump_lanes(out, opts->lane_kind, opts->lane_size, buf, len))
+			break;
+		if (!dump_lanes(out, dwarf_lane_kind(info, cur->base), dwarf_size(info, cur->base), buf, len))
+			dump_lanes(out, 'x', 1, buf, len);
+		break;
+	case K_ARRAY:
+		/* character arrays print as strings */
+		if (dwarf_is_char(info, cur->base)) {
+			fprintf(out, "\"%.*s\"", (int)strnlen(buf, len), buf);
+		} else {
+			struct dump_mem mem = {buf, len};
+			dump_array(out, info, type, dump_read_mem, &mem, opts, depth, false);
+		}
+		break;
+	default:
+		if (!dump_scalar(info, type, buf, len, &val, &is_flt)) {
+			fputs("?", out);
+			break;
+		}
+		/* plain `char` prints as a character */
+		if (cur->kind == K_BASE && cur->size == 1 && cur->name && !strcmp(pool_str(&info->names, cur->name), "char"))
+			fprintf(out, "'%c'", (char)val);
+		else
+			dump_number(out, val, is_flt);
+	}
+}
+
+#endif /* !defined(DUMP_H) */
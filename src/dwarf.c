@@ -0,0 +1,903 @@
+/*
+ * dwarf.c - minimal DWARF 2-5 `.debug_info` reader
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "dwarf.h"
+#include <gelf.h>
+#include <libelf.h>
+
+/* tags */
+#define TAG_ARRAY		0x01
+#define TAG_CLASS		0x02
+#define TAG_ENUM		0x04
+#define TAG_MEMBER		0x0d
+#define TAG_POINTER		0x0f
+#define TAG_REFERENCE		0x10
+#define TAG_STRUCT		0x13
+#define TAG_SUBROUTINE		0x15
+#define TAG_TYPEDEF		0x16
+#define TAG_UNION		0x17
+#define TAG_SUBRANGE		0x21
+#define TAG_BASE		0x24
+#define TAG_CONST		0x26
+#define TAG_SUBPROGRAM		0x2e
+#define TAG_VARIABLE		0x34
+#define TAG_VOLATILE		0x35
+#define TAG_RESTRICT		0x37
+#define TAG_UNSPECIFIED		0x3b
+#define TAG_RVALUE_REF		0x42
+#define TAG_ATOMIC		0x47
+/* attributes */
+#define AT_LOCATION		0x02
+#define AT_NAME			0x03
+#define AT_BYTE_SIZE		0x0b
+#define AT_BIT_OFFSET		0x0c
+#define AT_BIT_SIZE		0x0d
+#define AT_UPPER_BOUND		0x2f
+#define AT_COUNT		0x37
+#define AT_MEMBER_LOCATION	0x38
+#define AT_DECL_LINE		0x3b
+#define AT_DECLARATION		0x3c
+#define AT_ENCODING		0x3e
+#define AT_TYPE			0x49
+#define AT_DATA_BIT_OFFSET	0x6b
+#define AT_STR_OFFSETS_BASE	0x72
+#define AT_GNU_VECTOR		0x2107
+/* forms */
+#define FORM_ADDR		0x01
+#define FORM_BLOCK2		0x03
+#define FORM_BLOCK4		0x04
+#define FORM_DATA2		0x05
+#define FORM_DATA4		0x06
+#define FORM_DATA8		0x07
+#define FORM_STRING		0x08
+#define FORM_BLOCK		0x09
+#define FORM_BLOCK1		0x0a
+#define FORM_DATA1		0x0b
+#define FORM_FLAG		0x0c
+#define FORM_SDATA		0x0d
+#define FORM_STRP		0x0e
+#define FORM_UDATA		0x0f
+#define FORM_REF_ADDR		0x10
+#define FORM_REF1		0x11
+#define FORM_REF2		0x12
+#define FORM_REF4		0x13
+#define FORM_REF8		0x14
+#define FORM_REF_UDATA		0x15
+#define FORM_INDIRECT		0x16
+#define FORM_SEC_OFFSET		0x17
+#define FORM_EXPRLOC		0x18
+#define FORM_FLAG_PRESENT	0x19
+#define FORM_STRX		0x1a
+#define FORM_ADDRX		0x1b
+#define FORM_REF_SUP4		0x1c
+#define FORM_STRP_SUP		0x1d
+#define FORM_DATA16		0x1e
+#define FORM_LINE_STRP		0x1f
+#define FORM_REF_SIG8		0x20
+#define FORM_IMPLICIT_CONST	0x21
+#define FORM_LOCLISTX		0x22
+#define FORM_RNGLISTX		0x23
+#define FORM_REF_SUP8		0x24
+#define FORM_STRX1		0x25
+#define FORM_STRX2		0x26
+#define FORM_STRX3		0x27
+#define FORM_STRX4		0x28
+#define FORM_ADDRX1		0x29
+#define FORM_ADDRX2		0x2a
+#define FORM_ADDRX3		0x2b
+#define FORM_ADDRX4		0x2c
+/* location expression opcodes */
+#define OP_ADDR			0x03
+#define OP_PLUS_UCONST		0x23
+#define OP_FBREG		0x91
+/* unit types */
+#define UT_COMPILE		0x01
+#define UT_PARTIAL		0x03
+/* max tracked DIE nesting */
+#define DIE_DEPTH		0x40
+
+/* struct definition for a bounded byte cursor */
+struct cursor {
+	unsigned char const *pos, *end;
+};
+
+/* struct definition for a raw section */
+struct section {
+	unsigned char const *buf;
+	size_t len;
+};
+
+/* struct definition for the sections the reader needs */
+struct sections {
+	struct section info, abbrev, str, line_str, str_offs;
+};
+
+/* struct definition for an abbreviation attribute spec */
+struct attr_spec {
+	uint64_t name, form;
+	int64_t implicit;
+};
+
+/* struct definition for an abbreviation */
+struct abbrev {
+	uint64_t code, tag;
+	bool children;
+	size_t attr_off, attr_cnt;
+};
+
+/* struct definition for per-unit decoding state */
+struct unit {
+	struct sections const *sect;
+	size_t off, str_base;
+	unsigned version, off_sz, addr_sz;
+};
+
+/* struct definition for a decoded attribute value */
+struct attr_val {
+	uint64_t num;
+	char const *str;
+	struct cursor blk;
+	bool is_ref, is_blk;
+};
+
+/* struct definition for the attributes the reader cares about */
+struct die {
+	uint64_t tag;
+	char const *name;
+	uint64_t byte_size, enc, type, bound, count, memb_off, bit_off, bit_size, data_bit_off, decl_line;
+	bool has_type, has_bound, has_count, has_bit_off, has_data_bit_off, is_decl, is_vec;
+	struct cursor loc;
+};
+
+/* struct definition for a DIE offset to `types` index mapping */
+struct die_ref {
+	size_t off, idx;
+};
+
+/* struct definition for a reference waiting on every type to be seen */
+struct fixup {
+	enum { FIX_TYPE, FIX_MEMB, FIX_VAR } table;
+	size_t idx, off;
+};
+
+/* struct definition for a parent DIE */
+struct scope {
+	uint64_t tag;
+	ptrdiff_t type;
+	bool is_func;
+};
+
+VEC_DEFINE(abbrev_list, struct abbrev, 64, NO_DTOR)
+VEC_DEFINE(attr_spec_list, struct attr_spec, 256, NO_DTOR)
+VEC_DEFINE(die_ref_list, struct die_ref, 64, NO_DTOR)
+VEC_DEFINE(fixup_list, struct fixup, 64, NO_DTOR)
+/* parallel to `dwarf_memb_list` */
+VEC_DEFINE(owner_list, size_t, 16, NO_DTOR)
+
+static inline uint64_t get_uint(struct cursor *restrict cur, size_t sz)
+{
+	uint64_t val = 0;
+	if ((size_t)(cur->end - cur->pos) < sz) {
+		cur->pos = cur->end;
+		return 0;
+	}
+	/* target and host byte order are the same */
+	for (size_t i = 0; i < sz && i < sizeof val; i++)
+		val |= (uint64_t)cur->pos[i] << (i * 8);
+	cur->pos += sz;
+	return val;
+}
+
+static inline uint64_t get_uleb(struct cursor *restrict cur)
+{
+	uint64_t val = 0;
+	for (unsigned shift = 0; cur->pos < cur->end; shift += 7) {
+		unsigned char byte = *cur->pos++;
+		if (shift < 64)
+			val |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			break;
+	}
+	return val;
+}
+
+static inline int64_t get_sleb(struct cursor *restrict cur)
+{
+	uint64_t val = 0;
+	for (unsigned shift = 0; cur->pos < cur->end;) {
+		unsigned char byte = *cur->pos++;
+		if (shift < 64)
+			val |= (uint64_t)(byte & 0x7f) << shift;
+		shift += 7;
+		if (!(byte & 0x80)) {
+			/* sign extend */
+			if (shift < 64 && (byte & 0x40))
+				val |= -((uint64_t)1 << shift);
+			break;
+		}
+	}
+	return (int64_t)val;
+}
+
+/* return the NUL-terminated string at `off` or NULL if out of bounds */
+static inline char const *sect_str(struct section const *restrict sect, uint64_t off)
+{
+	if (!sect->buf || off >= sect->len || !memchr(sect->buf + off, 0, sect->len - off))
+		return NULL;
+	return (char const *)sect->buf + off;
+}
+
+static inline char const *strx_str(struct unit const *restrict unit, uint64_t idx)
+{
+	struct cursor cur = {unit->sect->str_offs.buf, unit->sect->str_offs.buf + unit->sect->str_offs.len};
+	/* assume a 32-bit table header if the unit didn't give a base */
+	size_t base = unit->str_base ? unit->str_base : 8;
+	if (!cur.pos || base + (idx + 1) * unit->off_sz > unit->sect->str_offs.len)
+		return NULL;
+	cur.pos += base + idx * unit->off_sz;
+	return sect_str(&unit->sect->str, get_uint(&cur, unit->off_sz));
+}
+
+/* decode one attribute value, returning false on malformed input */
+static bool read_form(struct unit const *restrict unit, struct cursor *restrict cur,
+		uint64_t form, int64_t implicit, struct attr_val *restrict val)
+{
+	size_t blk_sz = 0;
+	*val = (struct attr_val){0};
+
+	switch (form) {
+	case FORM_ADDR:
+		val->num = get_uint(cur, unit->addr_sz);
+		break;
+	case FORM_DATA1: /* fallthrough */
+	case FORM_FLAG:
+		val->num = get_uint(cur, 1);
+		break;
+	case FORM_DATA2:
+		val->num = get_uint(cur, 2);
+		break;
+	case FORM_DATA4:
+		val->num = get_uint(cur, 4);
+		break;
+	case FORM_DATA8: /* fallthrough */
+	case FORM_REF_SIG8:
+		val->num = get_uint(cur, 8);
+		break;
+	case FORM_DATA16:
+		get_uint(cur, 16);
+		break;
+	case FORM_SDATA:
+		val->num = (uint64_t)get_sleb(cur);
+		break;
+	case FORM_UDATA: /* fallthrough */
+	case FORM_ADDRX: /* fallthrough */
+	case FORM_LOCLISTX: /* fallthrough */
+	case FORM_RNGLISTX:
+		val->num = get_uleb(cur);
+		break;
+	case FORM_IMPLICIT_CONST:
+		val->num = (uint64_t)implicit;
+		break;
+	case FORM_FLAG_PRESENT:
+		val->num = 1;
+		break;
+	case FORM_SEC_OFFSET: /* fallthrough */
+	case FORM_STRP_SUP:
+		val->num = get_uint(cur, unit->off_sz);
+		break;
+	case FORM_ADDRX1: /* fallthrough */
+	case FORM_ADDRX2: /* fallthrough */
+	case FORM_ADDRX3: /* fallthrough */
+	case FORM_ADDRX4:
+		val->num = get_uint(cur, form - FORM_ADDRX1 + 1);
+		break;
+
+	/* strings */
+	case FORM_STRING: {
+			unsigned char const *nul = memchr(cur->pos, 0, cur->end - cur->pos);
+			if (!nul)
+				return false;
+			val->str = (char const *)cur->pos;
+			cur->pos = nul + 1;
+			break;
+		}
+	case FORM_STRP:
+		val->str = sect_str(&unit->sect->str, get_uint(cur, unit->off_sz));
+		break;
+	case FORM_LINE_STRP:
+		val->str = sect_str(&unit->sect->line_str, get_uint(cur, unit->off_sz));
+		break;
+	case FORM_STRX:
+		val->str = strx_str(unit, get_uleb(cur));
+		break;
+	case FORM_STRX1: /* fallthrough */
+	case FORM_STRX2: /* fallthrough */
+	case FORM_STRX3: /* fallthrough */
+	case FORM_STRX4:
+		val->str = strx_str(unit, get_uint(cur, form - FORM_STRX1 + 1));
+		break;
+
+	/* unit-relative references are made section-relative */
+	case FORM_REF1:
+		val->num = unit->off + get_uint(cur, 1);
+		val->is_ref = true;
+		break;
+	case FORM_REF2:
+		val->num = unit->off + get_uint(cur, 2);
+		val->is_ref = true;
+		break;
+	case FORM_REF4:
+		val->num = unit->off + get_uint(cur, 4);
+		val->is_ref = true;
+		break;
+	case FORM_REF8:
+		val->num = unit->off + get_uint(cur, 8);
+		val->is_ref = true;
+		break;
+	case FORM_REF_UDATA:
+		val->num = unit->off + get_uleb(cur);
+		val->is_ref = true;
+		break;
+	case FORM_REF_ADDR:
+		/* DWARF 2 used the address size here */
+		val->num = get_uint(cur, (unit->version < 3) ? unit->addr_sz : unit->off_sz);
+		val->is_ref = true;
+		break;
+	/* supplementary object files aren't followed */
+	case FORM_REF_SUP4:
+		get_uint(cur, 4);
+		break;
+	case FORM_REF_SUP8:
+		get_uint(cur, 8);
+		break;
+
+	/* blocks */
+	case FORM_BLOCK1:
+		blk_sz = get_uint(cur, 1);
+		goto block;
+	case FORM_BLOCK2:
+		blk_sz = get_uint(cur, 2);
+		goto block;
+	case FORM_BLOCK4:
+		blk_sz = get_uint(cur, 4);
+		goto block;
+	case FORM_BLOCK: /* fallthrough */
+	case FORM_EXPRLOC:
+		blk_sz = get_uleb(cur);
+	block:
+		if (blk_sz > (size_t)(cur->end - cur->pos))
+			return false;
+		val->blk = (struct cursor){cur->pos, cur->pos + blk_sz};
+		val->is_blk = true;
+		cur->pos += blk_sz;
+		break;
+
+	case FORM_INDIRECT:
+		return read_form(unit, cur, get_uleb(cur), implicit, val);
+
+	/* unknown forms can't be skipped */
+	default:
+		return false;
+	}
+
+	return cur->pos <= cur->end;
+}
+
+/* parse the abbreviation table at `off` */
+static bool read_abbrevs(struct section const *restrict sect, size_t off,
+		struct abbrev_list *restrict abbrevs, struct attr_spec_list *restrict specs)
+{
+	if (off >= sect->len)
+		return false;
+	struct cursor cur = {sect->buf + off, sect->buf + sect->len};
+
+	truncate_abbrev_list(abbrevs, 0);
+	truncate_attr_spec_list(specs, 0);
+	while (cur.pos < cur.end) {
+		struct abbrev ab = {.code = get_uleb(&cur)};
+		/* a zero code ends the table */
+		if (!ab.code)
+			return true;
+		ab.tag = get_uleb(&cur);
+		ab.children = get_uint(&cur, 1);
+		ab.attr_off = specs->cnt;
+		for (;;) {
+			struct attr_spec spec = {.name = get_uleb(&cur), .form = get_uleb(&cur)};
+			if (!spec.name && !spec.form)
+				break;
+			if (cur.pos >= cur.end)
+				return false;
+			if (spec.form == FORM_IMPLICIT_CONST)
+				spec.implicit = get_sleb(&cur);
+			push_attr_spec_list(specs, spec);
+		}
+		ab.attr_cnt = specs->cnt - ab.attr_off;
+		push_abbrev_list(abbrevs, ab);
+	}
+	return false;
+}
+
+static inline struct abbrev const *find_abbrev(struct abbrev_list const *restrict abbrevs, uint64_t code)
+{
+	/* codes are almost always assigned sequentially from one */
+	if (code - 1 < abbrevs->cnt && abbrevs->list[code - 1].code == code)
+		return &abbrevs->list[code - 1];
+	for (size_t i = 0; i < abbrevs->cnt; i++) {
+		if (abbrevs->list[i].code == code)
+			return &abbrevs->list[i];
+	}
+	return NULL;
+}
+
+/* decode the attributes of one DIE */
+static bool read_die(struct unit *restrict unit, struct cursor *restrict cur,
+		struct abbrev const *restrict ab, struct attr_spec const *restrict specs, struct die *restrict die)
+{
+	*die = (struct die){.tag = ab->tag};
+
+	for (size_t i = 0; i < ab->attr_cnt; i++) {
+		struct attr_spec const *spec = &specs[ab->attr_off + i];
+		struct attr_val val;
+		if (!read_form(unit, cur, spec->form, spec->implicit, &val))
+			return false;
+
+		switch (spec->name) {
+		case AT_NAME:
+			die->name = val.str;
+			break;
+		case AT_BYTE_SIZE:
+			die->byte_size = val.num;
+			break;
+		case AT_ENCODING:
+			die->enc = val.num;
+			break;
+		case AT_TYPE:
+			die->type = val.num;
+			die->has_type = val.is_ref;
+			break;
+		case AT_UPPER_BOUND:
+			/* variable length arrays have non-constant bounds */
+			die->bound = val.num;
+			die->has_bound = !val.is_ref && !val.is_blk;
+			break;
+		case AT_COUNT:
+			die->count = val.num;
+			die->has_count = !val.is_ref && !val.is_blk;
+			break;
+		case AT_MEMBER_LOCATION:
+			/* older producers emit `DW_OP_plus_uconst <off>` */
+			if (val.is_blk) {
+				if (val.blk.pos < val.blk.end && *val.blk.pos == OP_PLUS_UCONST) {
+					val.blk.pos++;
+					die->memb_off = get_uleb(&val.blk);
+				}
+			} else {
+				die->memb_off = val.num;
+			}
+			break;
+		case AT_BIT_OFFSET:
+			die->bit_off = val.num;
+			die->has_bit_off = true;
+			break;
+		case AT_DATA_BIT_OFFSET:
+			die->data_bit_off = val.num;
+			die->has_data_bit_off = true;
+			break;
+		case AT_BIT_SIZE:
+			die->bit_size = val.num;
+			break;
+		case AT_DECL_LINE:
+			die->decl_line = val.num;
+			break;
+		case AT_DECLARATION:
+			die->is_decl = val.num;
+			break;
+		case AT_LOCATION:
+			if (val.is_blk)
+				die->loc = val.blk;
+			break;
+		case AT_STR_OFFSETS_BASE:
+			unit->str_base = val.num;
+			break;
+		case AT_GNU_VECTOR:
+			die->is_vec = val.num;
+			break;
+		}
+	}
+
+	return true;
+}
+
+/* map a type DIE tag to its kind, returning false for non-type tags */
+static inline bool type_kind(uint64_t tag, enum dwarf_kind *restrict kind)
+{
+	switch (tag) {
+	case TAG_BASE:
+		*kind = K_BASE;
+		return true;
+	case TAG_UNSPECIFIED:
+		*kind = K_VOID;
+		return true;
+	case TAG_POINTER: /* fallthrough */
+	case TAG_REFERENCE: /* fallthrough */
+	case TAG_RVALUE_REF:
+		*kind = K_PTR;
+		return true;
+	case TAG_ARRAY:
+		*kind = K_ARRAY;
+		return true;
+	case TAG_CLASS: /* fallthrough */
+	case TAG_STRUCT:
+		*kind = K_STRUCT;
+		return true;
+	case TAG_UNION:
+		*kind = K_UNION;
+		return true;
+	case TAG_ENUM:
+		*kind = K_ENUM;
+		return true;
+	case TAG_SUBROUTINE:
+		*kind = K_FUNC;
+		return true;
+	case TAG_TYPEDEF:
+		*kind = K_TYPEDEF;
+		return true;
+	case TAG_CONST: /* fallthrough */
+	case TAG_VOLATILE: /* fallthrough */
+	case TAG_RESTRICT: /* fallthrough */
+	case TAG_ATOMIC:
+		*kind = K_QUAL;
+		return true;
+	}
+	return false;
+}
+
+/* decode a `DW_OP_fbreg`/`DW_OP_addr` location */
+static inline void var_loc(struct unit const *restrict unit, struct cursor loc, struct dwarf_var *restrict var)
+{
+	var->loc_type = LOC_NONE;
+	if (loc.pos >= loc.end)
+		return;
+	switch (*loc.pos++) {
+	case OP_FBREG:
+		var->loc = get_sleb(&loc);
+		var->loc_type = LOC_FRAME;
+		break;
+	case OP_ADDR:
+		var->loc = (int64_t)get_uint(&loc, unit->addr_sz);
+		var->loc_type = LOC_ADDR;
+		break;
+	}
+}
+
+/* walk one unit's DIE tree */
+static bool read_unit(struct dwarf_info *restrict info, struct unit *restrict unit, struct cursor *restrict cur,
+		struct abbrev_list const *restrict abbrevs, struct attr_spec_list const *restrict specs,
+		struct die_ref_list *restrict refs, struct fixup_list *restrict fixups,
+		struct owner_list *restrict owners, char const *restrict func)
+{
+	struct scope scopes[DIE_DEPTH] = {{0}};
+	size_t depth = 0;
+
+	while (cur->pos < cur->end) {
+		size_t die_off = cur->pos - unit->sect->info.buf;
+		uint64_t code = get_uleb(cur);
+		/* null entries close the current sibling chain */
+		if (!code) {
+			if (depth > 0)
+				depth--;
+			continue;
+		}
+
+		struct abbrev const *ab = find_abbrev(abbrevs, code);
+		struct die die;
+		if (!ab || !read_die(unit, cur, ab, specs->list, &die))
+			return false;
+
+		struct scope const *parent = (depth > 0 && depth <= DIE_DEPTH) ? &scopes[depth - 1] : NULL;
+		struct scope self = {.tag = die.tag, .type = -1};
+		enum dwarf_kind kind;
+
+		if (type_kind(die.tag, &kind)) {
+			/* `vector_size` types are arrays flagged as vectors */
+			if (kind == K_ARRAY && die.is_vec)
+				kind = K_VECTOR;
+			struct dwarf_type type = {
+				.kind = kind,
+				.enc = die.enc,
+				.name = die.name ? intern_str(&info->names, die.name) : 0,
+				.size = die.byte_size,
+				.base = -1,
+			};
+			self.type = info->types.cnt;
+			push_die_ref_list(refs, (struct die_ref){.off = die_off, .idx = self.type});
+			if (die.has_type)
+				push_fixup_list(fixups, (struct fixup){.table = FIX_TYPE, .idx = self.type, .off = die.type});
+			push_dwarf_type_list(&info->types, type);
+
+		} else if (die.tag == TAG_SUBRANGE && parent && parent->tag == TAG_ARRAY && parent->type >= 0) {
+			struct dwarf_type *arr = &info->types.list[parent->type];
+			size_t cnt = die.has_count ? die.count : die.has_bound ? die.bound + 1 : 0;
+			/* later dimensions become nested array types */
+			if (arr->memb_cnt++) {
+				/* walk to the innermost dimension seen so far */
+				ptrdiff_t inner = parent->type;
+				for (size_t i = 1; i < arr->memb_cnt - 1; i++)
+					inner = info->types.list[inner].base;
+				struct dwarf_type dim = {.kind = K_ARRAY, .cnt = cnt, .base = -1};
+				size_t idx = info->types.cnt;
+				push_dwarf_type_list(&info->types, dim);
+				/* re-point the element type fixup at the new innermost dimension */
+				for (size_t i = fixups->cnt; i > 0; i--) {
+					struct fixup *fix = &fixups->list[i - 1];
+					if (fix->table == FIX_TYPE && fix->idx == (size_t)inner) {
+						fix->idx = idx;
+						break;
+					}
+				}
+				info->types.list[inner].base = idx;
+			} else {
+				arr->cnt = cnt;
+			}
+
+		} else if (die.tag == TAG_MEMBER && parent && parent->type >= 0) {
+			struct dwarf_member memb = {
+				.name = die.name ? intern_str(&info->names, die.name) : 0,
+				.off = die.memb_off,
+				.bit_size = die.bit_size,
+				.type = -1,
+			};
+			if (die.bit_size) {
+				uint64_t bit = die.has_data_bit_off ? die.data_bit_off : memb.off * 8;
+				/* DWARF 2/3 counted bits from the most significant end */
+				if (!die.has_data_bit_off && die.has_bit_off && die.byte_size)
+					bit += die.byte_size * 8 - die.bit_off - die.bit_size;
+				memb.off = bit / 8;
+				memb.bit_off = bit % 8;
+			}
+			if (die.has_type)
+				push_fixup_list(fixups, (struct fixup){.table = FIX_MEMB, .idx = info->membs.cnt, .off = die.type});
+			push_dwarf_memb_list(&info->membs, memb);
+			push_owner_list(owners, parent->type);
+
+		} else if (die.tag == TAG_SUBPROGRAM && depth == 1 && !die.is_decl && die.name) {
+			self.is_func = !strcmp(die.name, func);
+
+		} else if (die.tag == TAG_VARIABLE && die.name && !die.is_decl && (depth == 1 || (parent && parent->is_func))) {
+			struct dwarf_var var = {.id = intern_str(&str_pool, die.name), .type = -1, .line = die.decl_line, .is_global = depth == 1};
+			var_loc(unit, die.loc, &var);
+			if (die.has_type)
+				push_fixup_list(fixups, (struct fixup){.table = FIX_VAR, .idx = info->vars.cnt, .off = die.type});
+			push_dwarf_var_list(&info->vars, var);
+		}
+
+		if (ab->children) {
+			if (depth < DIE_DEPTH)
+				scopes[depth] = self;
+			depth++;
+		}
+	}
+
+	return true;
+}
+
+/* resolve a DIE offset to a type index */
+static inline ptrdiff_t find_ref(struct die_ref_list const *restrict refs, size_t off)
+{
+	/* DIEs are visited in offset order so the list is sorted */
+	size_t lo = 0, hi = refs->cnt;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (refs->list[mid].off < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < refs->cnt && refs->list[lo].off == off) ? (ptrdiff_t)refs->list[lo].idx : -1;
+}
+
+/* resolve references and group members by their owning type */
+static void link_types(struct dwarf_info *restrict info, struct die_ref_list const *restrict refs,
+		struct fixup_list const *restrict fixups, struct owner_list const *restrict owners)
+{
+	for (size_t i = 0; i < fixups->cnt; i++) {
+		struct fixup const *fix = &fixups->list[i];
+		ptrdiff_t idx = find_ref(refs, fix->off);
+		switch (fix->table) {
+		case FIX_TYPE:
+			info->types.list[fix->idx].base = idx;
+			break;
+		case FIX_MEMB:
+			info->membs.list[fix->idx].type = idx;
+			break;
+		case FIX_VAR:
+			info->vars.list[fix->idx].type = idx;
+			break;
+		}
+	}
+
+	/* `memb_cnt` was borrowed to count array dimensions */
+	for (size_t i = 0; i < info->types.cnt; i++) {
+		info->types.list[i].memb_off = 0;
+		info->types.list[i].memb_cnt = 0;
+	}
+	if (!info->membs.cnt)
+		return;
+
+	/* stable counting sort so each type's members are contiguous */
+	struct dwarf_memb_list sorted;
+	init_dwarf_memb_list(&sorted);
+	reserve_dwarf_memb_list(&sorted, info->membs.cnt);
+	for (size_t i = 0; i < owners->cnt; i++)
+		info->types.list[owners->list[i]].memb_cnt++;
+	for (size_t i = 0, off = 0; i < info->types.cnt; i++) {
+		info->types.list[i].memb_off = off;
+		off += info->types.list[i].memb_cnt;
+		info->types.list[i].memb_cnt = 0;
+	}
+	for (size_t i = 0; i < owners->cnt; i++) {
+		struct dwarf_type *owner = &info->types.list[owners->list[i]];
+		sorted.list[owner->memb_off + owner->memb_cnt++] = info->membs.list[i];
+	}
+	sorted.cnt = info->membs.cnt;
+	truncate_dwarf_memb_list(&info->membs, 0);
+	extend_dwarf_memb_list(&info->membs, sorted.list, sorted.cnt);
+	free_dwarf_memb_list(&sorted);
+}
+
+/* walk every compilation unit in `.debug_info` */
+static bool read_units(struct dwarf_info *restrict info, struct sections const *restrict sect, char const *restrict func)
+{
+	struct abbrev_list abbrevs;
+	struct attr_spec_list specs;
+	struct die_ref_list refs;
+	struct fixup_list fixups;
+	struct owner_list owners;
+	struct cursor cur = {sect->info.buf, sect->info.buf + sect->info.len};
+	bool ret = true;
+
+	init_abbrev_list(&abbrevs);
+	init_attr_spec_list(&specs);
+	init_die_ref_list(&refs);
+	init_fixup_list(&fixups);
+	init_owner_list(&owners);
+
+	while (ret && cur.pos < cur.end) {
+		struct unit unit = {.sect = sect, .off = cur.pos - sect->info.buf, .off_sz = 4};
+		uint64_t len = get_uint(&cur, 4), abbrev_off;
+		/* 64-bit DWARF */
+		if (len == 0xffffffff) {
+			len = get_uint(&cur, 8);
+			unit.off_sz = 8;
+		}
+		if (len > (size_t)(cur.end - cur.pos)) {
+			ret = false;
+			break;
+		}
+		struct cursor body = {cur.pos, cur.pos + len};
+		cur.pos += len;
+
+		unit.version = get_uint(&body, 2);
+		if (unit.version >= 5) {
+			unsigned unit_type = get_uint(&body, 1);
+			unit.addr_sz = get_uint(&body, 1);
+			abbrev_off = get_uint(&body, unit.off_sz);
+			/* type and split units carry nothing we use */
+			if (unit_type != UT_COMPILE && unit_type != UT_PARTIAL)
+				continue;
+		} else if (unit.version >= 2) {
+			abbrev_off = get_uint(&body, unit.off_sz);
+			unit.addr_sz = get_uint(&body, 1);
+		} else {
+			continue;
+		}
+
+		if (!read_abbrevs(&sect->abbrev, abbrev_off, &abbrevs, &specs))
+			ret = false;
+		else
+			ret = read_unit(info, &unit, &body, &abbrevs, &specs, &refs, &fixups, &owners, func);
+	}
+
+	if (ret)
+		link_types(info, &refs, &fixups, &owners);
+
+	free_abbrev_list(&abbrevs);
+	free_attr_spec_list(&specs);
+	free_die_ref_list(&refs);
+	free_fixup_list(&fixups);
+	free_owner_list(&owners);
+	return ret;
+}
+
+int read_dwarf(struct dwarf_info *restrict info, int elf_fd, char const *restrict func)
+{
+	Elf *elf;
+	Elf_Scn *scn = NULL;
+	GElf_Shdr shdr;
+	size_t shstrndx;
+	struct sections sect = {{0}};
+
+	/* sanity checks */
+	if (!info || !func)
+		ERRX("%s", "NULL pointer passed to read_dwarf()");
+	if (elf_version(EV_CURRENT) == EV_NONE)
+		return -1;
+	if (!(elf = elf_begin(elf_fd, ELF_C_READ, NULL)))
+		return -1;
+	if (elf_getshdrstrndx(elf, &shstrndx)) {
+		elf_end(elf);
+		return -1;
+	}
+
+	/* locate the debug sections */
+	while ((scn = elf_nextscn(elf, scn))) {
+		struct { char const *name; struct section *sect; } const wanted[] = {
+			{".debug_info", &sect.info}, {".debug_abbrev", &sect.abbrev},
+			{".debug_str", &sect.str}, {".debug_line_str", &sect.line_str},
+			{".debug_str_offsets", &sect.str_offs},
+		};
+		if (!gelf_getshdr(scn, &shdr) || shdr.sh_type == SHT_NOBITS)
+			continue;
+		/* compressed sections aren't supported */
+		if (shdr.sh_flags & SHF_COMPRESSED)
+			continue;
+		char const *name = elf_strptr(elf, shstrndx, shdr.sh_name);
+		for (size_t i = 0; name && i < ARR_LEN(wanted); i++) {
+			Elf_Data *data;
+			if (strcmp(name, wanted[i].name) || !(data = elf_getdata(scn, NULL)))
+				continue;
+			wanted[i].sect->buf = data->d_buf;
+			wanted[i].sect->len = data->d_size;
+		}
+	}
+
+	free_dwarf(info);
+	init_dwarf(info);
+	int ret = -1;
+	if (sect.info.buf && sect.abbrev.buf && read_units(info, &sect, func))
+		ret = info->vars.cnt;
+	elf_end(elf);
+
+	return ret;
+}
+
+uint64_t find_elf_sym(int elf_fd, char const *restrict name)
+{
+	Elf *elf;
+	Elf_Scn *scn = NULL;
+	GElf_Shdr shdr;
+	uint64_t addr = 0;
+
+	/* sanity checks */
+	if (!name)
+		ERRX("%s", "NULL pointer passed to find_elf_sym()");
+	if (elf_version(EV_CURRENT) == EV_NONE)
+		return 0;
+	if (!(elf = elf_begin(elf_fd, ELF_C_READ, NULL)))
+		return 0;
+
+	while (!addr && (scn = elf_nextscn(elf, scn))) {
+		Elf_Data *data;
+		if (!gelf_getshdr(scn, &shdr) || shdr.sh_type != SHT_SYMTAB || !shdr.sh_entsize)
+			continue;
+		if (!(data = elf_getdata(scn, NULL)))
+			continue;
+		for (size_t i = 0; i < shdr.sh_size / shdr.sh_entsize; i++) {
+			GElf_Sym sym;
+			char const *cur;
+			if (!gelf_getsym(data, i, &sym) || !(cur = elf_strptr(elf, shdr.sh_link, sym.st_name)))
+				continue;
+			if (!strcmp(cur, name)) {
+				addr = sym.st_value;
+				break;
+			}
+		}
+	}
+	elf_end(elf);
+
+	return addr;
+}
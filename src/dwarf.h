@@ -0,0 +1,149 @@
+/*
+ * dwarf.h - debug info type and variable lookup
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(DWARF_H)
+#define DWARF_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include "intern.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* `DW_ATE_*` base type encodings */
+#define ATE_BOOLEAN		0x02
+#define ATE_COMPLEX		0x03
+#define ATE_FLOAT		0x04
+#define ATE_SIGNED		0x05
+#define ATE_SIGNED_CHAR		0x06
+#define ATE_UNSIGNED		0x07
+#define ATE_UNSIGNED_CHAR	0x08
+#define ATE_UTF			0x10
+
+/* prototypes (`read_dwarf()` collects the locals of `func` and every file scope definition) */
+int read_dwarf(struct dwarf_info *restrict info, int elf_fd, char const *restrict func);
+/* unrelocated address of the `.symtab` symbol `name` (0 if absent) */
+uint64_t find_elf_sym(int elf_fd, char const *restrict name);
+
+static inline void init_dwarf(struct dwarf_info *restrict info)
+{
+	init_dwarf_type_list(&info->types);
+	init_dwarf_memb_list(&info->membs);
+	init_dwarf_var_list(&info->vars);
+}
+
+static inline void free_dwarf(struct dwarf_info *restrict info)
+{
+	free_dwarf_type_list(&info->types);
+	free_dwarf_memb_list(&info->membs);
+	free_dwarf_var_list(&info->vars);
+	free_pool(&info->names);
+}
+
+/* skip typedefs and qualifiers */
+static inline ptrdiff_t dwarf_strip(struct dwarf_info const *restrict info, ptrdiff_t type)
+{
+	/* bound the walk in case of malformed cycles */
+	for (size_t i = 0; type >= 0 && (size_t)type < info->types.cnt && i < info->types.cnt; i++) {
+		enum dwarf_kind kind = info->types.list[type].kind;
+		if (kind != K_TYPEDEF && kind != K_QUAL)
+			return type;
+		type = info->types.list[type].base;
+	}
+	return ((size_t)type < info->types.cnt) ? type : -1;
+}
+
+/* byte size of a type (0 if unknown) */
+static inline size_t dwarf_size(struct dwarf_info const *restrict info, ptrdiff_t type)
+{
+	size_t mul = 1;
+	for (size_t i = 0; (type = dwarf_strip(info, type)) >= 0 && i < info->types.cnt; i++) {
+		struct dwarf_type const *cur = &info->types.list[type];
+		if ((cur->kind != K_ARRAY && cur->kind != K_VECTOR) || cur->size)
+			return mul * cur->size;
+		/* arrays only record their element count */
+		mul *= cur->cnt;
+		type = cur->base;
+	}
+	return 0;
+}
+
+/* lane kind ('i', 'u', or 'f') of a vector element type */
+static inline char dwarf_lane_kind(struct dwarf_info const *restrict info, ptrdiff_t type)
+{
+	if ((type = dwarf_strip(info, type)) < 0)
+		return 'x';
+	switch (info->types.list[type].enc) {
+	case ATE_FLOAT:
+		return 'f';
+	case ATE_BOOLEAN: /* fallthrough */
+	case ATE_UNSIGNED: /* fallthrough */
+	case ATE_UNSIGNED_CHAR:
+		return 'u';
+	default:
+		return 'i';
+	}
+}
+
+/* true for one-byte character types */
+static inline bool dwarf_is_char(struct dwarf_info const *restrict info, ptrdiff_t type)
+{
+	if ((type = dwarf_strip(info, type)) < 0)
+		return false;
+	struct dwarf_type const *cur = &info->types.list[type];
+	return cur->kind == K_BASE && cur->size == 1
+		&& (cur->enc == ATE_SIGNED_CHAR || cur->enc == ATE_UNSIGNED_CHAR);
+}
+
+/* map a debug info type onto the printable variable classes */
+static inline enum var_type dwarf_var_type(struct dwarf_info const *restrict info, ptrdiff_t type)
+{
+	if ((type = dwarf_strip(info, type)) < 0)
+		return T_ERR;
+	struct dwarf_type const *cur = &info->types.list[type];
+	char const *name = cur->name ? pool_str(&info->names, cur->name) : "";
+
+	switch (cur->kind) {
+	case K_ENUM:
+		return T_INT;
+	case K_PTR: /* fallthrough */
+	case K_ARRAY:
+		return dwarf_is_char(info, cur->base) ? T_STR : T_PTR;
+	case K_VECTOR:
+		return T_VEC;
+	case K_STRUCT: /* fallthrough */
+	case K_UNION:
+		return T_OTHER;
+	case K_BASE:
+		/* `__int128` and friends don't fit the printers' casts */
+		if (cur->size > sizeof(long long) && cur->enc != ATE_FLOAT)
+			return T_OTHER;
+		switch (cur->enc) {
+		case ATE_FLOAT:
+			return T_FLT;
+		case ATE_SIGNED:
+			return T_INT;
+		/* only plain `char` prints as a character */
+		case ATE_SIGNED_CHAR: /* fallthrough */
+		case ATE_UNSIGNED_CHAR:
+			if (!strcmp(name, "char"))
+				return T_CHR;
+			return (cur->enc == ATE_SIGNED_CHAR) ? T_INT : T_UINT;
+		case ATE_BOOLEAN: /* fallthrough */
+		case ATE_UNSIGNED: /* fallthrough */
+		case ATE_UTF:
+			return T_UINT;
+		default:
+			return T_OTHER;
+		}
+	default:
+		return T_ERR;
+	}
+}
+
+#endif /* !defined(DWARF_H) */
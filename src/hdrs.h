@@ -0,0 +1,826 @@
+/*
+ * hdrs.h - completion and signature index of the prologue headers
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(HDRS_H)
+#define HDRS_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include "intern.h"
+#include "lex.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* cache file magic (bump the digit when the layout changes) */
+#define HDR_CACHE_MAGIC	"CEPLHDR1"
+/* cache file name, relative to `$HOME` */
+#define HDR_CACHE_NAME	".cepl_hdrs"
+/* longest signature kept, in bytes */
+#define HDR_SIG_MAX	0x100
+/* deepest nesting of aggregate bodies whose members are indexed */
+#define HDR_DEPTH_MAX	0x10
+
+/* kinds of indexed declarations */
+enum hdr_kind {
+	H_FUNC, H_VAR, H_TYPEDEF,
+	H_MACRO, H_MEMBER, H_ENUM,
+};
+
+/* an indexed name and its signature (offsets into `strs`) */
+struct hdr_ent {
+	uint32_t kind, name, sig;
+};
+
+/* a header the index was built from and the version it saw */
+struct hdr_file {
+	uint64_t size, mtime_sec, mtime_nsec, path;
+};
+
+VEC_DEFINE(hdr_ent_list, struct hdr_ent, 16, NO_DTOR)
+VEC_DEFINE(hdr_file_list, struct hdr_file, 16, NO_DTOR)
+VEC_DEFINE(hdr_tok_list, struct token, 64, NO_DTOR)
+
+/*
+ * index of the declarations visible to the prologue; `args` and
+ * `src` describe the preprocessor run it should match, `key` the
+ * run it does match
+ */
+struct hdr_index {
+	bool built, merged;
+	/* a rebuild owns everything below `src` until `join_hdrs()` */
+	bool building;
+	atomic_bool done;
+	pthread_t thread;
+	uint64_t key, want_key;
+	struct str_list args;
+	char const *src;
+	/* NUL-separated names, signatures, and paths (offset 0 is "") */
+	struct char_list strs;
+	/* sorted by name */
+	struct hdr_ent_list ents;
+	struct hdr_file_list files;
+};
+
+/* on-disk cache header, followed by the files, entries, then strings */
+struct hdr_cache_hdr {
+	char magic[8];
+	uint64_t key, ent_cnt, file_cnt, strs_len;
+};
+
+/* state while reading preprocessor output */
+struct hdr_parse {
+	struct hdr_index *idx;
+	char const *text;
+	struct hdr_tok_list decl, memb;
+	size_t braces, parens;
+	/* where each open aggregate body starts in `memb` */
+	size_t memb_beg[HDR_DEPTH_MAX];
+	bool in_func, in_agg, in_enum, skip_file;
+	/* the source being preprocessed, as named by the first line marker */
+	char const *main_file;
+	size_t main_len;
+	/* "struct tag" of the aggregate being read */
+	char agg[0x80];
+};
+
+static char const *const hdr_kind_names[] = {
+	[H_FUNC] = "function", [H_VAR] = "variable", [H_TYPEDEF] = "typedef",
+	[H_MACRO] = "macro", [H_MEMBER] = "member", [H_ENUM] = "enumerator",
+};
+
+static inline void init_hdrs(struct hdr_index *restrict idx)
+{
+	idx->built = idx->merged = false;
+	idx->key = 0;
+	init_char_list(&idx->strs);
+	push_char_list(&idx->strs, 0);
+	init_hdr_ent_list(&idx->ents);
+	init_hdr_file_list(&idx->files);
+}
+
+/* join a finished rebuild, waiting for one in flight if `wait`, returning true once the index is usable */
+static inline bool join_hdrs(struct hdr_index *restrict idx, bool wait)
+{
+	if (idx->building && (wait || atomic_load_explicit(&idx->done, memory_order_acquire))) {
+		pthread_join(idx->thread, NULL);
+		idx->building = false;
+	}
+	return !idx->building;
+}
+
+static inline void free_hdrs(struct hdr_index *restrict idx)
+{
+	join_hdrs(idx, true);
+	free_char_list(&idx->strs);
+	free_hdr_ent_list(&idx->ents);
+	free_hdr_file_list(&idx->files);
+	free_str_list(&idx->args);
+	*idx = (struct hdr_index){0};
+}
+
+static inline char const *hdr_str(struct hdr_index const *restrict idx, size_t off)
+{
+	return idx->strs.list ? idx->strs.list + off : "";
+}
+
+static inline uint32_t hdr_add_str(struct hdr_index *restrict idx, char const *restrict str, size_t len)
+{
+	uint32_t off = idx->strs.cnt;
+	extend_char_list(&idx->strs, str, len);
+	push_char_list(&idx->strs, 0);
+	return off;
+}
+
+/* names starting with `__` are implementation internals */
+static inline bool hdr_is_reserved(char const *restrict name, size_t len)
+{
+	return len >= 2 && name[0] == '_' && name[1] == '_';
+}
+
+/* join tokens into one line of C, dropping aggregate bodies and capping the length */
+static inline size_t hdr_join(char *restrict buf, size_t max, char const *restrict text,
+		struct token const *restrict toks, size_t cnt)
+{
+	size_t len = 0;
+	for (size_t i = 0; i < cnt && len + 8 < max; i++) {
+		char const *cur = text + toks[i].off;
+		size_t sz = MIN(toks[i].len, max - len - 8);
+		bool word = toks[i].type != TOK_PUNCT, prev_word = i && toks[i - 1].type != TOK_PUNCT;
+		/* `{` `}` pairs stand for the bodies left out of the declaration */
+		if (toks[i].type == TOK_PUNCT && *cur == '{' && i + 1 < cnt && text[toks[i + 1].off] == '}') {
+			memcpy(buf + len, " {...}", 6);
+			len += 6;
+			i++;
+			continue;
+		}
+		if (i && ((word && prev_word) || (word && strchr(",}", text[toks[i - 1].off]))
+				|| (toks[i].len == 3 && !memcmp(cur, "...", 3))
+				|| (*cur == '*' && prev_word)
+				|| (*cur == '(' && prev_word && i + 1 < cnt && text[toks[i + 1].off] == '*')))
+			buf[len++] = ' ';
+		memcpy(buf + len, cur, sz);
+		len += sz;
+	}
+	buf[len] = 0;
+	return len;
+}
+
+static inline void hdr_add(struct hdr_parse *restrict p, enum hdr_kind kind, struct token name,
+		char const *restrict prefix, struct token const *restrict toks, size_t cnt)
+{
+	char sig[HDR_SIG_MAX + sizeof p->agg + 2];
+	size_t len = 0;
+	if (hdr_is_reserved(p->text + name.off, name.len))
+		return;
+	if (prefix && prefix[0]) {
+		len = strlen(prefix);
+		memcpy(sig, prefix, len);
+		sig[len++] = ':';
+		sig[len++] = ' ';
+	}
+	len += hdr_join(sig + len, HDR_SIG_MAX, p->text, toks, cnt);
+	struct hdr_ent ent = {.kind = kind};
+	ent.name = hdr_add_str(p->idx, p->text + name.off, name.len);
+	ent.sig = hdr_add_str(p->idx, sig, len);
+	push_hdr_ent_list(&p->idx->ents, ent);
+}
+
+/* drop attributes, asm labels, and storage words that only clutter a signature */
+static inline size_t hdr_strip(char const *restrict text, struct token *restrict toks, size_t cnt)
+{
+	static char const *const noise[] = {
+		"__extension__", "extern", "__inline", "__inline__", "inline", "static", NULL,
+	};
+	static char const *const calls[] = {
+		"__attribute__", "__attribute", "__asm__", "__asm", "asm", "__declspec", NULL,
+	};
+	size_t out = 0;
+	for (size_t i = 0; i < cnt; i++) {
+		bool skip = false;
+		for (size_t j = 0; !skip && noise[j]; j++)
+			skip = lex_is_word(text, toks[i], noise[j]);
+		for (size_t j = 0; !skip && calls[j]; j++) {
+			if (!lex_is_word(text, toks[i], calls[j]) || i + 1 >= cnt || !lex_is(text, toks[i + 1], "("))
+				continue;
+			/* skip the balanced argument list */
+			size_t depth = 0;
+			for (i++; i < cnt; i++) {
+				depth += lex_is(text, toks[i], "(");
+				if (lex_is(text, toks[i], ")") && !--depth)
+					break;
+			}
+			skip = true;
+		}
+		if (!skip)
+			toks[out++] = toks[i];
+	}
+	return out;
+}
+
+static inline bool hdr_is_tag_word(char const *restrict text, struct token tok)
+{
+	return lex_is_word(text, tok, "struct") || lex_is_word(text, tok, "union") || lex_is_word(text, tok, "enum");
+}
+
+static inline bool hdr_is_qualifier(char const *restrict text, struct token tok)
+{
+	static char const *const quals[] = {
+		"const", "volatile", "restrict", "__restrict", "__restrict__", "_Atomic", NULL,
+	};
+	for (size_t i = 0; quals[i]; i++) {
+		if (lex_is_word(text, tok, quals[i]))
+			return true;
+	}
+	return false;
+}
+
+/* index of the name a declarator declares (or -1), setting `is_func` if it declares a function */
+static inline ptrdiff_t hdr_decl_name(char const *restrict text, struct token const *restrict toks,
+		size_t beg, size_t end, bool *restrict is_func)
+{
+	ptrdiff_t name = -1;
+	size_t depth = 0, open = end;
+	*is_func = false;
+	for (size_t i = beg; i < end && open == end; i++) {
+		if (lex_is(text, toks[i], "{"))
+			depth++;
+		else if (lex_is(text, toks[i], "}"))
+			depth--;
+		else if (!depth && lex_is(text, toks[i], "("))
+			open = i;
+	}
+	if (open < end) {
+		size_t i = open + 1;
+		/* `(*name)` groups a pointer declarator */
+		if (i < end && (lex_is(text, toks[i], "*") || lex_is(text, toks[i], "^"))) {
+			while (i < end && (lex_is(text, toks[i], "*") || lex_is(text, toks[i], "^") || hdr_is_qualifier(text, toks[i])))
+				i++;
+			if (i >= end || toks[i].type != TOK_ID)
+				return -1;
+			/* `(*name(params))(params)` is a function returning a function pointer */
+			*is_func = i + 1 < end && lex_is(text, toks[i + 1], "(");
+			return i;
+		}
+		if (open == beg || toks[open - 1].type != TOK_ID || hdr_is_qualifier(text, toks[open - 1]))
+			return -1;
+		*is_func = true;
+		name = open - 1;
+	} else {
+		depth = 0;
+		for (size_t i = beg; i < end; i++) {
+			if (lex_is(text, toks[i], "{")) {
+				depth++;
+			} else if (lex_is(text, toks[i], "}")) {
+				depth--;
+			} else if (!depth && (lex_is(text, toks[i], "[") || lex_is(text, toks[i], "=") || lex_is(text, toks[i], ":"))) {
+				break;
+			} else if (!depth && toks[i].type == TOK_ID && !hdr_is_qualifier(text, toks[i])) {
+				name = i;
+			}
+		}
+	}
+	/* `struct tag;` and bare specifiers declare no name */
+	if (name <= 0 || hdr_is_tag_word(text, toks[name - 1]))
+		return -1;
+	return name;
+}
+
+/* index every name a declaration (or member declaration) declares */
+static inline void hdr_decl(struct hdr_parse *restrict p, struct hdr_tok_list *restrict list, size_t beg, bool is_memb)
+{
+	struct token *toks = list->list + beg;
+	size_t cnt = hdr_strip(p->text, toks, list->cnt - beg), start = 0, depth = 0;
+	bool is_typedef = cnt && lex_is_word(p->text, toks[0], "typedef");
+
+	for (size_t i = 0; i <= cnt; i++) {
+		if (i < cnt) {
+			depth += lex_is(p->text, toks[i], "(") || lex_is(p->text, toks[i], "{");
+			depth -= lex_is(p->text, toks[i], ")") || lex_is(p->text, toks[i], "}");
+			if (depth || !lex_is(p->text, toks[i], ","))
+				continue;
+		}
+		bool is_func;
+		ptrdiff_t name = hdr_decl_name(p->text, toks, start, i, &is_func);
+		/* later declarators share the specifiers of the first */
+		if (name >= 0) {
+			enum hdr_kind kind = is_memb ? H_MEMBER : is_typedef ? H_TYPEDEF : is_func ? H_FUNC : H_VAR;
+			hdr_add(p, kind, toks[name], is_memb ? p->agg : NULL, toks, cnt);
+		}
+		start = i + 1;
+	}
+	list->cnt = beg;
+}
+
+/* remember "struct tag" for the aggregate whose body is opening */
+static inline void hdr_open_agg(struct hdr_parse *restrict p)
+{
+	struct token const *toks = p->decl.list;
+	p->agg[0] = 0;
+	for (size_t i = p->decl.cnt; i-- > 0;) {
+		if (!hdr_is_tag_word(p->text, toks[i]))
+			continue;
+		p->in_enum = lex_is_word(p->text, toks[i], "enum");
+		if (i + 1 < p->decl.cnt && toks[i + 1].type == TOK_ID)
+			snprintf(p->agg, sizeof p->agg, "%.*s %.*s", (int)toks[i].len, p->text + toks[i].off,
+					(int)toks[i + 1].len, p->text + toks[i + 1].off);
+		else
+			snprintf(p->agg, sizeof p->agg, "%.*s", (int)toks[i].len, p->text + toks[i].off);
+		break;
+	}
+	p->in_agg = true;
+	p->memb.cnt = 0;
+	p->memb_beg[0] = 0;
+}
+
+/* feed one token of C outside any directive */
+static inline void hdr_token(struct hdr_parse *restrict p, struct token tok)
+{
+	char const *text = p->text;
+	bool open = lex_is(text, tok, "{"), close = lex_is(text, tok, "}");
+
+	/* function bodies are skipped */
+	if (p->in_func) {
+		p->braces += open;
+		if (close && !--p->braces)
+			p->in_func = false;
+		return;
+	}
+	p->parens += lex_is(text, tok, "(");
+	p->parens -= p->parens && lex_is(text, tok, ")");
+
+	if (!p->braces) {
+		if (open && !p->parens) {
+			/* `f(...) {` defines a function */
+			size_t cnt = hdr_strip(text, p->decl.list, p->decl.cnt);
+			p->decl.cnt = cnt;
+			if (cnt && lex_is(text, p->decl.list[cnt - 1], ")")) {
+				hdr_decl(p, &p->decl, 0, false);
+				p->in_func = true;
+				p->braces = 1;
+				return;
+			}
+			hdr_open_agg(p);
+			push_hdr_tok_list(&p->decl, tok);
+			p->braces = 1;
+			return;
+		}
+		if (lex_is(text, tok, ";") && !p->parens) {
+			hdr_decl(p, &p->decl, 0, false);
+			p->decl.cnt = 0;
+			return;
+		}
+		push_hdr_tok_list(&p->decl, tok);
+		return;
+	}
+
+	/* inside an aggregate body */
+	size_t depth = MIN(p->braces, HDR_DEPTH_MAX) - 1;
+	if (open) {
+		push_hdr_tok_list(&p->memb, tok);
+		if (++p->braces <= HDR_DEPTH_MAX)
+			p->memb_beg[p->braces - 1] = p->memb.cnt;
+		return;
+	}
+	if (close) {
+		if (!--p->braces) {
+			push_hdr_tok_list(&p->decl, tok);
+			p->in_agg = p->in_enum = false;
+			p->memb.cnt = 0;
+			return;
+		}
+		/* a nested body collapses to `{}` inside the enclosing member */
+		p->memb.cnt = p->memb_beg[MIN(p->braces, HDR_DEPTH_MAX - 1)];
+		push_hdr_tok_list(&p->memb, tok);
+		return;
+	}
+	if (p->in_enum && p->braces == 1) {
+		/* enumerators follow `{` or `,` */
+		if (lex_is(text, tok, ",") && !p->parens) {
+			p->memb.cnt = 0;
+		} else if (!p->memb.cnt && tok.type == TOK_ID) {
+			hdr_add(p, H_ENUM, tok, p->agg, &tok, 1);
+			push_hdr_tok_list(&p->memb, tok);
+		} else {
+			push_hdr_tok_list(&p->memb, tok);
+		}
+		return;
+	}
+	if (lex_is(text, tok, ";") && !p->parens) {
+		hdr_decl(p, &p->memb, p->memb_beg[depth], true);
+		return;
+	}
+	push_hdr_tok_list(&p->memb, tok);
+}
+
+/* handle a `#` line: line markers pick the current file, `#define`s are indexed */
+static inline void hdr_directive(struct hdr_parse *restrict p, char const *restrict line, size_t len)
+{
+	size_t pos = 1;
+	struct token tok = lex_next(line, len, &pos);
+
+	/* `# 12 "/usr/include/stdio.h" 1 3 4` */
+	if (tok.type == TOK_NUM) {
+		tok = lex_next(line, len, &pos);
+		if (tok.type != TOK_STR || tok.len < 2)
+			return;
+		char const *file = line + tok.off + 1;
+		size_t file_len = tok.len - 2;
+		if (!p->main_file) {
+			p->main_file = file;
+			p->main_len = file_len;
+		}
+		/* only declarations from headers are indexed */
+		p->skip_file = file[0] == '<' || (file_len == p->main_len && !memcmp(file, p->main_file, file_len));
+		if (p->skip_file)
+			return;
+		/* headers are recorded once; markers mostly repeat the last one */
+		for (size_t i = p->idx->files.cnt; i-- > 0;) {
+			char const *seen = hdr_str(p->idx, p->idx->files.list[i].path);
+			if (!strncmp(seen, file, file_len) && !seen[file_len])
+				return;
+		}
+		push_hdr_file_list(&p->idx->files, (struct hdr_file){.path = hdr_add_str(p->idx, file, file_len)});
+		return;
+	}
+	if (!lex_is_word(line, tok, "define") || p->skip_file)
+		return;
+	struct token name = lex_next(line, len, &pos);
+	if (name.type != TOK_ID)
+		return;
+	size_t end = name.off + name.len;
+	char sig[HDR_SIG_MAX + 1];
+	/* function-like macros have `(` right after the name */
+	if (end < len && line[end] == '(') {
+		char const *close = memchr(line + end, ')', len - end);
+		end = close ? (size_t)(close - line) + 1 : len;
+	} else {
+		size_t body = lex_skip_space(line, len, end);
+		/* empty `_NAME_H` style macros are include guards */
+		if (body >= len && line[name.off] == '_')
+			return;
+		end = len;
+	}
+	snprintf(sig, sizeof sig, "#define %.*s", (int)(end - name.off), line + name.off);
+	if (hdr_is_reserved(line + name.off, name.len))
+		return;
+	struct hdr_ent ent = {.kind = H_MACRO};
+	ent.name = hdr_add_str(p->idx, line + name.off, name.len);
+	ent.sig = hdr_add_str(p->idx, sig, strlen(sig));
+	push_hdr_ent_list(&p->idx->ents, ent);
+}
+
+static inline int hdr_cmp(void const *a, void const *b, void *strs)
+{
+	struct hdr_ent const *x = a, *y = b;
+	int cmp = strcmp((char const *)strs + x->name, (char const *)strs + y->name);
+	/* keep a stable order for equal names */
+	return cmp ? cmp : (x->name > y->name) - (x->name < y->name);
+}
+
+/* index `-E -dD` output, recording the headers it came from */
+static inline void parse_hdrs(struct hdr_index *restrict idx, char const *restrict text, size_t len)
+{
+	struct hdr_parse p = {.idx = idx, .text = text};
+	init_hdr_tok_list(&p.decl);
+	init_hdr_tok_list(&p.memb);
+
+	for (size_t pos = 0; pos < len;) {
+		char const *nl = memchr(text + pos, '\n', len - pos);
+		size_t end = nl ? (size_t)(nl - text) : len, beg = pos;
+		while (beg < end && (text[beg] == ' ' || text[beg] == '\t'))
+			beg++;
+		if (beg < end && text[beg] == '#') {
+			hdr_directive(&p, text + beg, end - beg);
+		} else if (!p.skip_file) {
+			/* tokens keep offsets into `text` */
+			for (size_t cur = beg;;) {
+				struct token tok = lex_next(text, end, &cur);
+				if (tok.type == TOK_END)
+					break;
+				hdr_token(&p, tok);
+			}
+		}
+		pos = end + 1;
+	}
+	free_hdr_tok_list(&p.decl);
+	free_hdr_tok_list(&p.memb);
+
+	/* key each header by its current version */
+	for (size_t i = 0; i < idx->files.cnt; i++) {
+		struct stat st;
+		struct hdr_file *file = &idx->files.list[i];
+		if (stat(hdr_str(idx, file->path), &st))
+			continue;
+		file->size = st.st_size;
+		file->mtime_sec = st.st_mtim.tv_sec;
+		file->mtime_nsec = st.st_mtim.tv_nsec;
+	}
+	qsort_r(idx->ents.list, idx->ents.cnt, sizeof *idx->ents.list, hdr_cmp, idx->strs.list);
+}
+
+/* index of the first entry named `name`, storing how many there are in `cnt` */
+static inline size_t find_hdr(struct hdr_index const *restrict idx, char const *restrict name, size_t *restrict cnt)
+{
+	size_t lo = 0, hi = idx->ents.cnt;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (strcmp(hdr_str(idx, idx->ents.list[mid].name), name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (*cnt = 0; lo + *cnt < idx->ents.cnt && !strcmp(hdr_str(idx, idx->ents.list[lo + *cnt].name), name); ++*cnt);
+	return lo;
+}
+
+/* hash of everything that can change what the prologue declares */
+static inline uint64_t hdr_key(char *const *restrict cc_args, char const *restrict src)
+{
+	uint64_t key = hash_mem(src, strlen(src));
+	for (size_t i = 0; cc_args[i]; i++) {
+		/* warnings and the assembler dialect can't change what the headers declare */
+		if (!strncmp(cc_args[i], "-W", 2) || !strncmp(cc_args[i], "-masm=", 6) || !strcmp(cc_args[i], "-pedantic"))
+			continue;
+		key = key * 31 + hash_mem(cc_args[i], strlen(cc_args[i]) + 1);
+	}
+	return key;
+}
+
+/* point the index at a compiler command, returning true if that changes what it should hold */
+static inline bool set_hdr_args(struct hdr_index *restrict idx, char *const *restrict cc_args, char const *restrict src)
+{
+	uint64_t key = hdr_key(cc_args, src);
+	if (idx->args.list && key == idx->want_key)
+		return false;
+	/* the worker reads the old arguments */
+	join_hdrs(idx, true);
+	free_str_list(&idx->args);
+	init_str_list(&idx->args);
+	/* the preprocessor command is the compiler command with `-S` swapped for `-E -dD` */
+	for (size_t i = 0; cc_args[i]; i++) {
+		if (!strcmp(cc_args[i], "-S")) {
+			append_str(&idx->args, "-E", 0);
+			append_str(&idx->args, "-dD", 0);
+			continue;
+		}
+		append_str(&idx->args, cc_args[i], 0);
+	}
+	append_str(&idx->args, NULL, 0);
+	idx->src = src;
+	idx->want_key = key;
+	return true;
+}
+
+/* run the preprocessor over `src`, returning a mapping of its output (or MAP_FAILED) */
+static inline char *run_preprocessor(char *const *restrict args, char const *restrict src, size_t *restrict out_len)
+{
+	int pipe_in[2], status, null_fd, mem_fd;
+	struct stat st;
+	char *out = MAP_FAILED;
+	pid_t pid;
+
+	*out_len = 0;
+	if ((mem_fd = syscall(SYS_memfd_create, "cepl_hdrs", 1U)) == -1)
+		return MAP_FAILED;
+	if ((null_fd = open("/dev/null", O_WRONLY|O_CLOEXEC)) == -1 || pipe2(pipe_in, O_CLOEXEC) == -1) {
+		close(mem_fd);
+		if (null_fd != -1)
+			close(null_fd);
+		return MAP_FAILED;
+	}
+	switch ((pid = fork())) {
+	case -1:
+		close(pipe_in[0]);
+		close(pipe_in[1]);
+		break;
+
+	case 0:
+		dup2(null_fd, STDERR_FILENO);
+		dup2(pipe_in[0], STDIN_FILENO);
+		dup2(mem_fd, STDOUT_FILENO);
+		execvp(args[0], args);
+		_exit(127);
+		break;
+
+	default:
+		close(pipe_in[0]);
+		if (write(pipe_in[1], src, strlen(src)) == -1)
+			WARN("%s", "error writing to the preprocessor");
+		close(pipe_in[1]);
+		/* only reap our own child */
+		if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status))
+			break;
+		if (fstat(mem_fd, &st) || !st.st_size)
+			break;
+		out = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, mem_fd, 0);
+		if (out != MAP_FAILED)
+			*out_len = st.st_size;
+	}
+	close(null_fd);
+	close(mem_fd);
+	return out;
+}
+
+/* build the cache path, returning `NULL` if `$HOME` is unset */
+static inline char *hdr_cache_file(void)
+{
+	char const *home = getenv("HOME");
+	char *file;
+	if (!home || !home[0])
+		return NULL;
+	xmalloc(char, &file, strlen(home) + sizeof HDR_CACHE_NAME + 1, "hdr_cache_file()");
+	strmv(0, file, home);
+	strmv(CONCAT, file, "/");
+	strmv(CONCAT, file, HDR_CACHE_NAME);
+	return file;
+}
+
+/* write the index to a temporary file and rename it over the cache */
+static inline int save_hdr_cache(struct hdr_index const *restrict idx, char const *restrict cache_file)
+{
+	struct hdr_cache_hdr hdr = {
+		.key = idx->key, .ent_cnt = idx->ents.cnt,
+		.file_cnt = idx->files.cnt, .strs_len = idx->strs.cnt,
+	};
+	char tmp_file[strlen(cache_file) + sizeof ".XXXXXX"];
+	FILE *out;
+	int fd;
+
+	memcpy(hdr.magic, HDR_CACHE_MAGIC, sizeof hdr.magic);
+	strmv(0, tmp_file, cache_file);
+	strmv(CONCAT, tmp_file, ".XXXXXX");
+	if ((fd = mkstemp(tmp_file)) == -1)
+		return -1;
+	if (!(out = fdopen(fd, "wb"))) {
+		close(fd);
+		unlink(tmp_file);
+		return -1;
+	}
+	fwrite(&hdr, sizeof hdr, 1, out);
+	fwrite(idx->files.list, sizeof *idx->files.list, idx->files.cnt, out);
+	fwrite(idx->ents.list, sizeof *idx->ents.list, idx->ents.cnt, out);
+	fwrite(idx->strs.list, 1, idx->strs.cnt, out);
+	if (ferror(out) | fclose(out) || rename(tmp_file, cache_file)) {
+		unlink(tmp_file);
+		return -1;
+	}
+	return 0;
+}
+
+/* load a cached index built by the same command from headers that haven't changed since */
+static inline bool load_hdr_cache(struct hdr_index *restrict idx, char const *restrict cache_file, uint64_t key)
+{
+	struct stat st;
+	struct hdr_cache_hdr hdr;
+	int fd = open(cache_file, O_RDONLY|O_CLOEXEC);
+	char *map;
+	bool ret = false;
+
+	if (fd == -1)
+		return false;
+	if (fstat(fd, &st) || (size_t)st.st_size < sizeof hdr) {
+		close(fd);
+		return false;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	memcpy(&hdr, map, sizeof hdr);
+	size_t size = st.st_size - sizeof hdr;
+	if (memcmp(hdr.magic, HDR_CACHE_MAGIC, sizeof hdr.magic) || hdr.key != key
+			|| hdr.file_cnt > size / sizeof(struct hdr_file)
+			|| hdr.ent_cnt > (size - hdr.file_cnt * sizeof(struct hdr_file)) / sizeof(struct hdr_ent)
+			|| hdr.strs_len != size - hdr.file_cnt * sizeof(struct hdr_file) - hdr.ent_cnt * sizeof(struct hdr_ent)
+			|| !hdr.strs_len || map[st.st_size - 1]) {
+		munmap(map, st.st_size);
+		return false;
+	}
+	struct hdr_file const *files = (struct hdr_file const *)(map + sizeof hdr);
+	struct hdr_ent const *ents = (struct hdr_ent const *)(files + hdr.file_cnt);
+	char const *strs = (char const *)(ents + hdr.ent_cnt);
+	/* every header must still be the version the index was built from */
+	for (size_t i = 0; i < hdr.file_cnt; i++) {
+		if (files[i].path >= hdr.strs_len || stat(strs + files[i].path, &st)
+				|| files[i].size != (uint64_t)st.st_size
+				|| files[i].mtime_sec != (uint64_t)st.st_mtim.tv_sec
+				|| files[i].mtime_nsec != (uint64_t)st.st_mtim.tv_nsec)
+			goto done;
+	}
+	for (size_t i = 0; i < hdr.ent_cnt; i++) {
+		if (ents[i].name >= hdr.strs_len || ents[i].sig >= hdr.strs_len || ents[i].kind > H_ENUM)
+			goto done;
+	}
+	idx->strs.cnt = 0;
+	extend_char_list(&idx->strs, strs, hdr.strs_len);
+	extend_hdr_file_list(&idx->files, files, hdr.file_cnt);
+	extend_hdr_ent_list(&idx->ents, ents, hdr.ent_cnt);
+	ret = true;
+done:
+	munmap(map, st.st_size);
+	return ret;
+}
+
+/* rebuild the index from the cache or a preprocessor run */
+static inline void *hdr_worker(void *arg)
+{
+	struct hdr_index *idx = arg;
+	char *cache_file = hdr_cache_file(), *text;
+	size_t len;
+
+	if (!cache_file || !load_hdr_cache(idx, cache_file, idx->key)) {
+		if ((text = run_preprocessor(idx->args.list, idx->src, &len)) != MAP_FAILED) {
+			parse_hdrs(idx, text, len);
+			munmap(text, len);
+			if (cache_file && save_hdr_cache(idx, cache_file))
+				WARN("%s", "error writing header cache");
+		}
+	}
+	free(cache_file);
+	atomic_store_explicit(&idx->done, true, memory_order_release);
+	return NULL;
+}
+
+/*
+ * start bringing the index up to date with its arguments on a thread
+ * of its own (inline if one can't be made), returning true if a
+ * rebuild was started
+ */
+static inline bool start_hdrs(struct hdr_index *restrict idx)
+{
+	sigset_t all, old;
+
+	if (!idx->args.list || idx->building || (idx->built && idx->key == idx->want_key))
+		return false;
+	free_char_list(&idx->strs);
+	free_hdr_ent_list(&idx->ents);
+	free_hdr_file_list(&idx->files);
+	init_hdrs(idx);
+	idx->key = idx->want_key;
+	idx->built = true;
+	atomic_init(&idx->done, false);
+	/* the worker leaves signals to the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	idx->building = !pthread_create(&idx->thread, NULL, hdr_worker, idx);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (!idx->building)
+		hdr_worker(idx);
+	return true;
+}
+
+/* bring the index up to date with its arguments, returning true if it was rebuilt */
+static inline bool sync_hdrs(struct hdr_index *restrict idx)
+{
+	bool rebuilt = start_hdrs(idx);
+	join_hdrs(idx, true);
+	return rebuilt;
+}
+
+/* append every indexed name to `comps` once per rebuild, returning true if any were added */
+static inline bool merge_hdrs(struct hdr_index *restrict idx, struct id_list *restrict comps)
+{
+	/* a rebuild still in flight is picked up on a later tab */
+	if (start_hdrs(idx))
+		idx->merged = false;
+	if (!join_hdrs(idx, false) || idx->merged || !comps->list)
+		return false;
+	for (size_t i = 0; i < idx->ents.cnt; i++) {
+		char const *name = hdr_str(idx, idx->ents.list[i].name);
+		push_id_list(comps, intern_len(&str_pool, name, strlen(name)));
+	}
+	idx->merged = true;
+	return true;
+}
+
+/* print every declaration of `name`, returning how many there were */
+static inline size_t print_hdrs(FILE *restrict out, struct hdr_index *restrict idx, char const *restrict name)
+{
+	size_t cnt, beg;
+	sync_hdrs(idx);
+	beg = find_hdr(idx, name, &cnt);
+	for (size_t i = beg; i < beg + cnt; i++) {
+		struct hdr_ent const *ent = &idx->ents.list[i];
+		fprintf(out, "%s\t%s\n", hdr_kind_names[ent->kind], hdr_str(idx, ent->sig));
+	}
+	return cnt;
+}
+
+#endif /* !defined(HDRS_H) */
@@ -5,10 +5,19 @@
  * See LICENSE.md file for copyright and license details.
  */
 
+#include "dwarf.h"
 #include "hist.h"
 
 /* externs */
-extern struct str_list comp_list;
+extern struct id_list comp_list;
+extern struct sym_load sym_load;
+extern struct hdr_index hdr_index;
+extern struct sess_comps sess_comps;
+
+/* global history deduplication index */
+struct hist_index hist_index;
+/* global history file journal */
+struct hist_journal hist_journal;
 
 /* source file includes template */
 char const *prologue =
@@ -82,6 +91,9 @@ char const *prologue =
 	"#include <wchar.h>\n"
 	"#include <wctype.h>\n"
 	"#include <unistd.h>\n\n"
+	"#if defined(CEPL_SIMD)\n"
+	"# include <immintrin.h>\n"
+	"#endif /* defined(CEPL_SIMD) */\n\n"
 	"extern char **environ;\n\n"
 	"#line 1\n";
 
@@ -106,8 +118,14 @@ void cleanup(struct program *restrict prog)
 	/* avoid segfault when stdin is not a tty */
 	if (isatty(STDIN_FILENO))
 		rl_cleanup_after_signal();
-	/* free generated completions */
-	free_str_list(&comp_list);
+	/* free generated completions and the strings they refer to */
+	stop_sym_load(&sym_load);
+	free_id_list(&comp_list);
+	free_hdrs(&hdr_index);
+	free_sess_comps(&sess_comps);
+	free_pool(&str_pool);
+	free_hist_index(&hist_index);
+	finish_journal(&hist_journal);
 	free(prog->hist_file);
 	prog->hist_file = NULL;
 	free(prog->out_filename);
@@ -131,6 +149,7 @@ int write_asm(struct program *restrict prog, char *const *restrict cc_args)
 	size_t buf_len = strlen(prog->src[1].total.buf) + 1;
 	int pipe_cc[2], asm_fd, status;
 	char src_buffer[buf_len];
+	pid_t pid;
 
 	if (buf_len < 2)
 		ERRX("%s", "empty source passed to write_asm()");
@@ -148,7 +167,7 @@ int write_asm(struct program *restrict prog, char *const *restrict cc_args)
 	}
 
 	/* fork compiler */
-	switch (fork()) {
+	switch ((pid = fork())) {
 	/* error */
 	case -1:
 		close(pipe_cc[0]);
@@ -173,7 +192,8 @@ int write_asm(struct program *restrict prog, char *const *restrict cc_args)
 		if (write(pipe_cc[1], src_buffer, sizeof src_buffer) < 0)
 			ERR("%s", "error writing to pipe_cc[1]");
 		close(pipe_cc[1]);
-		wait(&status);
+		/* the header index may have its own preprocessor running */
+		waitpid(pid, &status, 0);
 		/* convert 255 to -1 since WEXITSTATUS() only returns the low-order 8 bits */
 		if (WIFEXITED(status) && WEXITSTATUS(status)) {
 			WARNX("%s", "compiler returned non-zero exit code");
@@ -192,9 +212,7 @@ void write_files(struct program *restrict prog)
 	int out_fd;
 	size_t buf_len, buf_pos;
 
-	/* write out history/asm output */
-	if (prog->sflags.hist_flag && write_history(prog->hist_file))
-		WARN("%s", "write_history()");
+	/* history is journaled as lines are accepted, so only asm is left to write */
 	write_asm(prog, prog->cc_list.list);
 	/* return early if no file open */
 	if (!prog->sflags.out_flag || !prog->ofile || !prog->src[1].total.buf)
@@ -232,27 +250,29 @@ void free_buffers(struct program *restrict prog)
 	/* clean up user data */
 	free(prog->cur_line);
 	prog->cur_line = NULL;
-	free(prog->type_list.list);
-	prog->type_list.list = NULL;
-	free_str_list(&prog->id_list);
+	free_type_list(&prog->type_list);
+	free_id_list(&prog->id_list);
+	free_id_list(&prog->touch_list);
 	free_str_list(&prog->cc_list);
-	if (prog->var_list.list) {
-		for (size_t i = 0; i < prog->var_list.cnt; i++)
-			free(prog->var_list.list[i].id);
-		free(prog->var_list.list);
-	}
+	free_var_list(&prog->var_list);
+	free_var_list(&prog->typedef_list);
+	free_id_map(&prog->var_map);
+	free_id_map(&prog->typedef_map);
+	free_dwarf(&prog->dwarf);
+	if (prog->dwarf_key)
+		close(prog->dwarf_fd);
+	prog->dwarf_key = 0;
 	/* free program structs */
 	for (size_t i = 0; i < 2; i++) {
 		free(prog->src[i].funcs.buf);
 		free(prog->src[i].body.buf);
 		free(prog->src[i].total.buf);
-		free(prog->src[i].flags.list);
-		free_str_list(&prog->src[i].hist);
-		free_str_list(&prog->src[i].lines);
+		free_flag_list(&prog->src[i].flags);
+		free_size_list(&prog->src[i].hist);
+		free_line_list(&prog->src[i].lines);
 		prog->src[i].body.size = prog->src[i].funcs.size = prog->src[i].total.size = 0;
 		prog->src[i].body.max = prog->src[i].funcs.max = prog->src[i].total.max = 1;
 		prog->src[i].body.buf = prog->src[i].funcs.buf = prog->src[i].total.buf = NULL;
-		prog->src[i].flags.list = NULL;
 	}
 }
 
@@ -295,13 +315,19 @@ void init_buffers(struct program *restrict prog)
 	strmv(0, prog->src[1].body.buf, prog_start);
 	/* init source history and flag lists */
 	for (size_t i = 0; i < 2; i++) {
-		init_str_list(&prog->src[i].lines, "FOOBARTHISVALUEDOESNTMATTERTROLLOLOLOL");
-		init_str_list(&prog->src[i].hist, "FOOBARTHISVALUEDOESNTMATTERTROLLOLOLOL");
+		init_size_list(&prog->src[i].lines.off);
+		init_char_list(&prog->src[i].lines.text);
+		init_size_list(&prog->src[i].hist);
 		init_flag_list(&prog->src[i].flags);
 	}
 	init_var_list(&prog->var_list);
+	init_var_list(&prog->typedef_list);
+	init_id_map(&prog->var_map);
+	init_id_map(&prog->typedef_map);
+	init_dwarf(&prog->dwarf);
 	init_type_list(&prog->type_list);
-	init_str_list(&prog->id_list, "FOOBARTHISVALUEDOESNTMATTERTROLLOLOLOL");
+	init_id_list(&prog->id_list);
+	init_id_list(&prog->touch_list);
 }
 
 size_t resize_sect(struct program *restrict prog, struct source_section *restrict sect, size_t off)
@@ -329,28 +355,26 @@ size_t resize_sect(struct program *restrict prog, struct source_section *restric
 void pop_history(struct program *restrict prog)
 {
 	for (size_t i = 0; i < 2; i++) {
-		switch(prog->src[i].flags.list[--prog->src[i].flags.cnt]) {
+		/* nothing to pop */
+		if (!prog->src[i].flags.cnt)
+			continue;
+		size_t idx = --prog->src[i].flags.cnt;
+		/* sections are append-only, so history entries are their lengths before each line */
+		switch(prog->src[i].flags.list[idx]) {
 		case NOT_IN_MAIN:
-			prog->src[i].hist.cnt = prog->src[i].lines.cnt = prog->src[i].flags.cnt;
-			strmv(0, prog->src[i].funcs.buf, prog->src[i].hist.list[prog->src[i].hist.cnt]);
-			free(prog->src[i].hist.list[prog->src[i].hist.cnt]);
-			free(prog->src[i].lines.list[prog->src[i].lines.cnt]);
-			prog->src[i].hist.list[prog->src[i].hist.cnt] = NULL;
-			prog->src[i].lines.list[prog->src[i].lines.cnt] = NULL;
+			prog->src[i].funcs.buf[prog->src[i].hist.list[idx]] = '\0';
 			break;
 		case IN_MAIN:
-			prog->src[i].hist.cnt = prog->src[i].lines.cnt = prog->src[i].flags.cnt;
-			strmv(0, prog->src[i].body.buf, prog->src[i].hist.list[prog->src[i].hist.cnt]);
-			free(prog->src[i].hist.list[prog->src[i].hist.cnt]);
-			free(prog->src[i].lines.list[prog->src[i].lines.cnt]);
-			prog->src[i].hist.list[prog->src[i].hist.cnt] = NULL;
-			prog->src[i].lines.list[prog->src[i].lines.cnt] = NULL;
+			prog->src[i].body.buf[prog->src[i].hist.list[idx]] = '\0';
 			break;
 		case EMPTY: /* fallthrough */
 		default:
 			/* revert decrement */
 			prog->src[i].flags.cnt++;
+			continue;
 		}
+		prog->src[i].hist.cnt = idx;
+		truncate_lines(&prog->src[i].lines, idx);
 	}
 }
 
@@ -362,9 +386,9 @@ void build_body(struct program *restrict prog)
 		return;
 	}
 	for (size_t i = 0; i < 2; i++) {
-		append_str(&prog->src[i].lines, prog->cur_line, 0);
-		append_str(&prog->src[i].hist, prog->src[i].body.buf, 0);
-		append_flag(&prog->src[i].flags, IN_MAIN);
+		append_line(&prog->src[i].lines, prog->cur_line);
+		push_size_list(&prog->src[i].hist, strlen(prog->src[i].body.buf));
+		push_flag_list(&prog->src[i].flags, IN_MAIN);
 		strmv(CONCAT, prog->src[i].body.buf, "\t");
 		strmv(CONCAT, prog->src[i].body.buf, prog->cur_line);
 	}
@@ -378,9 +402,9 @@ void build_funcs(struct program *restrict prog)
 		return;
 	}
 	for (size_t i = 0; i < 2; i++) {
-		append_str(&prog->src[i].lines, prog->cur_line, 0);
-		append_str(&prog->src[i].hist, prog->src[i].funcs.buf, 0);
-		append_flag(&prog->src[i].flags, NOT_IN_MAIN);
+		append_line(&prog->src[i].lines, prog->cur_line);
+		push_size_list(&prog->src[i].hist, strlen(prog->src[i].funcs.buf));
+		push_flag_list(&prog->src[i].flags, NOT_IN_MAIN);
 		/* generate function buffers */
 		strmv(CONCAT, prog->src[i].funcs.buf, prog->cur_line);
 	}
@@ -397,9 +421,6 @@ void build_final(struct program *restrict prog, char **argv)
 	for (size_t i = 0; i < 2; i++) {
 		strmv(0, prog->src[i].total.buf, prog->src[i].funcs.buf);
 		strmv(CONCAT, prog->src[i].total.buf, prog->src[i].body.buf);
-		/* print variable values */
-		if (prog->sflags.track_flag && i == 1)
-			print_vars(prog, prog->cc_list.list, argv);
 		strmv(CONCAT, prog->src[i].total.buf, prog_end);
 	}
 }
@@ -8,8 +8,10 @@
 #if !defined(HIST_H)
 #define HIST_H 1
 
+#include "journal.h"
 #include "parseopts.h"
 #include "readline.h"
+#include "search.h"
 #include "vars.h"
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -27,42 +29,74 @@ void build_body(struct program *restrict prog);
 void build_funcs(struct program *restrict prog);
 void build_final(struct program *restrict prog, char **argv);
 
-/* look for current line in readline history */
-static inline void dedup_history_add(char *const *restrict line)
+/* offset of the history entry numbered `seq` or -1 (entries stay in sequence order) */
+static inline int hist_offset(size_t seq)
+{
+	HIST_ENTRY **list = history_list();
+	int lo = 0, hi = history_length;
+	if (!list)
+		return -1;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if ((uintptr_t)list[mid]->data < seq)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < history_length && (uintptr_t)list[lo]->data == seq) ? lo : -1;
+}
+
+/* dedup key of `line` (its hash, kept nonzero since 0 marks an empty map slot) */
+static inline size_t hist_key(char const *restrict line)
+{
+	size_t hash = hash_mem(line, strlen(line));
+	return hash ? hash : 1;
+}
+
+/* number the entry at `off`, make it the one its line maps to, and return its search index */
+static inline size_t index_hist_entry(struct hist_index *restrict idx, int off)
+{
+	HIST_ENTRY *ent = history_list()[off];
+	ent->data = (histdata_t)(uintptr_t)++idx->seq;
+	set_id(&idx->map, hist_key(ent->line), idx->seq);
+	return add_search_line(&idx->search, ent->line);
+}
+
+/* index every loaded history entry (later duplicates win) */
+static inline void index_history(struct hist_index *restrict idx)
+{
+	for (int i = 0; history_list() && i < history_length; i++)
+		index_hist_entry(idx, i);
+}
+
+static inline void free_hist_index(struct hist_index *restrict idx)
+{
+	free_id_map(&idx->map);
+	free_hist_search(&idx->search);
+	idx->seq = 0;
+}
+
+/* add the current line to readline history, removing its earlier entry, and return its search index or -1 */
+static inline ptrdiff_t dedup_history_add(struct hist_index *restrict idx, char *const *restrict line)
 {
 	/* return early on empty input */
 	if (!line || !*line)
-		return;
+		return -1;
 	/* strip leading whitespace */
 	char *strip = *line;
 	strip += strspn(strip, " \t");
 	/* don't add empty or single character lines (invalid syntax) */
 	if (strlen(strip) < 2)
-		return;
-	/* current entry and forward/backward function pointers  */
-	HIST_ENTRY *(*seek_hist[])() = {previous_history, next_history};
-	/* save current position */
-	int hpos = where_history();
-	for (size_t i = 0; i < 2; i++) {
-		while (history_search_prefix(strip, i - 1) != -1) {
-			/* if this line is already in the history, remove the earlier entry */
-			HIST_ENTRY *ent = current_history();
-			/* HIST_ENTRY *ent = history_get(hpos[1]); */
-			if (!ent || !ent->line || strcmp(*line, ent->line)) {
-				/* break if at end of list */
-				if (!seek_hist[i]())
-					break;
-				continue;
-			}
-			/* free application data */
-			ent = remove_history(where_history());
-			histdata_t data = free_history_entry(ent);
-			free(data);
-		}
-		history_set_pos(hpos);
+		return -1;
+	ptrdiff_t seq = find_id(&idx->map, hist_key(strip));
+	int off = seq == -1 ? -1 : hist_offset(seq);
+	/* a different line that hashed the same is left alone */
+	if (off != -1 && !strcmp(history_list()[off]->line, strip)) {
+		HIST_ENTRY *ent = remove_history(off);
+		free_history_entry(ent);
 	}
-	history_set_pos(hpos);
 	add_history(strip);
+	return index_hist_entry(idx, history_length - 1);
 }
 
 #endif /* !defined(HIST_H) */
@@ -0,0 +1,106 @@
+/*
+ * idmap.h - open-addressed map of nonzero ids to indices
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(IDMAP_H)
+#define IDMAP_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* initial id map slot count (must be a power of two) */
+#define ID_SLOTS	0x40
+
+static inline void init_id_map(struct id_map *restrict map)
+{
+	*map = (struct id_map){0};
+}
+
+static inline void free_id_map(struct id_map *restrict map)
+{
+	free(map->table);
+	*map = (struct id_map){0};
+}
+
+/* ids are pool offsets, packed keys, or hashes, so mix the bits before masking */
+static inline size_t hash_id(size_t id)
+{
+	uint64_t hash = id * 0x9e3779b97f4a7c15;
+	return hash ^ (hash >> 29);
+}
+
+/* return the slot for `id`, which is either empty or holds it */
+static inline struct id_slot *id_slot(struct id_map const *restrict map, size_t id)
+{
+	size_t mask = map->slots - 1;
+	for (size_t i = hash_id(id) & mask;; i = (i + 1) & mask) {
+		if (!map->table[i].id || map->table[i].id == id)
+			return &map->table[i];
+	}
+}
+
+/* return the index currently bound to `id` or -1 */
+static inline ptrdiff_t find_id(struct id_map const *restrict map, size_t id)
+{
+	if (!map->table || !id)
+		return -1;
+	struct id_slot *slot = id_slot(map, id);
+	return slot->id ? (ptrdiff_t)slot->idx : -1;
+}
+
+static inline void grow_id_map(struct id_map *restrict map)
+{
+	struct id_slot *old = map->table;
+	size_t old_slots = map->slots;
+	map->slots = old_slots ? old_slots * 2 : ID_SLOTS;
+	xcalloc(struct id_slot, &map->table, map->slots, sizeof *map->table, "grow_id_map()");
+	for (size_t i = 0; i < old_slots; i++) {
+		if (old[i].id)
+			*id_slot(map, old[i].id) = old[i];
+	}
+	free(old);
+}
+
+/* bind `id` to `idx` */
+static inline void set_id(struct id_map *restrict map, size_t id, size_t idx)
+{
+	if (!id)
+		return;
+	/* keep the load factor under 1/2 */
+	if ((map->cnt + 1) * 2 > map->slots)
+		grow_id_map(map);
+	struct id_slot *slot = id_slot(map, id);
+	if (!slot->id)
+		map->cnt++;
+	*slot = (struct id_slot){.id = id, .idx = idx};
+}
+
+/* unbind `id`, shifting back any displaced slots so probing stays intact */
+static inline void del_id(struct id_map *restrict map, size_t id)
+{
+	if (!map->table || !id)
+		return;
+	size_t mask = map->slots - 1;
+	struct id_slot *slot = id_slot(map, id);
+	if (!slot->id)
+		return;
+	size_t hole = slot - map->table;
+	for (size_t i = (hole + 1) & mask; map->table[i].id; i = (i + 1) & mask) {
+		size_t home = hash_id(map->table[i].id) & mask;
+		/* leave entries whose home lies cyclically in (hole, i] */
+		if (((i - home) & mask) < ((i - hole) & mask))
+			continue;
+		map->table[hole] = map->table[i];
+		hole = i;
+	}
+	map->table[hole] = (struct id_slot){0};
+	map->cnt--;
+}
+
+#endif /* !defined(IDMAP_H) */
@@ -0,0 +1,141 @@
+/*
+ * intern.h - interned string pool
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(INTERN_H)
+#define INTERN_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* initial pool storage size */
+#define POOL_INIT	PAGE_SIZE
+/* initial hash index slot count (must be a power of two) */
+#define POOL_SLOTS	0x400
+
+/* global string pool */
+extern struct str_pool str_pool;
+
+/* FNV-1a */
+static inline size_t hash_mem(char const *restrict str, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+static inline void init_pool(struct str_pool *restrict pool)
+{
+	pool->len = 1;
+	pool->max = POOL_INIT;
+	pool->cnt = 0;
+	pool->slots = POOL_SLOTS;
+	xcalloc(char, &pool->buf, 1, pool->max, "init_pool()");
+	xcalloc(size_t, &pool->index, pool->slots, sizeof *pool->index, "init_pool()");
+}
+
+static inline void free_pool(struct str_pool *restrict pool)
+{
+	free(pool->buf);
+	free(pool->index);
+	*pool = (struct str_pool){0};
+}
+
+/*
+ * convert a handle back into a string; the pointer is only valid until the
+ * next intern into the same pool (which may realloc `buf`), so callers that
+ * intern while walking a string must hold the handle or a copy instead
+ */
+static inline char *pool_str(struct str_pool const *restrict pool, size_t id)
+{
+	if (!pool->buf)
+		return "";
+	return pool->buf + id;
+}
+
+/* return the index slot for `str`, which is either empty or holds a match */
+static inline size_t *pool_slot(struct str_pool const *restrict pool, char const *restrict str, size_t len)
+{
+	size_t mask = pool->slots - 1;
+	for (size_t i = hash_mem(str, len) & mask;; i = (i + 1) & mask) {
+		size_t off = pool->index[i];
+		if (!off)
+			return &pool->index[i];
+		/* stops at the stored terminator instead of reading past `buf` */
+		if (!strncmp(pool->buf + off, str, len) && !pool->buf[off + len])
+			return &pool->index[i];
+	}
+}
+
+static inline void grow_pool_index(struct str_pool *restrict pool)
+{
+	size_t *old = pool->index, old_slots = pool->slots;
+	pool->slots *= 2;
+	xcalloc(size_t, &pool->index, pool->slots, sizeof *pool->index, "grow_pool_index()");
+	for (size_t i = 0; i < old_slots; i++) {
+		if (!old[i])
+			continue;
+		char const *str = pool->buf + old[i];
+		*pool_slot(pool, str, strlen(str)) = old[i];
+	}
+	free(old);
+}
+
+/* look up `len` bytes of `str` without interning them (returns 0 if absent) */
+static inline size_t find_len(struct str_pool const *restrict pool, char const *restrict str, size_t len)
+{
+	if (!pool->buf || !str || !len)
+		return 0;
+	return *pool_slot(pool, str, len);
+}
+
+/* intern `len` bytes of `str` and return its handle */
+static inline size_t intern_len(struct str_pool *restrict pool, char const *restrict str, size_t len)
+{
+	if (!str || !len)
+		return 0;
+	if (!pool->buf)
+		init_pool(pool);
+	size_t *slot = pool_slot(pool, str, len);
+	if (*slot)
+		return *slot;
+	/* keep the load factor under 1/2 */
+	if ((pool->cnt + 1) * 2 > pool->slots) {
+		grow_pool_index(pool);
+		slot = pool_slot(pool, str, len);
+	}
+	/* `str` may point into the pool itself */
+	uintptr_t src = (uintptr_t)str, beg = (uintptr_t)pool->buf;
+	size_t src_off = (src >= beg && src < beg + pool->len) ? src - beg : 0;
+	if (pool->len + len + 1 > pool->max) {
+		while ((pool->max <<= 1) < pool->len + len + 1);
+		xrealloc(char, &pool->buf, pool->max, "intern_len()");
+	}
+	if (src_off)
+		str = pool->buf + src_off;
+	size_t off = pool->len;
+	memcpy(pool->buf + off, str, len);
+	pool->buf[off + len] = 0;
+	pool->len += len + 1;
+	pool->cnt++;
+	*slot = off;
+	return off;
+}
+
+static inline size_t intern_str(struct str_pool *restrict pool, char const *restrict str)
+{
+	if (!str)
+		return 0;
+	return intern_len(pool, str, strlen(str));
+}
+
+#endif /* !defined(INTERN_H) */
@@ -0,0 +1,372 @@
+/*
+ * journal.h - append-only history journal with background compaction
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(JOURNAL_H)
+#define JOURNAL_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include "intern.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* journal lines before compaction is considered */
+#define JOURNAL_COMPACT_MIN	0x400
+/* starts the readline timestamp line that leads a line whose last run succeeded */
+#define JOURNAL_OK	'#'
+
+/*
+ * the history file is a journal of accepted lines, one per line and
+ * oldest first, that may repeat; compaction rewrites it keeping only
+ * the last copy of each line
+ *
+ * a line whose last run compiled and exited with status 0 follows a
+ * `#<seconds>` line, which `read_history()` takes as its timestamp
+ * when `history_comment_char` is '#' (as in bash) instead of a line
+ *
+ * every instance appending to it remembers how far it has read, so
+ * lines from other instances are merged without re-reading the file
+ */
+struct hist_journal {
+	char *file;
+	/* lines in the journal as far as this instance knows */
+	size_t lines;
+	/* bytes already merged and the file they were read from */
+	off_t read_off;
+	dev_t dev;
+	ino_t ino;
+	/* set by the compaction thread, read only after joining it */
+	struct stat swap_from, swap_to;
+	ptrdiff_t kept;
+	atomic_bool done;
+	bool compacting;
+	pthread_t thread;
+};
+
+/* called with each line kept when the journal is read and whether it last ran successfully */
+typedef void journal_line_fn(char const *restrict line, bool ok);
+
+/* open and `flock()` the journal with `op`, retrying if it was replaced while waiting */
+static inline int lock_journal(char const *restrict file, int op, struct stat *restrict fd_st)
+{
+	for (;;) {
+		struct stat file_st;
+		int fd = open(file, O_RDWR|O_APPEND|O_CREAT|O_CLOEXEC, 0600);
+		if (fd == -1)
+			return -1;
+		if (flock(fd, op) || fstat(fd, fd_st)) {
+			close(fd);
+			return -1;
+		}
+		/* a compaction renamed a new journal over the one we locked */
+		if (!stat(file, &file_st) && file_st.st_dev == fd_st->st_dev && file_st.st_ino == fd_st->st_ino)
+			return fd;
+		close(fd);
+	}
+}
+
+static inline size_t journal_line_len(char const *restrict buf, size_t len, size_t off)
+{
+	char const *nl = memchr(buf + off, '\n', len - off);
+	return nl ? (size_t)(nl - buf) - off : len - off;
+}
+
+/* move `off` past the status line leading its line, returning the length of the line left */
+static inline size_t journal_key(char const *restrict buf, size_t len, size_t *restrict off)
+{
+	size_t line_len = journal_line_len(buf, len, *off);
+	if (line_len > 1 && buf[*off] == JOURNAL_OK && isdigit((unsigned char)buf[*off + 1])) {
+		*off = MIN(*off + line_len + 1, len);
+		return *off < len ? journal_line_len(buf, len, *off) : 0;
+	}
+	return line_len;
+}
+
+/* slot of the line at `off` in an open-addressed table of line offsets + 1 (status marks are ignored) */
+static inline size_t *journal_slot(size_t *restrict table, size_t mask, char const *restrict buf, size_t len, size_t off)
+{
+	size_t key_len = journal_key(buf, len, &off);
+	for (size_t i = hash_mem(buf + off, key_len) & mask;; i = (i + 1) & mask) {
+		if (!table[i])
+			return &table[i];
+		size_t cur = table[i] - 1;
+		if (journal_key(buf, len, &cur) == key_len && !memcmp(buf + cur, buf + off, key_len))
+			return &table[i];
+	}
+}
+
+/*
+ * collect the offsets of the last copy of each non-empty line in `buf`
+ * in order, returning the total line count (no string pool, so worker
+ * threads can call it)
+ */
+static inline size_t dedup_journal(struct size_list *restrict keep, char const *restrict buf, size_t len)
+{
+	struct size_list offs;
+	size_t *table, slots = 0x40, lines = 0;
+
+	init_size_list(&offs);
+	for (size_t off = 0, key = 0; off < len; off = key + journal_line_len(buf, len, key) + 1, key = off) {
+		lines++;
+		if (journal_key(buf, len, &key))
+			push_size_list(&offs, off);
+	}
+	/* keep the load factor under 1/2 */
+	while (slots < offs.cnt * 2)
+		slots *= 2;
+	xcalloc(size_t, &table, slots, sizeof *table, "dedup_journal()");
+	/* later copies overwrite earlier ones */
+	for (size_t i = 0; i < offs.cnt; i++)
+		*journal_slot(table, slots - 1, buf, len, offs.list[i]) = offs.list[i] + 1;
+	for (size_t i = 0; i < offs.cnt; i++) {
+		if (*journal_slot(table, slots - 1, buf, len, offs.list[i]) == offs.list[i] + 1)
+			push_size_list(keep, offs.list[i]);
+	}
+	free(table);
+	free_size_list(&offs);
+	return lines;
+}
+
+/* map the whole journal read-only, returning `NULL` if it is empty or unreadable */
+static inline char *map_journal(int fd, size_t *restrict len)
+{
+	struct stat st;
+	char *buf;
+	*len = 0;
+	if (fstat(fd, &st) || st.st_size <= 0)
+		return NULL;
+	if ((buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+		return NULL;
+	*len = st.st_size;
+	return buf;
+}
+
+/*
+ * pass the last copy of each line added since the saved offset to `add`
+ * oldest first; `fd` must be locked and `st` its status
+ */
+static inline void merge_journal(struct hist_journal *restrict jrn, int fd, struct stat const *restrict st, journal_line_fn *add)
+{
+	struct size_list keep;
+	char *buf, *line = NULL;
+
+	/* a compaction replaced the journal since the last merge, so start over */
+	if (st->st_dev != jrn->dev || st->st_ino != jrn->ino || st->st_size < jrn->read_off) {
+		jrn->dev = st->st_dev;
+		jrn->ino = st->st_ino;
+		jrn->read_off = 0;
+		jrn->lines = 0;
+	}
+	if (st->st_size == jrn->read_off)
+		return;
+	/* only map from the page holding the saved offset */
+	off_t base = jrn->read_off & ~(off_t)(sysconf(_SC_PAGESIZE) - 1);
+	size_t len = st->st_size - base, skip = jrn->read_off - base;
+	if ((buf = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, base)) == MAP_FAILED)
+		return;
+	init_size_list(&keep);
+	jrn->lines += dedup_journal(&keep, buf + skip, len - skip);
+	for (size_t i = 0; i < keep.cnt; i++) {
+		size_t off = keep.list[i], line_len = journal_key(buf + skip, len - skip, &off);
+		xrealloc(char, &line, line_len + 1, "merge_journal()");
+		memcpy(line, buf + skip + off, line_len);
+		line[line_len] = 0;
+		add(line, off != keep.list[i]);
+	}
+	jrn->read_off = st->st_size;
+	free(line);
+	free_size_list(&keep);
+	munmap(buf, len);
+}
+
+/* reap a finished compaction, returning true if one was running */
+static inline bool poll_journal(struct hist_journal *restrict jrn, bool wait)
+{
+	if (!jrn->compacting || (!wait && !atomic_load_explicit(&jrn->done, memory_order_acquire)))
+		return false;
+	pthread_join(jrn->thread, NULL);
+	jrn->compacting = false;
+	/*
+	 * if everything in the old journal was merged, so was everything
+	 * the compaction kept; otherwise the next merge starts over
+	 */
+	if (jrn->kept >= 0 && jrn->swap_from.st_dev == jrn->dev && jrn->swap_from.st_ino == jrn->ino
+			&& jrn->swap_from.st_size == jrn->read_off) {
+		jrn->dev = jrn->swap_to.st_dev;
+		jrn->ino = jrn->swap_to.st_ino;
+		jrn->read_off = jrn->swap_to.st_size;
+		jrn->lines = jrn->kept;
+	}
+	return true;
+}
+
+/* merge lines other instances appended since the last call */
+static inline int sync_journal(struct hist_journal *restrict jrn, journal_line_fn *add)
+{
+	struct stat st;
+	int fd;
+	/*
+	 * reap our own compaction first or its journal looks like another
+	 * instance's and is merged from the start; it holds the lock for
+	 * nearly its whole run, so this waits no longer than locking would
+	 */
+	poll_journal(jrn, true);
+	/* a shared lock keeps appends and compactions out mid-read */
+	if (!jrn->file || (fd = lock_journal(jrn->file, LOCK_SH, &st)) == -1)
+		return -1;
+	merge_journal(jrn, fd, &st, add);
+	close(fd);
+	return 0;
+}
+
+/* read the whole journal, passing the last copy of each line to `add` oldest first */
+static inline void load_journal(struct hist_journal *restrict jrn, char const *restrict file, journal_line_fn *add)
+{
+	*jrn = (struct hist_journal){0};
+	xmalloc(char, &jrn->file, strlen(file) + 1, "load_journal()");
+	strmv(0, jrn->file, file);
+	sync_journal(jrn, add);
+}
+
+/* append one line and its status to the journal, first merging any lines it is missing */
+static inline int append_journal(struct hist_journal *restrict jrn, char const *restrict line, bool ok, journal_line_fn *add)
+{
+	struct iovec iov[4];
+	struct stat st;
+	size_t cnt = 0, want = 0;
+	char last = '\n', stamp[32];
+	int fd;
+
+	/* as in `sync_journal()` */
+	poll_journal(jrn, true);
+	if (!jrn->file || (fd = lock_journal(jrn->file, LOCK_EX, &st)) == -1)
+		return -1;
+	merge_journal(jrn, fd, &st, add);
+	/* terminate a last line left without its newline */
+	if (st.st_size > 0 && pread(fd, &last, 1, st.st_size - 1) == 1 && last != '\n')
+		iov[cnt++] = (struct iovec){"\n", 1};
+	if (ok)
+		iov[cnt++] = (struct iovec){stamp, snprintf(stamp, sizeof stamp, "%c%lld\n", JOURNAL_OK, (long long)time(NULL))};
+	iov[cnt++] = (struct iovec){(void *)line, strlen(line)};
+	iov[cnt++] = (struct iovec){"\n", 1};
+	for (size_t i = 0; i < cnt; i++)
+		want += iov[i].iov_len;
+	/* one write so readers never see half a line */
+	ssize_t ret = writev(fd, iov, cnt);
+	close(fd);
+	if (ret != (ssize_t)want)
+		return -1;
+	/* the lock kept other writers out, so our line is already merged */
+	if (jrn->read_off == st.st_size)
+		jrn->read_off += ret;
+	jrn->lines++;
+	return 0;
+}
+
+/*
+ * rewrite the journal with only the last copy of each line, returning the
+ * lines kept or -1 and, if non-`NULL`, the status of the old and new file
+ */
+static inline ptrdiff_t compact_journal(char const *restrict file, struct stat *restrict from, struct stat *restrict to)
+{
+	struct stat st;
+	struct size_list keep;
+	char tmp_file[strlen(file) + sizeof ".XXXXXX"];
+	size_t len;
+	char *buf;
+	FILE *out;
+	int fd, tmp_fd;
+	ptrdiff_t ret = -1;
+
+	if ((fd = lock_journal(file, LOCK_EX, &st)) == -1)
+		return -1;
+	if (!(buf = map_journal(fd, &len))) {
+		close(fd);
+		return 0;
+	}
+	strmv(0, tmp_file, file);
+	strmv(CONCAT, tmp_file, ".XXXXXX");
+	init_size_list(&keep);
+	dedup_journal(&keep, buf, len);
+	if ((tmp_fd = mkstemp(tmp_file)) == -1)
+		goto done;
+	if (!(out = fdopen(tmp_fd, "wb"))) {
+		close(tmp_fd);
+		unlink(tmp_file);
+		goto done;
+	}
+	/* the last line may be missing its newline */
+	for (size_t i = 0; i < keep.cnt; i++) {
+		size_t key = keep.list[i], key_len = journal_key(buf, len, &key);
+		fwrite(buf + keep.list[i], 1, key + key_len - keep.list[i], out);
+		fputc('\n', out);
+	}
+	bool failed = ferror(out) || fflush(out) || fsync(tmp_fd) || (to && fstat(tmp_fd, to));
+	if ((fclose(out) | failed) || rename(tmp_file, file)) {
+		unlink(tmp_file);
+		goto done;
+	}
+	if (from)
+		*from = st;
+	ret = keep.cnt;
+done:
+	/* unlocking the replaced journal lets waiting writers retry on the new one */
+	free_size_list(&keep);
+	munmap(buf, len);
+	close(fd);
+	return ret;
+}
+
+static inline void *journal_worker(void *arg)
+{
+	struct hist_journal *jrn = arg;
+	jrn->swap_from = (struct stat){0};
+	jrn->kept = compact_journal(jrn->file, &jrn->swap_from, &jrn->swap_to);
+	atomic_store_explicit(&jrn->done, true, memory_order_release);
+	return NULL;
+}
+
+/* compact in the background once the journal holds twice the `live` distinct lines */
+static inline void maybe_compact_journal(struct hist_journal *restrict jrn, size_t live)
+{
+	sigset_t all, old;
+	/* give the reaped compaction's line count a chance to settle first */
+	if (poll_journal(jrn, false))
+		return;
+	if (!jrn->file || jrn->compacting || jrn->lines < JOURNAL_COMPACT_MIN || jrn->lines < live * 2)
+		return;
+	atomic_store_explicit(&jrn->done, false, memory_order_relaxed);
+	/* the worker leaves signals to the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	jrn->compacting = !pthread_create(&jrn->thread, NULL, journal_worker, jrn);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+/* wait for any compaction and release the journal */
+static inline void finish_journal(struct hist_journal *restrict jrn)
+{
+	poll_journal(jrn, true);
+	free(jrn->file);
+	jrn->file = NULL;
+}
+
+#endif /* !defined(JOURNAL_H) */
@@ -0,0 +1,157 @@
+/*
+ * layout.h - struct layout and cache-line inspection
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(LAYOUT_H)
+#define LAYOUT_H 1
+
+#include "defs.h"
+#include "dwarf.h"
+#include "intern.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* bytes per cache line */
+#define CACHE_LINE	64
+
+/* alignment of a type under the x86-64 System V rules (1 for packed aggregates) */
+static inline size_t layout_align(struct dwarf_info const *restrict info, ptrdiff_t type)
+{
+	if ((type = dwarf_strip(info, type)) < 0)
+		return 1;
+	struct dwarf_type const *cur = &info->types.list[type];
+	size_t align = 1;
+
+	switch (cur->kind) {
+	case K_BASE:
+		/* complex types align like their parts */
+		align = (cur->enc == ATE_COMPLEX) ? cur->size / 2 : cur->size;
+		return MIN(DEFAULT(align, 1), 16);
+	case K_ENUM: /* fallthrough */
+	case K_PTR:
+		return DEFAULT(cur->size, 1);
+	case K_ARRAY:
+		return layout_align(info, cur->base);
+	case K_VECTOR:
+		/* vectors align to their full width */
+		return MIN(DEFAULT(dwarf_size(info, type), 1), 64);
+	case K_STRUCT: /* fallthrough */
+	case K_UNION:
+		for (size_t i = 0; i < cur->memb_cnt; i++)
+			align = MAX(align, layout_align(info, info->membs.list[cur->memb_off + i].type));
+		/* misaligned members mean `__attribute__((packed))` */
+		for (size_t i = 0; i < cur->memb_cnt; i++) {
+			struct dwarf_member const *memb = &info->membs.list[cur->memb_off + i];
+			if (!memb->bit_size && memb->off % layout_align(info, memb->type))
+				return 1;
+		}
+		return (cur->size % align) ? 1 : align;
+	default:
+		return 1;
+	}
+}
+
+/* byte just past the storage a member occupies */
+static inline size_t layout_end(struct dwarf_info const *restrict info, struct dwarf_member const *restrict memb)
+{
+	if (memb->bit_size)
+		return memb->off + (memb->bit_off + memb->bit_size + 7) / 8;
+	return memb->off + dwarf_size(info, memb->type);
+}
+
+/* member order that minimizes padding (largest alignment first), returning the resulting size */
+static inline size_t layout_suggest(struct dwarf_info const *restrict info, struct dwarf_type const *restrict agg, size_t *restrict order)
+{
+	struct dwarf_member const *membs = info->membs.list + agg->memb_off;
+	size_t off = 0, max_align = 1;
+
+	for (size_t i = 0; i < agg->memb_cnt; i++)
+		order[i] = i;
+	/* stable insertion sort keeps equally aligned members in declaration order */
+	for (size_t i = 1; i < agg->memb_cnt; i++) {
+		size_t cur = order[i], j = i;
+		size_t align = layout_align(info, membs[cur].type);
+		for (; j > 0 && layout_align(info, membs[order[j - 1]].type) < align; j--)
+			order[j] = order[j - 1];
+		order[j] = cur;
+	}
+	for (size_t i = 0; i < agg->memb_cnt; i++) {
+		size_t align = layout_align(info, membs[order[i]].type);
+		max_align = MAX(max_align, align);
+		off = (off + align - 1) / align * align + dwarf_size(info, membs[order[i]].type);
+	}
+	return (off + max_align - 1) / max_align * max_align;
+}
+
+/* print the layout of the struct or union `type`, returning -1 if it isn't one */
+static inline int print_layout(FILE *restrict out, struct dwarf_info const *restrict info, ptrdiff_t type, char const *restrict name)
+{
+	if ((type = dwarf_strip(info, type)) < 0)
+		return -1;
+	struct dwarf_type const *agg = &info->types.list[type];
+	struct dwarf_member const *membs = info->membs.list + agg->memb_off;
+	size_t align = layout_align(info, type), pad = 0, end = 0;
+	bool has_bits = false;
+
+	if (agg->kind != K_STRUCT && agg->kind != K_UNION)
+		return -1;
+	if (!agg->size) {
+		fprintf(out, "`%s` is an incomplete type\n", name);
+		return -1;
+	}
+	for (size_t i = 0; i < agg->memb_cnt; i++) {
+		/* union members all start at zero */
+		if (agg->kind == K_STRUCT)
+			pad += (membs[i].off > end) ? membs[i].off - end : 0;
+		end = MAX(end, layout_end(info, &membs[i]));
+		has_bits |= membs[i].bit_size;
+	}
+	pad += (agg->size > end) ? agg->size - end : 0;
+	fprintf(out, "`%s`: size %zu, align %zu, %zu padding byte%s, %zu cache line%s\n",
+			name, agg->size, align, pad, (pad == 1) ? "" : "s",
+			(agg->size + CACHE_LINE - 1) / CACHE_LINE, (agg->size > CACHE_LINE) ? "s" : "");
+	fputs("\toffset\tsize\tmember\n", out);
+
+	end = 0;
+	for (size_t i = 0; i < agg->memb_cnt; i++) {
+		struct dwarf_member const *memb = &membs[i];
+		size_t memb_end = layout_end(info, memb);
+		char const *memb_name = memb->name ? pool_str(&info->names, memb->name) : "(anonymous)";
+		if (agg->kind == K_STRUCT && memb->off > end)
+			fprintf(out, "\t%zu\t%zu\t(hole)\n", end, memb->off - end);
+		if (memb->bit_size)
+			fprintf(out, "\t%zu:%u\t%u bit%s\t%s", memb->off, memb->bit_off, memb->bit_size, (memb->bit_size == 1) ? "" : "s", memb_name);
+		else
+			fprintf(out, "\t%zu\t%zu\t%s", memb->off, memb_end - memb->off, memb_name);
+		if (memb_end > memb->off && memb->off / CACHE_LINE != (memb_end - 1) / CACHE_LINE)
+			fprintf(out, "\t(straddles cache lines %zu-%zu)", memb->off / CACHE_LINE, (memb_end - 1) / CACHE_LINE);
+		fputc('\n', out);
+		end = MAX(end, memb_end);
+	}
+	if (agg->size > end)
+		fprintf(out, "\t%zu\t%zu\t(tail padding)\n", end, agg->size - end);
+
+	/* reordering can't help unions, packed structs, or bit-field runs */
+	if (agg->kind != K_STRUCT || !pad || align == 1 || has_bits)
+		return 0;
+	size_t order[agg->memb_cnt + 1];
+	size_t size = layout_suggest(info, agg, order);
+	if (size >= agg->size) {
+		fputs("member order already minimizes padding\n", out);
+		return 0;
+	}
+	fputs("suggested order:", out);
+	for (size_t i = 0; i < agg->memb_cnt; i++) {
+		struct dwarf_member const *memb = &membs[order[i]];
+		fprintf(out, "%s %s", i ? "," : "", memb->name ? pool_str(&info->names, memb->name) : "(anonymous)");
+	}
+	fprintf(out, " (size %zu, saves %zu byte%s)\n", size, agg->size - size, (agg->size - size == 1) ? "" : "s");
+	return 0;
+}
+
+#endif /* !defined(LAYOUT_H) */
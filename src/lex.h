@@ -0,0 +1,168 @@
+/*
+ * lex.h - minimal C tokenizer
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(LEX_H)
+#define LEX_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/* token types */
+enum tok_type {
+	TOK_END, TOK_ID, TOK_NUM,
+	TOK_STR, TOK_CHR, TOK_PUNCT,
+};
+
+/* struct definition for a token (a span of the scanned buffer) */
+struct token {
+	enum tok_type type;
+	size_t off, len;
+};
+
+static inline bool lex_is_id(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/* return the offset just past the literal whose opening quote is at `str[pos]` */
+static inline size_t lex_skip_literal(char const *restrict str, size_t len, size_t pos)
+{
+	char quote = str[pos];
+	for (pos++; pos < len; pos++) {
+		if (str[pos] == '\\') {
+			pos++;
+			continue;
+		}
+		if (str[pos] == quote)
+			return pos + 1;
+		/* unterminated literals end at the newline */
+		if (str[pos] == '\n')
+			return pos;
+	}
+	return len;
+}
+
+/* return the offset just past a comment starting at `str[pos]` or `pos` if there is none */
+static inline size_t lex_skip_comment(char const *restrict str, size_t len, size_t pos)
+{
+	if (pos + 1 >= len || str[pos] != '/')
+		return pos;
+	/* line comments stop short of the newline so it still separates statements */
+	if (str[pos + 1] == '/') {
+		char const *nl = memchr(str + pos, '\n', len - pos);
+		return nl ? (size_t)(nl - str) : len;
+	}
+	if (str[pos + 1] == '*') {
+		for (size_t i = pos + 2; i + 1 < len; i++) {
+			if (str[i] == '*' && str[i + 1] == '/')
+				return i + 2;
+		}
+		return len;
+	}
+	return pos;
+}
+
+/* skip whitespace and comments */
+static inline size_t lex_skip_space(char const *restrict str, size_t len, size_t pos)
+{
+	for (;;) {
+		while (pos < len && strchr(" \t\n\v\f\r", str[pos]))
+			pos++;
+		size_t end = lex_skip_comment(str, len, pos);
+		if (end == pos)
+			return pos;
+		pos = end;
+	}
+}
+
+/* length of the punctuator at `str[pos]` (longest match) */
+static inline size_t lex_punct_len(char const *restrict str, size_t len, size_t pos)
+{
+	static char const *const puncts[] = {
+		"<<=", ">>=", "...",
+		"->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=",
+		"&&", "||", "*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "##",
+	};
+	for (size_t i = 0; i < sizeof puncts / sizeof *puncts; i++) {
+		size_t sz = strlen(puncts[i]);
+		if (pos + sz <= len && !memcmp(str + pos, puncts[i], sz))
+			return sz;
+	}
+	return 1;
+}
+
+/* return the next token starting at `*pos` and advance past it */
+static inline struct token lex_next(char const *restrict str, size_t len, size_t *restrict pos)
+{
+	size_t beg = lex_skip_space(str, len, *pos), end = beg;
+	struct token tok = {.type = TOK_END, .off = beg, .len = 0};
+
+	if (beg >= len) {
+		*pos = len;
+		return tok;
+	}
+
+	char c = str[beg];
+	if (c == '"' || c == '\'') {
+		end = lex_skip_literal(str, len, beg);
+		tok.type = (c == '"') ? TOK_STR : TOK_CHR;
+	} else if ((c >= '0' && c <= '9') || (c == '.' && beg + 1 < len && str[beg + 1] >= '0' && str[beg + 1] <= '9')) {
+		/* pp-number */
+		for (end++; end < len; end++) {
+			if (strchr("+-", str[end]) && strchr("eEpP", str[end - 1]))
+				continue;
+			if (!lex_is_id(str[end]) && str[end] != '.')
+				break;
+		}
+		tok.type = TOK_NUM;
+	} else if (lex_is_id(c)) {
+		while (end < len && lex_is_id(str[end]))
+			end++;
+		tok.type = TOK_ID;
+		/* encoding prefixes (L'x', u8"x", etc.) belong to the literal */
+		if (end < len && (str[end] == '"' || str[end] == '\'')) {
+			size_t sz = end - beg;
+			if ((sz == 1 && strchr("LuU", c)) || (sz == 2 && !memcmp(str + beg, "u8", 2))) {
+				tok.type = (str[end] == '"') ? TOK_STR : TOK_CHR;
+				end = lex_skip_literal(str, len, end);
+			}
+		}
+	} else {
+		end += lex_punct_len(str, len, beg);
+		tok.type = TOK_PUNCT;
+	}
+
+	tok.len = end - beg;
+	*pos = end;
+	return tok;
+}
+
+/* true if `tok` is the punctuator `punct` */
+static inline bool lex_is(char const *restrict str, struct token tok, char const *restrict punct)
+{
+	size_t sz = strlen(punct);
+	return tok.type == TOK_PUNCT && tok.len == sz && !memcmp(str + tok.off, punct, sz);
+}
+
+/* true if `tok` is the identifier or keyword `word` */
+static inline bool lex_is_word(char const *restrict str, struct token tok, char const *restrict word)
+{
+	size_t sz = strlen(word);
+	return tok.type == TOK_ID && tok.len == sz && !memcmp(str + tok.off, word, sz);
+}
+
+/* return the offset just past the last token, ignoring trailing whitespace and comments */
+static inline size_t lex_code_end(char const *restrict str, size_t len)
+{
+	size_t pos = 0, end = 0;
+	for (struct token tok = lex_next(str, len, &pos); tok.type != TOK_END; tok = lex_next(str, len, &pos))
+		end = tok.off + tok.len;
+	return end;
+}
+
+#endif /* !defined(LEX_H) */
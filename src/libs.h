@@ -0,0 +1,485 @@
+/*
+ * libs.h - shared library resolution and dynamic symbol reading
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(LIBS_H)
+#define LIBS_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* multiarch directory and machine of the libraries we can use */
+#if defined(__x86_64__)
+# define LIB_TRIPLET	"x86_64-linux-gnu"
+# define LIB_MACHINE	EM_X86_64
+#elif defined(__aarch64__)
+# define LIB_TRIPLET	"aarch64-linux-gnu"
+# define LIB_MACHINE	EM_AARCH64
+#elif defined(__i386__)
+# define LIB_TRIPLET	"i386-linux-gnu"
+# define LIB_MACHINE	EM_386
+#endif
+
+/* how deeply linker scripts may name other linker scripts */
+#define LIB_SCRIPT_DEPTH	8
+/* the runtime linker's library cache */
+#define LD_CACHE_FILE		"/etc/ld.so.cache"
+#define LD_CACHE_MAGIC		"glibc-ld.so.cache1.1"
+#define LD_CACHE_OLD_MAGIC	"ld.so-1.7.0"
+/* `FLAG_ELF_LIBC6` entries are the only ones for glibc programs */
+#define LD_CACHE_LIBC6		0x0003
+
+/* `ld.so.cache` new-format header and entries (string offsets are from the header) */
+struct ld_cache_hdr {
+	char magic[sizeof LD_CACHE_MAGIC - 1];
+	uint32_t nlibs, len_strings;
+	uint8_t flags, pad[3];
+	uint32_t ext_off, unused[3];
+};
+
+struct ld_cache_ent {
+	int32_t flags;
+	uint32_t key, value, osversion;
+	uint64_t hwcap;
+};
+
+/* a read-only mapping of a whole file */
+struct lib_map {
+	unsigned char const *buf;
+	size_t len;
+};
+
+static inline bool map_lib(struct lib_map *restrict map, char const *restrict file)
+{
+	struct stat st;
+	int fd = open(file, O_RDONLY|O_CLOEXEC);
+	void *buf;
+	*map = (struct lib_map){0};
+	if (fd == -1)
+		return false;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || !st.st_size) {
+		close(fd);
+		return false;
+	}
+	buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (buf == MAP_FAILED)
+		return false;
+	*map = (struct lib_map){buf, st.st_size};
+	return true;
+}
+
+static inline void unmap_lib(struct lib_map *restrict map)
+{
+	if (map->buf)
+		munmap((void *)map->buf, map->len);
+	*map = (struct lib_map){0};
+}
+
+/* whether `off`..`off + len` lies inside the mapping */
+static inline bool lib_has(struct lib_map const *restrict map, size_t off, size_t len)
+{
+	return off <= map->len && len <= map->len - off;
+}
+
+/* whether the mapping is a shared object this machine can load */
+static inline bool is_native_lib(struct lib_map const *restrict map)
+{
+	ElfW(Ehdr) const *ehdr = (ElfW(Ehdr) const *)map->buf;
+	if (!lib_has(map, 0, sizeof *ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG))
+		return false;
+	if (ehdr->e_ident[EI_CLASS] != ((sizeof(void *) == 8) ? ELFCLASS64 : ELFCLASS32))
+		return false;
+	if (ehdr->e_ident[EI_DATA] != ((__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ? ELFDATA2LSB : ELFDATA2MSB))
+		return false;
+#if defined(LIB_MACHINE)
+	if (ehdr->e_machine != LIB_MACHINE)
+		return false;
+#endif
+	return ehdr->e_type == ET_DYN;
+}
+
+/* file offset of the virtual address `addr`, or 0 if no loaded segment maps it */
+static inline size_t lib_vaddr_off(struct lib_map const *restrict map, ElfW(Addr) addr)
+{
+	ElfW(Ehdr) const *ehdr = (ElfW(Ehdr) const *)map->buf;
+	ElfW(Phdr) const *phdrs = (ElfW(Phdr) const *)(map->buf + ehdr->e_phoff);
+	for (size_t i = 0; i < ehdr->e_phnum; i++) {
+		if (phdrs[i].p_type == PT_LOAD && addr >= phdrs[i].p_vaddr && addr - phdrs[i].p_vaddr < phdrs[i].p_filesz)
+			return addr - phdrs[i].p_vaddr + phdrs[i].p_offset;
+	}
+	return 0;
+}
+
+/* number of `.dynsym` entries implied by a `.gnu.hash` table (one past the highest hashed symbol) */
+static inline size_t gnu_hash_cnt(struct lib_map const *restrict map, size_t off)
+{
+	uint32_t const *hdr = (uint32_t const *)(map->buf + off);
+	if (!off || !lib_has(map, off, 4 * sizeof *hdr))
+		return 0;
+	size_t nbuckets = hdr[0], symoff = hdr[1], bloom = hdr[2];
+	size_t buckets_off = off + 4 * sizeof *hdr + bloom * sizeof(ElfW(Addr));
+	if (!lib_has(map, buckets_off, nbuckets * sizeof *hdr))
+		return 0;
+	uint32_t const *buckets = (uint32_t const *)(map->buf + buckets_off);
+	uint32_t const *chain = buckets + nbuckets;
+	size_t last = 0;
+	for (size_t i = 0; i < nbuckets; i++)
+		last = MAX(last, buckets[i]);
+	if (last < symoff)
+		return symoff;
+	/* the low bit marks the end of a chain */
+	for (;; last++) {
+		size_t chain_off = (unsigned char const *)&chain[last - symoff] - map->buf;
+		if (!lib_has(map, chain_off, sizeof *chain))
+			return 0;
+		if (chain[last - symoff] & 1)
+			return last + 1;
+	}
+}
+
+/* locate `.dynsym` and `.dynstr` from the dynamic segment when the section headers are stripped */
+static inline size_t lib_dyn_syms(struct lib_map const *restrict map, size_t *restrict sym_off,
+		size_t *restrict str_off, size_t *restrict str_len)
+{
+	ElfW(Ehdr) const *ehdr = (ElfW(Ehdr) const *)map->buf;
+	ElfW(Phdr) const *phdrs = (ElfW(Phdr) const *)(map->buf + ehdr->e_phoff);
+	size_t hash_off = 0, sym_cnt = 0;
+
+	*sym_off = *str_off = *str_len = 0;
+	for (size_t i = 0; i < ehdr->e_phnum; i++) {
+		if (phdrs[i].p_type != PT_DYNAMIC || !lib_has(map, phdrs[i].p_offset, phdrs[i].p_filesz))
+			continue;
+		ElfW(Dyn) const *dyn = (ElfW(Dyn) const *)(map->buf + phdrs[i].p_offset);
+		for (size_t j = 0; j < phdrs[i].p_filesz / sizeof *dyn && dyn[j].d_tag != DT_NULL; j++) {
+			switch (dyn[j].d_tag) {
+			case DT_SYMTAB:
+				*sym_off = lib_vaddr_off(map, dyn[j].d_un.d_ptr);
+				break;
+			case DT_STRTAB:
+				*str_off = lib_vaddr_off(map, dyn[j].d_un.d_ptr);
+				break;
+			case DT_STRSZ:
+				*str_len = dyn[j].d_un.d_val;
+				break;
+			case DT_GNU_HASH:
+				sym_cnt = gnu_hash_cnt(map, lib_vaddr_off(map, dyn[j].d_un.d_ptr));
+				break;
+			case DT_HASH:
+				hash_off = lib_vaddr_off(map, dyn[j].d_un.d_ptr);
+				break;
+			}
+		}
+	}
+	/* the SysV hash `nchain` is exactly the symbol count */
+	if (!sym_cnt && hash_off && lib_has(map, hash_off, 2 * sizeof(uint32_t)))
+		sym_cnt = ((uint32_t const *)(map->buf + hash_off))[1];
+	if (!*sym_off || !*str_off || !lib_has(map, *str_off, *str_len))
+		return 0;
+	return sym_cnt;
+}
+
+/* only defined, exported functions and objects are useful completions */
+static inline bool is_public_sym(ElfW(Sym) const *restrict sym)
+{
+	unsigned bind = ELF64_ST_BIND(sym->st_info), type = ELF64_ST_TYPE(sym->st_info);
+	if (sym->st_shndx == SHN_UNDEF || ELF64_ST_VISIBILITY(sym->st_other) != STV_DEFAULT)
+		return false;
+	if (bind != STB_GLOBAL && bind != STB_WEAK && bind != STB_GNU_UNIQUE)
+		return false;
+	return type == STT_FUNC || type == STT_OBJECT || type == STT_GNU_IFUNC;
+}
+
+/*
+ * append the names of the public dynamic symbols of `file` to `names`,
+ * reading `.dynsym`/`.dynstr` straight out of a mapping (safe to call
+ * from several threads at once)
+ */
+static inline void read_lib_syms(struct char_list *restrict names, char const *restrict file)
+{
+	struct lib_map map;
+	size_t sym_off = 0, sym_cnt = 0, str_off = 0, str_len = 0;
+
+	if (!file || !map_lib(&map, file))
+		return;
+	if (!is_native_lib(&map)) {
+		unmap_lib(&map);
+		return;
+	}
+	ElfW(Ehdr) const *ehdr = (ElfW(Ehdr) const *)map.buf;
+	if (!lib_has(&map, ehdr->e_phoff, ehdr->e_phnum * sizeof(ElfW(Phdr)))) {
+		unmap_lib(&map);
+		return;
+	}
+	/* section headers name the tables directly */
+	if (ehdr->e_shoff && ehdr->e_shentsize == sizeof(ElfW(Shdr))
+			&& lib_has(&map, ehdr->e_shoff, ehdr->e_shnum * sizeof(ElfW(Shdr)))) {
+		ElfW(Shdr) const *shdrs = (ElfW(Shdr) const *)(map.buf + ehdr->e_shoff);
+		for (size_t i = 0; i < ehdr->e_shnum; i++) {
+			if (shdrs[i].sh_type != SHT_DYNSYM || shdrs[i].sh_link >= ehdr->e_shnum)
+				continue;
+			sym_off = shdrs[i].sh_offset;
+			sym_cnt = shdrs[i].sh_size / sizeof(ElfW(Sym));
+			str_off = shdrs[shdrs[i].sh_link].sh_offset;
+			str_len = shdrs[shdrs[i].sh_link].sh_size;
+			break;
+		}
+	}
+	if (!sym_cnt)
+		sym_cnt = lib_dyn_syms(&map, &sym_off, &str_off, &str_len);
+
+	if (lib_has(&map, sym_off, sym_cnt * sizeof(ElfW(Sym))) && lib_has(&map, str_off, str_len)) {
+		ElfW(Sym) const *syms = (ElfW(Sym) const *)(map.buf + sym_off);
+		char const *strs = (char const *)map.buf + str_off;
+		/* entry 0 is always the undefined symbol */
+		for (size_t i = 1; i < sym_cnt; i++) {
+			char const *name = strs + syms[i].st_name;
+			size_t len;
+			if (!is_public_sym(&syms[i]) || syms[i].st_name >= str_len)
+				continue;
+			if (!(len = strnlen(name, str_len - syms[i].st_name)) || len == str_len - syms[i].st_name)
+				continue;
+			extend_char_list(names, name, len + 1);
+		}
+	}
+	unmap_lib(&map);
+}
+
+/* append the `lib<name>.so*` paths `ld.so.cache` lists for this ABI, in cache order */
+static inline void find_ld_cache(struct str_list *restrict paths, char const *restrict name)
+{
+	struct lib_map map;
+	size_t off = 0, len = strlen(name);
+
+	if (!map_lib(&map, LD_CACHE_FILE))
+		return;
+	/* an old-format cache carries the new one after its own table */
+	if (lib_has(&map, 0, 16) && !memcmp(map.buf, LD_CACHE_OLD_MAGIC, sizeof LD_CACHE_OLD_MAGIC - 1)) {
+		uint32_t old_cnt;
+		memcpy(&old_cnt, map.buf + 12, sizeof old_cnt);
+		off = (16 + (size_t)old_cnt * 12 + 7) & ~(size_t)7;
+	}
+	struct ld_cache_hdr const *hdr = (struct ld_cache_hdr const *)(map.buf + off);
+	if (!lib_has(&map, off, sizeof *hdr) || memcmp(hdr->magic, LD_CACHE_MAGIC, sizeof hdr->magic)
+			|| !lib_has(&map, off + sizeof *hdr, hdr->nlibs * sizeof(struct ld_cache_ent))) {
+		unmap_lib(&map);
+		return;
+	}
+	struct ld_cache_ent const *ents = (struct ld_cache_ent const *)(hdr + 1);
+	char const *strs = (char const *)map.buf + off;
+	size_t strs_len = map.len - off;
+	for (size_t i = 0; i < hdr->nlibs; i++) {
+		char const *key = strs + ents[i].key, *value = strs + ents[i].value;
+		if ((ents[i].flags & 0xff) != LD_CACHE_LIBC6 || ents[i].key >= strs_len || ents[i].value >= strs_len)
+			continue;
+		if (!memchr(key, 0, strs_len - ents[i].key) || !memchr(value, 0, strs_len - ents[i].value))
+			continue;
+		/* `libm.so` matches the soname `libm.so.6` */
+		if (!strncmp(key, name, len) && (!key[len] || key[len] == '.'))
+			append_str(paths, value, 0);
+	}
+	unmap_lib(&map);
+}
+
+/* build the library search path: `-L` flags, then `$LIBRARY_PATH`, then the linker defaults */
+static inline void lib_search_dirs(struct str_list *restrict dirs, char *const *restrict ld_args)
+{
+	static char const *const def_dirs[] = {
+#if defined(LIB_TRIPLET)
+		"/usr/local/lib/" LIB_TRIPLET, "/lib/" LIB_TRIPLET, "/usr/lib/" LIB_TRIPLET,
+#endif
+		"/usr/local/lib64", "/lib64", "/usr/lib64",
+		"/usr/local/lib", "/lib", "/usr/lib",
+		NULL
+	};
+	char const *env = getenv("LIBRARY_PATH");
+
+	init_str_list(dirs);
+	for (size_t i = 0; ld_args && ld_args[i]; i++) {
+		if (strncmp(ld_args[i], "-L", 2))
+			continue;
+		if (ld_args[i][2])
+			append_str(dirs, ld_args[i] + 2, 0);
+		else if (ld_args[i + 1])
+			append_str(dirs, ld_args[++i], 0);
+	}
+	/* `strtok()` would clobber callers iterating with it */
+	for (char const *dir = env; dir && *dir;) {
+		size_t len = strcspn(dir, ":");
+		if (len) {
+			char buf[len + 1];
+			memcpy(buf, dir, len);
+			buf[len] = 0;
+			append_str(dirs, buf, 0);
+		}
+		dir += len + !!dir[len];
+	}
+	for (size_t i = 0; def_dirs[i]; i++)
+		append_str(dirs, def_dirs[i], 0);
+	append_str(dirs, NULL, 0);
+}
+
+static inline size_t resolve_lib_file(struct str_list *restrict libs, char const *restrict file,
+		char *const *restrict dirs, int depth);
+
+/* find `file` in the search path, returning a malloc()ed path or NULL */
+static inline char *search_lib(char const *restrict file, char *const *restrict dirs)
+{
+	for (size_t i = 0; dirs[i]; i++) {
+		char *path;
+		xmalloc(char, &path, strlen(dirs[i]) + strlen(file) + 2, "search_lib()");
+		strmv(0, path, dirs[i]);
+		strmv(CONCAT, path, "/");
+		strmv(CONCAT, path, file);
+		if (!access(path, R_OK))
+			return path;
+		free(path);
+	}
+	return NULL;
+}
+
+/* resolve `-l<name>` or `-l:<file>` like the linker, returning the number of libraries added */
+static inline size_t resolve_lib(struct str_list *restrict libs, char const *restrict name,
+		char *const *restrict dirs, int depth)
+{
+	struct str_list cands;
+	size_t cnt = 0;
+	char file[strlen(name) + sizeof "lib.so"];
+	char *path;
+
+	if (name[0] == ':') {
+		strmv(0, file, name + 1);
+	} else {
+		strmv(0, file, "lib");
+		strmv(CONCAT, file, name);
+		strmv(CONCAT, file, ".so");
+	}
+	if ((path = search_lib(file, dirs))) {
+		cnt = resolve_lib_file(libs, path, dirs, depth);
+		free(path);
+		return cnt;
+	}
+	/* without a development symlink the runtime cache still knows the soname */
+	if (name[0] == ':')
+		return 0;
+	init_str_list(&cands);
+	find_ld_cache(&cands, file);
+	for (size_t i = 0; !cnt && i < cands.cnt; i++)
+		cnt = resolve_lib_file(libs, cands.list[i], dirs, depth);
+	free_str_list(&cands);
+	return cnt;
+}
+
+/* follow the `GROUP`/`INPUT` commands of a linker script */
+static inline size_t read_lib_script(struct str_list *restrict libs, struct lib_map const *restrict map,
+		char *const *restrict dirs, int depth)
+{
+	char const *cur = (char const *)map->buf, *end = cur + map->len;
+	size_t cnt = 0, parens = 0;
+	bool in_files = false, want_files = false;
+
+	while (cur < end) {
+		if (cur + 1 < end && cur[0] == '/' && cur[1] == '*') {
+			char const *close = memmem(cur + 2, end - cur - 2, "*/", 2);
+			cur = close ? close + 2 : end;
+			continue;
+		}
+		if (strchr(" \t\r\n,", *cur)) {
+			cur++;
+			continue;
+		}
+		if (*cur == '(') {
+			in_files |= !parens++ && want_files;
+			cur++;
+			continue;
+		}
+		if (*cur == ')') {
+			if (parens && !--parens)
+				in_files = want_files = false;
+			cur++;
+			continue;
+		}
+		size_t len = 0;
+		while (cur + len < end && !strchr(" \t\r\n,()", cur[len]))
+			len++;
+		char tok[len + 1];
+		memcpy(tok, cur, len);
+		tok[len] = 0;
+		cur += len;
+		if (!parens) {
+			want_files = !strcmp(tok, "GROUP") || !strcmp(tok, "INPUT");
+		} else if (in_files && strcmp(tok, "AS_NEEDED")) {
+			if (!strncmp(tok, "-l", 2)) {
+				cnt += resolve_lib(libs, tok + 2, dirs, depth);
+			} else if (tok[0] == '/' || !access(tok, R_OK)) {
+				cnt += resolve_lib_file(libs, tok, dirs, depth);
+			} else {
+				char *path = search_lib(tok, dirs);
+				if (path)
+					cnt += resolve_lib_file(libs, path, dirs, depth);
+				free(path);
+			}
+		}
+	}
+	return cnt;
+}
+
+/* add a shared object, or the libraries a linker script names; archives are skipped */
+static inline size_t resolve_lib_file(struct str_list *restrict libs, char const *restrict file,
+		char *const *restrict dirs, int depth)
+{
+	struct lib_map map;
+	size_t cnt = 0;
+
+	if (depth > LIB_SCRIPT_DEPTH || !map_lib(&map, file))
+		return 0;
+	if (is_native_lib(&map)) {
+		bool seen = false;
+		for (size_t i = 0; !seen && i < libs->cnt; i++)
+			seen = libs->list[i] && !strcmp(libs->list[i], file);
+		if (!seen)
+			append_str(libs, file, 0);
+		cnt = 1;
+	} else if (map.len < SELFMAG || (memcmp(map.buf, ELFMAG, SELFMAG) && memcmp(map.buf, "!<arch>", 7))) {
+		cnt = read_lib_script(libs, &map, dirs, depth + 1);
+	}
+	unmap_lib(&map);
+	return cnt;
+}
+
+/*
+ * resolve the `-l` flags and file names in `args` to the shared objects
+ * the linker would use, searching the `-L` flags in `ld_args` first;
+ * `libs` is left NULL-terminated
+ */
+static inline void resolve_libs(struct str_list *restrict libs, char *const *restrict args, char *const *restrict ld_args)
+{
+	struct str_list dirs;
+
+	init_str_list(libs);
+	lib_search_dirs(&dirs, ld_args);
+	for (size_t i = 0; args && args[i]; i++) {
+		if (!strncmp(args[i], "-l", 2))
+			resolve_lib(libs, args[i] + 2, dirs.list, 0);
+		else if (args[i][0] != '-')
+			resolve_lib_file(libs, args[i], dirs.list, 0);
+	}
+	free_str_list(&dirs);
+	append_str(libs, NULL, 0);
+}
+
+#endif /* !defined(LIBS_H) */
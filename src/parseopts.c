@@ -28,6 +28,7 @@ static struct option long_opts[] = {
 	{"intel", required_argument, 0, 'i'},
 	{"output", required_argument, 0, 'o'},
 	{"parse", no_argument, 0, 'p'},
+	{"simd", no_argument, 0, 's'},
 	{"tracking", no_argument, 0, 't'},
 	{"version", no_argument, 0, 'v'},
 	{"warnings", no_argument, 0, 'w'},
@@ -53,6 +54,10 @@ static char *const warn_list[] = {
 	"-pedantic",
 	NULL
 };
+static char *const simd_list[] = {
+	"-DCEPL_SIMD", "-march=native",
+	NULL
+};
 static char *const asm_list[] = {
 	"ERROR", "-masm=att", "-masm=intel",
 	NULL
@@ -60,7 +65,11 @@ static char *const asm_list[] = {
 static int option_index;
 static char *tmp_arg;
 
-extern struct str_list comp_list;
+extern struct id_list comp_list;
+extern struct sym_load sym_load;
+extern struct hdr_index hdr_index;
+extern struct sess_comps sess_comps;
+extern struct hist_index hist_index;
 extern char *comp_arg_list[];
 extern char const *prologue, *prog_start, *prog_start_user, *prog_end;
 /* getopts variables */
@@ -126,7 +135,7 @@ static inline void parse_input_file(struct program *restrict prog, char **restri
 				strchrnul(buf_ptr, '\n')[0] = 0;
 				/* skip single chars and argc/argv void statements */
 				if (strlen(buf_ptr) > 1 && strcmp(buf_ptr, "(void)argc, (void)argv;"))
-					dedup_history_add(&buf_ptr);
+					dedup_history_add(&hist_index, &buf_ptr);
 				break;
 			}
 			regfree(&reg[1]);
@@ -148,30 +157,22 @@ static inline void parse_input_file(struct program *restrict prog, char **restri
 	xfclose(&tmp_file);
 }
 
-static inline void copy_compiler(struct program *restrict prog)
+static inline void set_compiler(struct program *restrict prog, char const *restrict cc)
 {
+	/* prog->cc_list.list[0] is reserved for the compiler */
 	if (!prog->cc_list.list[0][0]) {
-		size_t cc_len = strlen(optarg) + 1;
-		size_t pval_len = strlen("FOOBARTHISVALUEDOESNTMATTERTROLLOLOLOL") + 1;
-		/* realloc if needed */
-		if (cc_len > pval_len) {
-			if (!(tmp_arg = realloc(prog->cc_list.list[0], cc_len)))
-				ERR("%s[%zu]", "prog->cc_list.list", (size_t)0);
-			/* copy argument to prog->cc_list.list[0] */
-			prog->cc_list.list[0] = tmp_arg;
-			memset(prog->cc_list.list[0], 0, strlen(optarg) + 1);
-		}
-		strmv(0, prog->cc_list.list[0], optarg);
+		if (!(tmp_arg = realloc(prog->cc_list.list[0], strlen(cc) + 1)))
+			ERR("%s[%zu]", "prog->cc_list.list", (size_t)0);
+		prog->cc_list.list[0] = tmp_arg;
+		strmv(0, prog->cc_list.list[0], cc);
 	}
 }
 
 static inline void copy_libs(struct program *restrict prog)
 {
-	char buf[strlen(optarg) + 12];
-	strmv(0, buf, "/lib/lib");
-	strmv(CONCAT, buf, optarg);
-	strmv(CONCAT, buf, ".so");
-	append_str(&prog->lib_list, buf, 0);
+	/* resolved to files by `build_sym_list()` once every `-L` flag is known */
+	append_str(&prog->lib_list, optarg, 2);
+	memcpy(prog->lib_list.list[prog->lib_list.cnt - 1], "-l", 2);
 	append_str(&prog->ld_list, optarg, 2);
 	memcpy(prog->ld_list.list[prog->ld_list.cnt - 1], "-l", 2);
 }
@@ -271,6 +272,10 @@ static inline void append_arg_list(struct program *restrict prog, char *const *c
 			append_str(&prog->lib_list, lib_list[i], 0);
 	if (prog->sflags.warn_flag)
 		enable_warnings(prog);
+	/* `<immintrin.h>` is only included by the prologue when `CEPL_SIMD` is defined */
+	if (prog->sflags.simd_flag)
+		for (size_t i = 0; simd_list[i]; i++)
+			append_str(&prog->cc_list, simd_list[i], 0);
 }
 
 static inline void build_arg_list(struct program *restrict prog, char *const *cc_list, char *const *ld_list)
@@ -281,8 +286,7 @@ static inline void build_arg_list(struct program *restrict prog, char *const *cc
 	char *libs = getenv("LIBS");
 
 	/* default to gcc as a compiler */
-	if (!prog->cc_list.list[0][0])
-		strmv(0, prog->cc_list.list[0], "gcc");
+	set_compiler(prog, "gcc");
 	append_arg_list(prog, cc_list, ld_list, NULL);
 	/* parse CFLAGS, LDFLAGS, LDLIBS, and LIBS from the environment (-g flags will hang) */
 	if (cflags)
@@ -306,76 +310,54 @@ static inline void build_arg_list(struct program *restrict prog, char *const *cc
 
 static inline void build_sym_list(struct program *restrict prog)
 {
+	struct str_list libs;
+	/* the header index is rebuilt when the flags or prologue change */
+	bool hdrs_changed = set_hdr_args(&hdr_index, prog->cc_list.list, prologue);
+	if (!prog->sflags.parse_flag) {
+		stop_sym_load(&sym_load);
+		free_id_list(&comp_list);
+		return;
+	}
+	/* preprocess the headers in the background so the first tab doesn't wait on it */
+	start_hdrs(&hdr_index);
 	/* parse ELF shared libraries for completions */
-	if (prog->sflags.parse_flag) {
-		init_str_list(&comp_list, NULL);
-		init_str_list(&prog->sym_list, NULL);
-		parse_libs(&prog->sym_list, prog->lib_list.list);
+	resolve_libs(&libs, prog->lib_list.list, prog->ld_list.list);
+	/* keep the index (and any load still in flight) while the library set is unchanged */
+	if (hdrs_changed || !same_sym_load(&sym_load, libs.list)) {
+		char *cache_file = sym_cache_file();
+		stop_sym_load(&sym_load);
+		free_id_list(&comp_list);
+		init_id_list(&comp_list);
+		/* completions are handles into the string pool so each symbol is stored once */
 		for (size_t i = 0; comp_arg_list[i]; i++)
-			append_str(&comp_list, comp_arg_list[i], 0);
-		for (size_t i = 0; i < prog->sym_list.cnt; i++)
-			append_str(&comp_list, prog->sym_list.list[i], 0);
-		append_str(&comp_list, NULL, 0);
-		append_str(&prog->sym_list, NULL, 0);
-		free_str_list(&prog->sym_list);
+			push_id_list(&comp_list, intern_str(&str_pool, comp_arg_list[i]));
+		index_comps(&comp_list);
+		merge_sess_comps(&sess_comps, &comp_list);
+		hdr_index.merged = false;
+		/* `generator()` merges libraries into `comp_list` as they finish */
+		start_sym_load(&sym_load, libs.list, cache_file, read_lib_syms, SYM_LOAD_THREADS);
+		free(cache_file);
 	}
+	free_str_list(&libs);
 }
 
-void read_syms(struct str_list *restrict tokens, char const *restrict elf_file)
+void read_syms(struct id_list *restrict tokens, char const *restrict elf_file)
 {
-	int elf_fd;
-	GElf_Shdr shdr;
-	Elf *elf;
-	Elf_Scn *scn = NULL;
-
-	/* sanity check filename */
-	if (!elf_file)
-		return;
-	/* coordinate API and lib versions */
-	if (elf_version(EV_CURRENT) == EV_NONE)
-		ERR("%s", "libelf out of date");
-	elf_fd = open(elf_file, O_RDONLY);
-	elf = elf_begin(elf_fd, ELF_C_READ, NULL);
-
-	while ((scn = elf_nextscn(elf, scn))) {
-		gelf_getshdr(scn, &shdr);
-		/* found a symbol table, go print it. */
-		if (shdr.sh_type == SHT_DYNSYM)
-			break;
-	}
-
-	/* don't try to parse if NULL section descriptor */
-	if (scn) {
-		Elf_Data *data = elf_getdata(scn, NULL);
-		size_t count = shdr.sh_size / shdr.sh_entsize;
-		/* read the symbol names */
-		for (size_t i = 0; i < count; i++) {
-			GElf_Sym sym;
-			char *sym_str;
-			gelf_getsym(data, i, &sym);
-			sym_str = elf_strptr(elf, shdr.sh_link, sym.st_name);
-			append_str(tokens, sym_str, 0);
-		}
-		append_str(tokens, NULL, 0);
-	}
+	struct char_list names;
 
-	elf_end(elf);
-	close(elf_fd);
+	init_char_list(&names);
+	read_lib_syms(&names, elf_file);
+	for (size_t i = 0; i < names.cnt; i += strlen(names.list + i) + 1)
+		push_id_list(tokens, intern_str(&str_pool, names.list + i));
+	free_char_list(&names);
 }
 
-void parse_libs(struct str_list *restrict symbols, char **restrict libs)
+void parse_libs(struct id_list *restrict symbols, char **restrict libs)
 {
-	for (size_t i = 0; libs[i]; i++) {
-		struct str_list cur_syms = {.cnt = 0, .max = 1, .list = NULL};
-		init_str_list(&cur_syms, NULL);
-		read_syms(&cur_syms, libs[i]);
-		for (size_t j = 0; j < cur_syms.cnt; j++) {
-			append_str(symbols, cur_syms.list[j], 0);
-		}
-		append_str(&cur_syms, NULL, 0);
-		free_str_list(&cur_syms);
-	}
-	append_str(symbols, NULL, 0);
+	char *cache_file = sym_cache_file();
+	/* only libraries changed since the last run are re-read */
+	cache_syms(symbols, libs, cache_file, read_lib_syms);
+	free(cache_file);
 }
 
 char **parse_opts(struct program *restrict prog, int argc, char **argv, char const *optstring)
@@ -387,9 +369,6 @@ char **parse_opts(struct program *restrict prog, int argc, char **argv, char con
 	free_str_list(&prog->cc_list);
 	free_str_list(&prog->ld_list);
 	free_str_list(&prog->lib_list);
-	free_str_list(&comp_list);
-	prog->cc_list.cnt = 0;
-	prog->cc_list.max = 1;
 	/* don't print an error if option not found */
 	opterr = 0;
 	/* reset option indices to reuse argv */
@@ -404,8 +383,9 @@ char **parse_opts(struct program *restrict prog, int argc, char **argv, char con
 	 */
 	prog->sflags.parse_flag ^= true;
 	prog->sflags.track_flag ^= true;
-	/* initilize argument lists */
-	init_str_list(&prog->cc_list, "FOOBARTHISVALUEDOESNTMATTERTROLLOLOLOL");
+	/* initilize argument lists (leaving an empty slot for the compiler) */
+	init_str_list(&prog->cc_list);
+	append_str(&prog->cc_list, "", 0);
 	/*
 	 * TODO:
 	 *
@@ -414,10 +394,9 @@ char **parse_opts(struct program *restrict prog, int argc, char **argv, char con
 	 * gcc for the link step. fix this properly
 	 * instead of using this band-aid.
 	 */
-	init_str_list(&prog->ld_list, "gcc");
-	init_str_list(&prog->lib_list, NULL);
-	/* re-zero prog->cc_list.list[0] so -c argument can be added */
-	memset(prog->cc_list.list[0], 0, strlen(prog->cc_list.list[0]) + 1);
+	init_str_list(&prog->ld_list);
+	append_str(&prog->ld_list, "gcc", 0);
+	init_str_list(&prog->lib_list);
 
 	while ((opt = getopt_long(argc, argv, optstring, long_opts, &option_index)) != -1) {
 		switch (opt) {
@@ -433,7 +412,7 @@ char **parse_opts(struct program *restrict prog, int argc, char **argv, char con
 
 		/* specify compiler */
 		case 'c':
-			copy_compiler(prog);
+			set_compiler(prog, optarg);
 			break;
 
 		/* eval string */
@@ -466,6 +445,11 @@ char **parse_opts(struct program *restrict prog, int argc, char **argv, char con
 			prog->sflags.parse_flag ^= true;
 			break;
 
+		/* simd flag */
+		case 's':
+			prog->sflags.simd_flag ^= true;
+			break;
+
 		/* track flag */
 		case 't':
 			prog->sflags.track_flag ^= true;
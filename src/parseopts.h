@@ -10,9 +10,11 @@
 
 #include "defs.h"
 #include "errs.h"
+#include "hdrs.h"
+#include "intern.h"
+#include "libs.h"
+#include "symcache.h"
 #include <fcntl.h>
-#include <gelf.h>
-#include <libelf.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -22,8 +24,8 @@
 #include <unistd.h>
 
 /* prototypes */
-void read_syms(struct str_list *restrict tokens, char const *restrict elf_file);
-void parse_libs(struct str_list *restrict symbols, char **restrict libs);
+void read_syms(struct id_list *restrict tokens, char const *restrict elf_file);
+void parse_libs(struct id_list *restrict symbols, char **restrict libs);
 char **parse_opts(struct program *restrict prog, int argc, char **argv, char const *optstring);
 
 #endif /* !defined(PARSEOPTS_H) */
@@ -25,23 +25,43 @@ char *comp_arg_list[] = {
 	"free(", "memcpy(", "memset(", "memcmp(", "fread(", "fwrite(",
 	"strcat(", "strtok(", "strcpy(", "strlen(", "puts(", "system(",
 	"fopen(", "fclose(", "sprintf(", "printf(", "scanf(",
-	";att", ";function", ";help", ";intel", ";macro", ";output",
-	";parse", ";quit", ";reset", ";tracking", ";undo", ";warnings", NULL
+	";att", ";bench", ";dump", ";explain", ";function", ";help", ";hist",
+	";intel", ";layout", ";macro", ";output", ";parse", ";quit", ";reset",
+	";simd", ";tracking", ";undo", ";vars", ";warnings", NULL
 };
 /* global completion list struct */
-struct str_list comp_list;
+struct id_list comp_list;
+/* global background library symbol loader */
+struct sym_load sym_load;
+/* global index of the prologue headers */
+struct hdr_index hdr_index;
+/* global completions defined by the session */
+struct sess_comps sess_comps;
+/* global string pool */
+struct str_pool str_pool;
 
 char *generator(char const *text, int state)
 {
-	static size_t list_index, len;
+	static size_t list_index, list_end, len;
 	char *name, *buf;
-	/* if no generated completions use the defaults */
-	char **completions = DEFAULT(comp_list.list, comp_arg_list);
 	if (!state) {
-		list_index = 0;
 		len = strlen(text);
+		/* pick up libraries the loader has finished since the last tab and the header index */
+		if (poll_sym_load(&sym_load, &comp_list) | merge_hdrs(&hdr_index, &comp_list))
+			index_comps(&comp_list);
+		/* `comp_list` is sorted so matches are one contiguous range */
+		list_index = comp_list.list ? comp_bound(&comp_list, text, len, false) : 0;
+		list_end = comp_list.list ? comp_bound(&comp_list, text, len, true) : 0;
 	}
-	while ((name = completions[list_index++])) {
+	for (;;) {
+		/* if no generated completions use the defaults */
+		if (comp_list.list) {
+			if (list_index >= list_end)
+				break;
+			name = pool_str(&str_pool, comp_list.list[list_index++]);
+		} else if (!(name = comp_arg_list[list_index++])) {
+			break;
+		}
 		if (strncmp(name, text, len) == 0) {
 			if (!(buf = calloc(1, strlen(name) + 1))) {
 				WARN("%s", "error allocating generator string");
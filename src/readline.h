@@ -9,7 +9,9 @@
 #define READLINE_H 1
 
 #include "defs.h"
+#include "intern.h"
 #include "parseopts.h"
+#include "symcache.h"
 #include <readline/history.h>
 #include <readline/readline.h>
 
@@ -33,9 +35,130 @@
 # define RL_STATE_MULTIKEY 0
 #endif
 
+/* a completion the session defined and the history line count when it did */
+struct sess_comp {
+	size_t id, line;
+	/* false if `comp_list` already had the name */
+	bool added;
+};
+
+VEC_DEFINE(sess_list, struct sess_comp, 16, NO_DTOR)
+
+/* names from `var_list` and `;f`/`;m` definitions, in line order */
+struct sess_comps {
+	struct sess_list names;
+	/* `var_list` entries already looked at */
+	size_t var_cnt;
+};
+
 /* prototypes */
 char *generator(char const *text, int state);
 
+/* order completion handles by the strings they name */
+static inline int comp_cmp(void const *a, void const *b)
+{
+	return strcmp(pool_str(&str_pool, *(size_t const *)a), pool_str(&str_pool, *(size_t const *)b));
+}
+
+/* sort and deduplicate completions so prefixes can be binary searched */
+static inline void index_comps(struct id_list *restrict list)
+{
+	size_t cnt = 0;
+	if (!list->cnt)
+		return;
+	qsort(list->list, list->cnt, sizeof *list->list, comp_cmp);
+	/* interned strings compare equal only if their handles do */
+	for (size_t i = 0; i < list->cnt; i++) {
+		if (!cnt || list->list[cnt - 1] != list->list[i])
+			list->list[cnt++] = list->list[i];
+	}
+	list->cnt = cnt;
+}
+
+/* index of the first sorted completion starting with (or after, if `upper`) `prefix` */
+static inline size_t comp_bound(struct id_list const *restrict list, char const *restrict prefix, size_t len, bool upper)
+{
+	size_t lo = 0, hi = list->cnt;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		int cmp = strncmp(pool_str(&str_pool, list->list[mid]), prefix, len);
+		if (cmp < 0 || (upper && !cmp))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* insert a completion at its sorted position, returning false if it was already there */
+static inline bool insert_comp(struct id_list *restrict list, size_t id)
+{
+	char const *name = pool_str(&str_pool, id);
+	/* comparing the terminator too makes the bound exact */
+	size_t pos = comp_bound(list, name, strlen(name) + 1, false);
+	if (!list->list || (pos < list->cnt && list->list[pos] == id))
+		return false;
+	push_id_list(list, 0);
+	memmove(list->list + pos + 1, list->list + pos, sizeof *list->list * (list->cnt - pos - 1));
+	list->list[pos] = id;
+	return true;
+}
+
+static inline void remove_comp(struct id_list *restrict list, size_t id)
+{
+	char const *name = pool_str(&str_pool, id);
+	size_t pos = comp_bound(list, name, strlen(name) + 1, false);
+	if (!list->list || pos >= list->cnt || list->list[pos] != id)
+		return;
+	memmove(list->list + pos, list->list + pos + 1, sizeof *list->list * (list->cnt - pos - 1));
+	list->cnt--;
+}
+
+static inline void init_sess_comps(struct sess_comps *restrict sess)
+{
+	init_sess_list(&sess->names);
+	sess->var_cnt = 0;
+}
+
+static inline void free_sess_comps(struct sess_comps *restrict sess)
+{
+	free_sess_list(&sess->names);
+	sess->var_cnt = 0;
+}
+
+/* complete `id` until the history drops below `line` */
+static inline void add_sess_comp(struct sess_comps *restrict sess, struct id_list *restrict list, size_t id, size_t line)
+{
+	push_sess_list(&sess->names, (struct sess_comp){.id = id, .line = line, .added = insert_comp(list, id)});
+}
+
+/* pick up the `var_list` entries declared since the last call */
+static inline void add_var_comps(struct sess_comps *restrict sess, struct id_list *restrict list, struct var_list const *restrict vars)
+{
+	for (; sess->var_cnt < vars->cnt; sess->var_cnt++)
+		add_sess_comp(sess, list, vars->list[sess->var_cnt].id, vars->list[sess->var_cnt].line);
+}
+
+/* drop the names defined after the history shrank to `line` lines */
+static inline void pop_sess_comps(struct sess_comps *restrict sess, struct id_list *restrict list, size_t line, size_t var_cnt)
+{
+	size_t cnt = sess->names.cnt;
+	/* names are appended in line order so only the tail can go (all of it after a reset) */
+	for (; cnt > 0 && (!line || sess->names.list[cnt - 1].line > line); cnt--) {
+		if (sess->names.list[cnt - 1].added)
+			remove_comp(list, sess->names.list[cnt - 1].id);
+	}
+	truncate_sess_list(&sess->names, cnt);
+	sess->var_cnt = line ? MIN(sess->var_cnt, var_cnt) : 0;
+}
+
+/* re-insert every session name into a rebuilt (and indexed) `comp_list` */
+static inline void merge_sess_comps(struct sess_comps *restrict sess, struct id_list *restrict list)
+{
+	for (size_t i = 0; i < sess->names.cnt; i++)
+		sess->names.list[i].added = insert_comp(list, sess->names.list[i].id);
+}
+
 static inline char **completer(char const *text, int start, int end)
 {
 	/* silence -Wunused-parameter warning */
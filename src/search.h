@@ -0,0 +1,208 @@
+/*
+ * search.h - trigram index over history lines
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(SEARCH_H)
+#define SEARCH_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include "idmap.h"
+#include "intern.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* matches `;hist` prints */
+#define SEARCH_SHOWN	20
+/* matches ^R steps through */
+#define SEARCH_STEPS	0x400
+/* fewest postings before stale ones are reclaimed */
+#define SEARCH_COMPACT_MIN	0x1000
+
+/* `tri_map` key of the trigram starting at `str`, packed into 24 bits (+ 1 since 0 marks an empty map slot) */
+static inline size_t search_tri(char const *restrict str)
+{
+	unsigned char const *cur = (unsigned char const *)str;
+	return ((size_t)cur[0] << 16 | (size_t)cur[1] << 8 | cur[2]) + 1;
+}
+
+static inline void free_hist_search(struct hist_search *restrict search)
+{
+	free_pool(&search->text);
+	free_search_line_list(&search->lines);
+	free_id_map(&search->line_map);
+	free_id_map(&search->tri_map);
+	free_search_tri_list(&search->tris);
+	free_search_post_list(&search->posts);
+	free_search_post_list(&search->pending);
+	search->seq = search->stale = 0;
+}
+
+/* add `line`, or mark it entered again, returning its index in `lines` */
+static inline size_t add_search_line(struct hist_search *restrict search, char const *restrict line)
+{
+	size_t id = intern_str(&search->text, line);
+	ptrdiff_t idx = find_id(&search->line_map, id);
+	if (idx == -1) {
+		push_search_line_list(&search->lines, (struct search_line){.id = id});
+		idx = search->lines.cnt - 1;
+		set_id(&search->line_map, id, idx);
+	}
+	search->lines.list[idx].last = ++search->seq;
+	push_search_post_list(&search->pending, (struct search_post){.line = idx, .seq = search->seq});
+	return idx;
+}
+
+/* link the trigrams of the line `ent` names into their chains, returning how many of them were there before */
+static inline size_t post_search_line(struct hist_search *restrict search, struct search_post ent)
+{
+	struct search_line *ln = &search->lines.list[ent.line];
+	/* nothing below interns, so `line` outlives the loop */
+	char const *line = pool_str(&search->text, ln->id);
+	size_t reposted = 0;
+
+	for (size_t i = 0; line[i] && line[i + 1] && line[i + 2]; i++) {
+		size_t key = search_tri(line + i);
+		ptrdiff_t tri = find_id(&search->tri_map, key);
+		if (tri == -1) {
+			push_search_tri_list(&search->tris, (struct search_tri){0});
+			tri = search->tris.cnt - 1;
+			set_id(&search->tri_map, key, tri);
+		}
+		struct search_tri *cur = &search->tris.list[tri];
+		/* a trigram repeated within the line is posted once */
+		if (cur->head && search->posts.list[cur->head - 1].seq == ent.seq)
+			continue;
+		ent.next = cur->head;
+		push_search_post_list(&search->posts, ent);
+		cur->head = search->posts.cnt;
+		/* the same text was posted before, so this replaces a live posting */
+		if (ln->posted)
+			reposted++;
+		else
+			cur->cnt++;
+	}
+	ln->posted = ent.seq;
+	return reposted;
+}
+
+/* cmp function for line indices by the `last` their postings carry */
+static inline int cmp_posted(void const *a, void const *b, void *lines)
+{
+	size_t x = ((struct search_line const *)lines)[*(size_t const *)a].posted;
+	size_t y = ((struct search_line const *)lines)[*(size_t const *)b].posted;
+	return (x > y) - (x < y);
+}
+
+/* drop stale postings by posting every posted line again, oldest first */
+static inline void compact_search(struct hist_search *restrict search)
+{
+	struct size_list order;
+
+	init_size_list(&order);
+	for (size_t i = 0; i < search->lines.cnt; i++) {
+		if (search->lines.list[i].posted)
+			push_size_list(&order, i);
+	}
+	qsort_r(order.list, order.cnt, sizeof *order.list, cmp_posted, search->lines.list);
+	truncate_search_post_list(&search->posts, 0);
+	for (size_t i = 0; i < search->tris.cnt; i++)
+		search->tris.list[i] = (struct search_tri){0};
+	for (size_t i = 0; i < order.cnt; i++) {
+		struct search_line *ln = &search->lines.list[order.list[i]];
+		struct search_post ent = {.line = order.list[i], .seq = ln->posted};
+		ln->posted = 0;
+		post_search_line(search, ent);
+	}
+	search->stale = 0;
+	free_size_list(&order);
+}
+
+/*
+ * post the trigrams of lines entered since the last search, so loading a
+ * long history costs nothing until it is searched; lines are posted in
+ * the order they were entered, so every chain runs from the newest down
+ */
+static inline void post_search_lines(struct hist_search *restrict search)
+{
+	for (size_t j = 0; j < search->pending.cnt; j++) {
+		struct search_post ent = search->pending.list[j];
+		/* only post the last time a line was entered */
+		if (search->lines.list[ent.line].last != ent.seq)
+			continue;
+		search->stale += post_search_line(search, ent);
+	}
+	truncate_search_post_list(&search->pending, 0);
+	/* lines entered again leave their old postings behind, so reclaim them once they are half of all postings */
+	if (search->posts.cnt >= SEARCH_COMPACT_MIN && search->stale * 2 > search->posts.cnt)
+		compact_search(search);
+}
+
+/* insert the line at `idx` into `out` (newest first, at most `max` long) if it contains `query` */
+static inline void match_search_line(struct hist_search const *restrict search, size_t idx,
+		char const *restrict query, bool ok_only, size_t max, struct search_line_list *restrict out)
+{
+	struct search_line const *line = &search->lines.list[idx];
+	if (ok_only && !line->ok)
+		return;
+	/* once `out` is full, older lines are rejected before comparing any text */
+	if (out->cnt == max && line->last < out->list[max - 1].last)
+		return;
+	if (!strstr(pool_str(&search->text, line->id), query))
+		return;
+	size_t pos = out->cnt;
+	if (pos < max)
+		push_search_line_list(out, *line);
+	else
+		pos = max - 1;
+	for (; pos && out->list[pos - 1].last < line->last; pos--)
+		out->list[pos] = out->list[pos - 1];
+	out->list[pos] = *line;
+}
+
+/*
+ * collect the `max` most recently entered lines containing `query` into
+ * `out` newest first, walking only the postings of its rarest trigram and
+ * stopping once `out` is full
+ */
+static inline size_t search_hist(struct hist_search *restrict search, char const *restrict query,
+		bool ok_only, size_t max, struct search_line_list *restrict out)
+{
+	size_t len = strlen(query), head = 0, cnt = SIZE_MAX;
+
+	init_search_line_list(out);
+	if (!max)
+		return 0;
+	/* queries too short for a trigram check every line */
+	if (len < 3) {
+		for (size_t i = search->lines.cnt; i-- > 0;)
+			match_search_line(search, i, query, ok_only, max, out);
+		return out->cnt;
+	}
+	post_search_lines(search);
+	for (size_t i = 0; i + 2 < len; i++) {
+		ptrdiff_t tri = find_id(&search->tri_map, search_tri(query + i));
+		/* a trigram no line has rules everything out */
+		if (tri == -1)
+			return 0;
+		if (search->tris.list[tri].cnt < cnt) {
+			cnt = search->tris.list[tri].cnt;
+			head = search->tris.list[tri].head;
+		}
+	}
+	for (size_t post = head; post && out->cnt < max; post = search->posts.list[post - 1].next) {
+		struct search_post const *cur = &search->posts.list[post - 1];
+		/* the line was entered again and posted nearer the head */
+		if (cur->seq != search->lines.list[cur->line].posted)
+			continue;
+		match_search_line(search, cur->line, query, ok_only, max, out);
+	}
+	return out->cnt;
+}
+
+#endif /* !defined(SEARCH_H) */
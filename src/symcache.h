@@ -0,0 +1,423 @@
+/*
+ * symcache.h - persistent library symbol cache
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(SYMCACHE_H)
+#define SYMCACHE_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include "intern.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* cache file magic (bump the digit when the layout changes) */
+#define SYM_CACHE_MAGIC	"CEPLSYM1"
+/* cache file name, relative to `$HOME` */
+#define SYM_CACHE_NAME	".cepl_syms"
+/* maximum worker threads reading libraries in the background */
+#define SYM_LOAD_THREADS	8
+
+/*
+ * the cache file is a header, an entry table, then NUL-terminated
+ * library paths and NUL-separated symbol blobs; every field is a
+ * fixed-width native-endian integer so a mapping can be used in place
+ */
+struct sym_cache_hdr {
+	char magic[8];
+	uint64_t cnt;
+};
+
+struct sym_cache_ent {
+	/* key identifying one version of a library */
+	uint64_t dev, ino, size, mtime_sec, mtime_nsec;
+	/* byte offsets into the cache file */
+	uint64_t path_off, strs_off, strs_len;
+};
+
+/* an entry plus where its path and symbols live while a new cache is written */
+struct sym_cache_rec {
+	struct sym_cache_ent ent;
+	char const *path, *strs;
+};
+
+/*
+ * reads the symbols of one library as NUL-terminated names appended
+ * to `names`; called from worker threads so it must not touch `str_pool`
+ */
+typedef void sym_read_fn(struct char_list *restrict names, char const *restrict lib);
+
+/* one library being loaded */
+struct sym_lib {
+	char *path;
+	struct stat st;
+	/* whether `st` is valid and whether the names came from the cache */
+	bool keyed, hit;
+	struct sym_cache_ent ent;
+	/* NUL-separated names, pointing into the cache mapping or `blob` */
+	char const *strs;
+	size_t strs_len;
+	struct char_list blob;
+	/* set by a worker once `strs` is filled in */
+	atomic_bool done;
+	/* set by the main thread once the names are in the completion list */
+	bool merged;
+};
+
+/*
+ * background symbol loader; workers claim libraries through `next`
+ * and only ever write their own `sym_lib`, while merging into the
+ * string pool and completion list happens on the main thread
+ */
+struct sym_load {
+	bool active;
+	char *cache_file;
+	char const *map;
+	size_t map_len;
+	sym_read_fn *read;
+	struct sym_lib *libs;
+	size_t cnt, merged, thread_cnt;
+	atomic_size_t next;
+	atomic_bool cancel;
+	pthread_t threads[SYM_LOAD_THREADS];
+};
+
+/* build the cache path, returning `NULL` if `$HOME` is unset */
+static inline char *sym_cache_file(void)
+{
+	char const *home = getenv("HOME");
+	char *file;
+	if (!home || !home[0])
+		return NULL;
+	xmalloc(char, &file, strlen(home) + sizeof SYM_CACHE_NAME + 1, "sym_cache_file()");
+	strmv(0, file, home);
+	strmv(CONCAT, file, "/");
+	strmv(CONCAT, file, SYM_CACHE_NAME);
+	return file;
+}
+
+/* map a cache file read-only, returning `NULL` if it is missing or malformed */
+static inline char const *map_sym_cache(char const *restrict cache_file, size_t *restrict map_len)
+{
+	struct stat st;
+	int fd = open(cache_file, O_RDONLY|O_CLOEXEC);
+	void *map;
+	*map_len = 0;
+	if (fd == -1)
+		return NULL;
+	if (fstat(fd, &st) || (size_t)st.st_size < sizeof(struct sym_cache_hdr)) {
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+	struct sym_cache_hdr const *hdr = map;
+	if (memcmp(hdr->magic, SYM_CACHE_MAGIC, sizeof hdr->magic)
+			|| hdr->cnt > (st.st_size - sizeof *hdr) / sizeof(struct sym_cache_ent)) {
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	*map_len = st.st_size;
+	return map;
+}
+
+/* bounds-check an entry so a truncated or corrupt cache is never read past its end */
+static inline bool valid_sym_ent(char const *restrict map, size_t map_len, struct sym_cache_ent const *restrict ent)
+{
+	if (ent->path_off >= map_len || !memchr(map + ent->path_off, 0, map_len - ent->path_off))
+		return false;
+	if (ent->strs_off > map_len || ent->strs_len > map_len - ent->strs_off)
+		return false;
+	return !ent->strs_len || !map[ent->strs_off + ent->strs_len - 1];
+}
+
+/* find the entry for `lib`, returning `NULL` if it is absent or the library has changed */
+static inline struct sym_cache_ent const *find_sym_ent(char const *restrict map, size_t map_len,
+		char const *restrict lib, struct stat const *restrict st)
+{
+	if (!map)
+		return NULL;
+	struct sym_cache_hdr const *hdr = (struct sym_cache_hdr const *)map;
+	struct sym_cache_ent const *ents = (struct sym_cache_ent const *)(hdr + 1);
+	for (size_t i = 0; i < hdr->cnt; i++) {
+		struct sym_cache_ent const *ent = &ents[i];
+		if (!valid_sym_ent(map, map_len, ent) || strcmp(map + ent->path_off, lib))
+			continue;
+		if (ent->dev == (uint64_t)st->st_dev && ent->ino == (uint64_t)st->st_ino
+				&& ent->size == (uint64_t)st->st_size
+				&& ent->mtime_sec == (uint64_t)st->st_mtim.tv_sec
+				&& ent->mtime_nsec == (uint64_t)st->st_mtim.tv_nsec)
+			return ent;
+		/* a library path has at most one entry */
+		return NULL;
+	}
+	return NULL;
+}
+
+/* write `recs` to a temporary file and rename it over the cache so readers never see a partial file */
+static inline int write_sym_cache(char const *restrict cache_file, struct sym_cache_rec *restrict recs, size_t cnt)
+{
+	struct sym_cache_hdr hdr = {.cnt = cnt};
+	size_t off = sizeof hdr + cnt * sizeof recs->ent;
+	char tmp_file[strlen(cache_file) + sizeof ".XXXXXX"];
+	FILE *out;
+	int fd;
+
+	strmv(0, tmp_file, cache_file);
+	strmv(CONCAT, tmp_file, ".XXXXXX");
+	if ((fd = mkstemp(tmp_file)) == -1)
+		return -1;
+	if (!(out = fdopen(fd, "wb"))) {
+		close(fd);
+		unlink(tmp_file);
+		return -1;
+	}
+	memcpy(hdr.magic, SYM_CACHE_MAGIC, sizeof hdr.magic);
+	/* lay out the string data after the table */
+	for (size_t i = 0; i < cnt; i++) {
+		recs[i].ent.path_off = off;
+		off += strlen(recs[i].path) + 1;
+		recs[i].ent.strs_off = off;
+		off += recs[i].ent.strs_len;
+	}
+	fwrite(&hdr, sizeof hdr, 1, out);
+	for (size_t i = 0; i < cnt; i++)
+		fwrite(&recs[i].ent, sizeof recs[i].ent, 1, out);
+	for (size_t i = 0; i < cnt; i++) {
+		fwrite(recs[i].path, strlen(recs[i].path) + 1, 1, out);
+		fwrite(recs[i].strs, 1, recs[i].ent.strs_len, out);
+	}
+	if (ferror(out) | fclose(out) || rename(tmp_file, cache_file)) {
+		unlink(tmp_file);
+		return -1;
+	}
+	return 0;
+}
+
+/* fill in the names of one library from the cache or by reading it */
+static inline void load_sym_lib(struct sym_load *restrict load, struct sym_lib *restrict lib)
+{
+	struct sym_cache_ent const *ent;
+	init_char_list(&lib->blob);
+	/* a library that can't be stat(2)ed has no key to cache under */
+	lib->keyed = !stat(lib->path, &lib->st);
+	if (lib->keyed && (ent = find_sym_ent(load->map, load->map_len, lib->path, &lib->st))) {
+		lib->hit = true;
+		lib->ent = *ent;
+		lib->strs = load->map + ent->strs_off;
+		lib->strs_len = ent->strs_len;
+		return;
+	}
+	load->read(&lib->blob, lib->path);
+	lib->strs = lib->blob.list;
+	lib->strs_len = lib->blob.cnt;
+	lib->ent = (struct sym_cache_ent){
+		.dev = lib->st.st_dev, .ino = lib->st.st_ino, .size = lib->st.st_size,
+		.mtime_sec = lib->st.st_mtim.tv_sec, .mtime_nsec = lib->st.st_mtim.tv_nsec,
+		.strs_len = lib->blob.cnt,
+	};
+}
+
+static inline void *sym_worker(void *arg)
+{
+	struct sym_load *load = arg;
+	for (;;) {
+		if (atomic_load_explicit(&load->cancel, memory_order_relaxed))
+			break;
+		size_t i = atomic_fetch_add_explicit(&load->next, 1, memory_order_relaxed);
+		if (i >= load->cnt)
+			break;
+		load_sym_lib(load, &load->libs[i]);
+		/* publish `strs` to the main thread */
+		atomic_store_explicit(&load->libs[i].done, true, memory_order_release);
+	}
+	return NULL;
+}
+
+/* rewrite the cache if any finished library had to be read */
+static inline void save_sym_cache(struct sym_load *restrict load)
+{
+	struct sym_cache_hdr const *hdr = (struct sym_cache_hdr const *)load->map;
+	size_t old_cnt = load->map ? hdr->cnt : 0, rec_cnt = 0;
+	struct sym_cache_rec *recs;
+	bool stale = false;
+
+	if (!load->cache_file)
+		return;
+	for (size_t i = 0; i < load->cnt; i++) {
+		struct sym_lib const *lib = &load->libs[i];
+		stale |= atomic_load_explicit(&lib->done, memory_order_acquire) && lib->keyed && !lib->hit;
+	}
+	if (!stale)
+		return;
+	xmalloc(struct sym_cache_rec, &recs, sizeof *recs * (load->cnt + old_cnt + 1), "save_sym_cache()");
+	for (size_t i = 0; i < load->cnt; i++) {
+		struct sym_lib const *lib = &load->libs[i];
+		if (atomic_load_explicit(&lib->done, memory_order_acquire) && lib->keyed)
+			recs[rec_cnt++] = (struct sym_cache_rec){lib->ent, lib->path, lib->strs};
+	}
+	/* keep entries for libraries not refreshed here so switching `-l` flags stays cached */
+	struct sym_cache_ent const *ents = (struct sym_cache_ent const *)(hdr + 1);
+	for (size_t i = 0; i < old_cnt; i++) {
+		bool listed = false;
+		if (!valid_sym_ent(load->map, load->map_len, &ents[i]))
+			continue;
+		for (size_t j = 0; !listed && j < rec_cnt; j++)
+			listed = !strcmp(load->map + ents[i].path_off, recs[j].path);
+		if (!listed)
+			recs[rec_cnt++] = (struct sym_cache_rec){ents[i], load->map + ents[i].path_off, load->map + ents[i].strs_off};
+	}
+	if (write_sym_cache(load->cache_file, recs, rec_cnt))
+		WARN("%s", "error writing symbol cache");
+	free(recs);
+}
+
+/* join the workers, save the cache, and release everything but the library paths */
+static inline void finish_sym_load(struct sym_load *restrict load)
+{
+	for (size_t i = 0; i < load->thread_cnt; i++)
+		pthread_join(load->threads[i], NULL);
+	load->thread_cnt = 0;
+	save_sym_cache(load);
+	for (size_t i = 0; i < load->cnt; i++) {
+		free_char_list(&load->libs[i].blob);
+		load->libs[i].strs = NULL;
+	}
+	if (load->map)
+		munmap((void *)load->map, load->map_len);
+	load->map = NULL;
+	free(load->cache_file);
+	load->cache_file = NULL;
+}
+
+/*
+ * start loading the symbols of the NULL-terminated `libs` on up to
+ * `max_threads` workers (inline if zero), caching in `cache_file`
+ * unless it is NULL
+ */
+static inline void start_sym_load(struct sym_load *restrict load, char *const *restrict libs,
+		char const *restrict cache_file, sym_read_fn *read, size_t max_threads)
+{
+	sigset_t all, old;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	*load = (struct sym_load){.active = true, .read = read};
+	atomic_init(&load->next, 0);
+	atomic_init(&load->cancel, false);
+	for (; libs[load->cnt]; load->cnt++);
+	xcalloc(struct sym_lib, &load->libs, load->cnt + 1, sizeof *load->libs, "start_sym_load()");
+	for (size_t i = 0; i < load->cnt; i++) {
+		xmalloc(char, &load->libs[i].path, strlen(libs[i]) + 1, "start_sym_load()");
+		strmv(0, load->libs[i].path, libs[i]);
+		atomic_init(&load->libs[i].done, false);
+	}
+	if (cache_file) {
+		xmalloc(char, &load->cache_file, strlen(cache_file) + 1, "start_sym_load()");
+		strmv(0, load->cache_file, cache_file);
+		load->map = map_sym_cache(cache_file, &load->map_len);
+	}
+
+	max_threads = MIN(MIN(max_threads, SYM_LOAD_THREADS), load->cnt);
+	max_threads = MIN(max_threads, (size_t)((cpus > 0) ? cpus : 1));
+	/* workers leave signals to the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	for (; load->thread_cnt < max_threads; load->thread_cnt++) {
+		if (pthread_create(&load->threads[load->thread_cnt], NULL, sym_worker, load))
+			break;
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	/* fall back to loading everything now */
+	if (!load->thread_cnt)
+		sym_worker(load);
+}
+
+/* whether a load of exactly `libs` was already started */
+static inline bool same_sym_load(struct sym_load const *restrict load, char *const *restrict libs)
+{
+	size_t i = 0;
+	if (!load->active)
+		return false;
+	for (; libs[i] && i < load->cnt; i++) {
+		if (strcmp(libs[i], load->libs[i].path))
+			return false;
+	}
+	return !libs[i] && i == load->cnt;
+}
+
+/*
+ * append the symbols of every library finished since the last call
+ * to `syms` (in library order once all are done), returning true if
+ * any were added so the caller can re-index
+ */
+static inline bool poll_sym_load(struct sym_load *restrict load, struct id_list *restrict syms)
+{
+	size_t merged = load->merged;
+	if (!load->active || load->merged == load->cnt)
+		return false;
+	for (size_t i = 0; i < load->cnt; i++) {
+		struct sym_lib *lib = &load->libs[i];
+		if (lib->merged || !atomic_load_explicit(&lib->done, memory_order_acquire))
+			continue;
+		char const *end = lib->strs + lib->strs_len;
+		for (char const *name = lib->strs; name < end; name += strlen(name) + 1) {
+			if (*name)
+				push_id_list(syms, intern_len(&str_pool, name, strlen(name)));
+		}
+		lib->merged = true;
+		load->merged++;
+	}
+	if (load->merged == load->cnt)
+		finish_sym_load(load);
+	return load->merged != merged;
+}
+
+/* block until every library is merged into `syms` */
+static inline void wait_sym_load(struct sym_load *restrict load, struct id_list *restrict syms)
+{
+	for (size_t i = 0; i < load->thread_cnt; i++)
+		pthread_join(load->threads[i], NULL);
+	load->thread_cnt = 0;
+	poll_sym_load(load, syms);
+}
+
+/* cancel any load in flight and release everything */
+static inline void stop_sym_load(struct sym_load *restrict load)
+{
+	if (!load->active)
+		return;
+	atomic_store_explicit(&load->cancel, true, memory_order_relaxed);
+	finish_sym_load(load);
+	for (size_t i = 0; i < load->cnt; i++)
+		free(load->libs[i].path);
+	free(load->libs);
+	*load = (struct sym_load){0};
+}
+
+/* synchronously append the symbols of every library in `libs` to `syms` through the cache */
+static inline void cache_syms(struct id_list *restrict syms, char *const *restrict libs,
+		char const *restrict cache_file, sym_read_fn *read)
+{
+	struct sym_load load;
+	start_sym_load(&load, libs, cache_file, read, 0);
+	wait_sym_load(&load, syms);
+	stop_sym_load(&load);
+}
+
+#endif /* !defined(SYMCACHE_H) */
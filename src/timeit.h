@@ -0,0 +1,180 @@
+/*
+ * timeit.h - calibrated timing loops for `;bench`
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#if !defined(TIMEIT_H)
+#define TIMEIT_H 1
+
+#include "defs.h"
+#include "errs.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* timed batches kept and batches thrown away first */
+#define TIMEIT_SAMPLES		100
+#define TIMEIT_WARMUP		10
+/* fewest batches reported even past the budget */
+#define TIMEIT_MIN_SAMPLES	10
+/* shortest batch in ns, well above the clock's resolution and call overhead */
+#define TIMEIT_BATCH_NS		1000000
+/* ns a run may take before sampling stops early */
+#define TIMEIT_BUDGET_NS	2000000000LL
+
+/* written to the record fd ahead of `cnt` doubles of ns per iteration */
+struct timeit_hdr {
+	uint64_t iters, cnt;
+};
+
+struct timeit_stats {
+	double mean, stddev, min, median, p99;
+	uint64_t iters, cnt;
+};
+
+/*
+ * append a block timing `stmt` to `src`, which must already hold the
+ * session up to the end of its body; an expression's value is forced
+ * into memory every iteration so it cannot be computed once or dropped,
+ * and so are the variables named by the NULL-terminated `opaque` (if
+ * non-NULL) so work on them cannot be hoisted out of the loop or folded
+ */
+static inline void build_timeit(struct char_list *restrict src, char const *restrict stmt, bool expr,
+		char const *const *restrict opaque, int fd)
+{
+	char const head[] =
+		"\n\t{"
+		"\n\tstruct timespec cepl_beg_, cepl_t0_, cepl_t1_;"
+		"\n\tuint64_t cepl_hdr_[2] = {1, 0};"
+		"\n\tdouble cepl_ns_[%d];"
+		"\n\tclock_gettime(CLOCK_MONOTONIC, &cepl_beg_);"
+		"\n\tfor (int cepl_s_ = -%d; cepl_s_ < %d; cepl_s_++) {"
+		"\n\t\tclock_gettime(CLOCK_MONOTONIC, &cepl_t0_);"
+		"\n\t\tfor (uint64_t cepl_i_ = 0; cepl_i_ < cepl_hdr_[0]; cepl_i_++) {";
+	/* the asm may have written through the address, so the variable is reloaded */
+	char const opaque_fmt[] =
+		"\n\t\t\t__asm__ volatile (\"\" : : \"r\"(&(%s)) : \"memory\");";
+	char const expr_fmt[] =
+		"\n\t\t\t{ __typeof__(%.*s) cepl_val_ = (%.*s); __asm__ volatile (\"\" : : \"r\"(&cepl_val_) : \"memory\"); }";
+	char const stmt_fmt[] =
+		"\n\t\t\t%s;"
+		"\n\t\t\t__asm__ volatile (\"\" : : : \"memory\");";
+	char const tail[] =
+		"\n\t\t}"
+		"\n\t\tclock_gettime(CLOCK_MONOTONIC, &cepl_t1_);"
+		"\n\t\tdouble cepl_dt_ = (cepl_t1_.tv_sec - cepl_t0_.tv_sec) * 1e9 + (cepl_t1_.tv_nsec - cepl_t0_.tv_nsec);"
+		"\n\t\tdouble cepl_run_ = (cepl_t1_.tv_sec - cepl_beg_.tv_sec) * 1e9 + (cepl_t1_.tv_nsec - cepl_beg_.tv_nsec);"
+		"\n\t\tif (cepl_s_ < 0) {"
+		"\n\t\t\tif (cepl_dt_ < %d) {"
+		"\n\t\t\t\tcepl_hdr_[0] <<= 1;"
+		"\n\t\t\t\tcepl_s_ = -%d - 1;"
+		"\n\t\t\t} else if (cepl_run_ > %lld / 4) {"
+		"\n\t\t\t\tcepl_s_ = -1;"
+		"\n\t\t\t}"
+		"\n\t\t\tcontinue;"
+		"\n\t\t}"
+		"\n\t\tcepl_ns_[cepl_hdr_[1]++] = cepl_dt_ / cepl_hdr_[0];"
+		"\n\t\tif (cepl_run_ > %lld && cepl_hdr_[1] >= %d)"
+		"\n\t\t\tbreak;"
+		"\n\t}"
+		"\n\tif (write(%d, cepl_hdr_, sizeof cepl_hdr_) != sizeof cepl_hdr_"
+		"\n\t\t\t|| write(%d, cepl_ns_, cepl_hdr_[1] * sizeof *cepl_ns_) == -1)"
+		"\n\t\tperror(\"write()\");"
+		"\n\t}";
+
+	/*
+	 * batches double while warming up until one outlasts TIMEIT_BATCH_NS,
+	 * restarting the warmup each time; a statement slow enough to spend a
+	 * quarter of the budget warming up starts sampling straight away
+	 */
+	append_fmt(src, head, TIMEIT_SAMPLES, TIMEIT_WARMUP, TIMEIT_SAMPLES);
+	for (size_t i = 0; opaque && opaque[i]; i++)
+		append_fmt(src, opaque_fmt, opaque[i]);
+	if (expr) {
+		/* drop the trailing `;` a statement would have */
+		int len = strlen(stmt);
+		while (len > 0 && strchr(" \t\n;", stmt[len - 1]))
+			len--;
+		append_fmt(src, expr_fmt, len, stmt, len, stmt);
+	} else {
+		append_fmt(src, stmt_fmt, stmt);
+	}
+	append_fmt(src, tail, TIMEIT_BATCH_NS, TIMEIT_WARMUP, TIMEIT_BUDGET_NS, TIMEIT_BUDGET_NS, TIMEIT_MIN_SAMPLES, fd, fd);
+}
+
+static inline int cmp_double(void const *a, void const *b)
+{
+	double x = *(double const *)a, y = *(double const *)b;
+	return (x > y) - (x < y);
+}
+
+/* summarize `cnt` ns per iteration samples, sorting them in place */
+static inline void timeit_stats(struct timeit_stats *restrict stats, double *restrict ns, size_t cnt)
+{
+	double sum = 0, dev = 0;
+
+	*stats = (struct timeit_stats){.cnt = cnt};
+	if (!cnt)
+		return;
+	qsort(ns, cnt, sizeof *ns, cmp_double);
+	for (size_t i = 0; i < cnt; i++)
+		sum += ns[i];
+	stats->mean = sum / cnt;
+	for (size_t i = 0; i < cnt; i++)
+		dev += (ns[i] - stats->mean) * (ns[i] - stats->mean);
+	stats->stddev = (cnt > 1) ? sqrt(dev / (cnt - 1)) : 0;
+	stats->min = ns[0];
+	stats->median = (cnt & 1) ? ns[cnt / 2] : (ns[cnt / 2 - 1] + ns[cnt / 2]) / 2;
+	/* nearest rank */
+	stats->p99 = ns[(cnt * 99 + 99) / 100 - 1];
+}
+
+/* read the samples a timing block wrote to `fd`, returning -1 if there are none */
+static inline int read_timeit(int fd, struct timeit_stats *restrict stats)
+{
+	struct timeit_hdr hdr;
+	double ns[TIMEIT_SAMPLES];
+
+	if (pread(fd, &hdr, sizeof hdr, 0) != sizeof hdr || !hdr.cnt || hdr.cnt > TIMEIT_SAMPLES)
+		return -1;
+	if (pread(fd, ns, hdr.cnt * sizeof *ns, sizeof hdr) != (ssize_t)(hdr.cnt * sizeof *ns))
+		return -1;
+	timeit_stats(stats, ns, hdr.cnt);
+	stats->iters = hdr.iters;
+	return 0;
+}
+
+/* print `ns` in the largest unit it is at least one of */
+static inline void print_ns(FILE *restrict out, double ns)
+{
+	static char const *const units[] = {"ns", "us", "ms", "s"};
+	size_t unit = 0;
+
+	for (; unit + 1 < ARR_LEN(units) && ns >= 1000; unit++)
+		ns /= 1000;
+	fprintf(out, "%.2f %s", ns, units[unit]);
+}
+
+static inline void print_timeit(FILE *restrict out, char const *restrict stmt, struct timeit_stats const *restrict stats)
+{
+	fprintf(out, "%s: ", stmt);
+	print_ns(out, stats->mean);
+	fputs("/op +/- ", out);
+	print_ns(out, stats->stddev);
+	fputs(" (min ", out);
+	print_ns(out, stats->min);
+	fputs(", median ", out);
+	print_ns(out, stats->median);
+	fputs(", p99 ", out);
+	print_ns(out, stats->p99);
+	fprintf(out, ") [%" PRIu64 " x %" PRIu64 " iterations]\n", stats->cnt, stats->iters);
+}
+
+#endif /* !defined(TIMEIT_H) */
@@ -11,18 +11,7 @@
 
 #include "vars.h"
 
-/* fallback linker arg array */
-static char *const ld_alt_list[] = {
-	"gcc",
-	"-O0", "-pipe", "-fPIC",
-	"-xassembler", "-",
-	"-lm", "-o", "/dev/stdout",
-	NULL
-};
-
 extern char const *prologue, *prog_start, *prog_start_user, *prog_end;
-/* global linker arguments struct */
-extern struct str_list ld_list;
 extern char **environ;
 
 /* silence linter */
@@ -31,624 +20,1052 @@ int fexecve(int __fd, char *const __argv[], char *const __envp[]);
 void *mmap(void *__addr, size_t __len, int __prot, int __flags, int __fd, off_t __offset);
 void sync(void);
 
-enum var_type extract_type(char const *restrict ln, char const *restrict id)
-{
-	regex_t reg;
-	regmatch_t matches[7];
-	/* return early if passed NULL pointers */
-	if (!ln || !id)
-		ERRX("%s", "NULL pointer passed to extract_type()");
+/* declaration parser state */
+struct decl_parser {
+	char const *str;
+	size_t len, pos;
+	struct token tok;
+	/* typedef names seen so far and the newest entry for each (may be NULL) */
+	struct var_list *typedefs;
+	struct id_map *typedef_map;
+	/* history line new typedefs belong to */
+	size_t line;
+};
 
-	/* strip parentheses */
-	for (char *lparens = strchr(id, '('); lparens; (lparens = strchr(id, '(')))
-		*lparens = '.';
-	for (char *rparens = strchr(id, ')'); rparens; (rparens = strchr(id, ')')))
-		*rparens = '.';
-
-	/* first/third/fourth captures are ignored */
-	char *regex, *type_str;
-	char const beg_regex[] =
-			"(^[[:blank:]]*|[^,;]*[(){};[:blank:]]*)"
-			"(struct[^=]+|struct|union[^=]+|union"
-			"|_?[Bb]ool|[rs]?size_t|u?int[0-9]+_t"
-			"|ptrdiff_t|intptr_t|intmax_t|uintmax_t"
-			"|char|char[0-9]+_t|float|float_t|double"
-			"|wchar_t|int|long|short|unsigned|void)"
-			"[[:blank:]]+([^;]*,[^&,;=]*|[^&;]*)(";
-	char const end_regex[] = ")(\\[*)";
-	size_t regex_sz[2] = {
-		strlen(id) + sizeof beg_regex + sizeof end_regex - 1,
-		0,
-	};
+/* summary of a declaration's specifiers */
+struct decl_spec {
+	bool is_typedef, seen;
+	bool is_void, is_char, is_float, is_bool;
+	bool is_signed, is_unsigned, is_aggr, is_complex;
+	/* short/int/long/enum keyword count */
+	unsigned ints;
+	/* type named by a typedef (T_ERR if none) */
+	enum var_type name_type;
+};
 
-	/* append identifier to regex */
-	xcalloc(char, &regex, 1, regex_sz[0], "extract_type()");
-	strmv(0, regex, beg_regex);
-	strmv(CONCAT, regex, id);
-	strmv(CONCAT, regex, end_regex);
+/* outermost derivation applied to a declared name */
+enum decl_kind {
+	D_BASE, D_PTR, D_ARRAY, D_FUNC,
+};
 
-	if (regcomp(&reg, regex, REG_EXTENDED|REG_NEWLINE))
-		ERR("%s", "failed to compile regex");
+/* summary of a single declarator */
+struct decl_info {
+	struct token name;
+	enum decl_kind kind;
+	/* total pointer and array levels */
+	unsigned depth;
+};
 
-	/* non-zero return or -1 value in rm_so means no captures */
-	if (regexec(&reg, ln, 6, matches, 0) || matches[2].rm_so == -1) {
-		free(regex);
-		regfree(&reg);
-		return T_ERR;
-	}
+/* qualifiers and storage classes that don't affect the tracked type */
+static char const *const ignored_words[] = {
+	"const", "volatile", "restrict", "static", "extern", "auto", "register",
+	"inline", "_Noreturn", "noreturn", "_Thread_local", "thread_local",
+	"__restrict", "__restrict__", "__inline", "__inline__", "__extension__",
+	"__const", "__volatile__", "__thread",
+	NULL
+};
 
-	/* regex capture offsets */
-	size_t match_sz[2] = {
-		/* from beginning of second capture to end of third capture */
-		matches[3].rm_eo - matches[2].rm_so,
-		/* from beginning of fifth capture to end of fifth capture */
-		matches[5].rm_eo - matches[5].rm_so,
-	};
-	/* sum length of relevant capture lengths */
-	regex_sz[1] = matches[3].rm_eo - matches[2].rm_so + matches[5].rm_eo - matches[5].rm_so + 1;
-
-	/* allocate space for second regex */
-	xcalloc(char, &type_str, 1, regex_sz[1], "extract_type()");
-	/* copy matched string */
-	memcpy(type_str, ln + matches[2].rm_so, match_sz[0]);
-	memcpy(type_str + match_sz[0], ln + matches[5].rm_so, match_sz[1]);
-	regfree(&reg);
-
-	/* string `char[]` */
-	if (regcomp(&reg, "char[[:blank:]]*[^*\\*]+\\[", REG_EXTENDED|REG_NOSUB))
-		ERR("%s", "failed to compile regex");
-	if (!regexec(&reg, type_str, 1, 0, 0)) {
-		free(regex);
-		free(type_str);
-		regfree(&reg);
-		return T_STR;
-	}
-	regfree(&reg);
-
-	/* string */
-	if (regcomp(&reg, "char[[:blank:]]*(|const)[[:blank:]]*\\*$", REG_EXTENDED|REG_NOSUB))
-		ERR("%s", "failed to compile regex");
-	if (!regexec(&reg, type_str, 1, 0, 0)) {
-		free(regex);
-		free(type_str);
-		regfree(&reg);
-		return T_STR;
+/* keywords followed by a parenthesized argument that is skipped */
+static char const *const paren_words[] = {
+	"_Alignas", "alignas", "__attribute__", "__attribute",
+	"asm", "__asm__", "__asm",
+	NULL
+};
+
+/* keywords that can only start a non-declaration statement */
+static char const *const stmt_words[] = {
+	"return", "if", "else", "for", "while", "do", "switch", "case", "default",
+	"goto", "break", "continue", "sizeof", "_Generic", "_Alignof", "alignof",
+	"_Static_assert", "static_assert",
+	NULL
+};
+
+/* library typedefs that aren't spelled `*_t` */
+static char const *const lib_types[] = {
+	"FILE", "DIR", "va_list", "jmp_buf", "sigjmp_buf",
+	NULL
+};
+static char const *const vec_types[] = {
+	"__m64", "__m128", "__m128i", "__m128d", "__m128h",
+	"__m256", "__m256i", "__m256d", "__m256h",
+	"__m512", "__m512i", "__m512d", "__m512h",
+	NULL
+};
+
+static inline bool word_in(char const *restrict str, struct token tok, char const *const *restrict words)
+{
+	for (size_t i = 0; words[i]; i++) {
+		if (lex_is_word(str, tok, words[i]))
+			return true;
 	}
-	regfree(&reg);
-
-	/* struct/union */
-	if (regcomp(&reg, "(struct|union)[^\\*\\[]+", REG_EXTENDED|REG_NOSUB))
-		ERR("%s", "failed to compile regex");
-	if (!regexec(&reg, type_str, 1, 0, 0)) {
-		free(regex);
-		free(type_str);
-		regfree(&reg);
-		return T_OTHER;
+	return false;
+}
+
+static inline void advance(struct decl_parser *restrict p)
+{
+	p->tok = lex_next(p->str, p->len, &p->pos);
+}
+
+static inline struct token peek(struct decl_parser const *restrict p)
+{
+	size_t pos = p->pos;
+	return lex_next(p->str, p->len, &pos);
+}
+
+static inline bool is_open(struct decl_parser const *restrict p)
+{
+	return lex_is(p->str, p->tok, "(") || lex_is(p->str, p->tok, "[") || lex_is(p->str, p->tok, "{");
+}
+
+static inline bool is_close(struct decl_parser const *restrict p)
+{
+	return lex_is(p->str, p->tok, ")") || lex_is(p->str, p->tok, "]") || lex_is(p->str, p->tok, "}");
+}
+
+/* skip from an opening bracket to just past its match */
+static inline void skip_balanced(struct decl_parser *restrict p)
+{
+	size_t depth = 0;
+	do {
+		if (is_open(p))
+			depth++;
+		else if (is_close(p))
+			depth--;
+		advance(p);
+	} while (depth && p->tok.type != TOK_END);
+}
+
+/* skip an initializer up to the next top-level `,` or `;` */
+static inline void skip_init(struct decl_parser *restrict p)
+{
+	while (p->tok.type != TOK_END && !is_close(p)) {
+		if (lex_is(p->str, p->tok, ",") || lex_is(p->str, p->tok, ";"))
+			return;
+		if (is_open(p))
+			skip_balanced(p);
+		else
+			advance(p);
 	}
-	regfree(&reg);
-
-	/* pointer */
-	if (regcomp(&reg, "(\\*|\\[)", REG_EXTENDED|REG_NOSUB))
-		ERR("%s", "failed to compile regex");
-	if (!regexec(&reg, type_str, 1, 0, 0)) {
-		free(regex);
-		free(type_str);
-		regfree(&reg);
-		return T_PTR;
+}
+
+/* skip the remainder of a statement (blocks end statements too) */
+static inline void skip_stmt(struct decl_parser *restrict p)
+{
+	while (p->tok.type != TOK_END) {
+		if (lex_is(p->str, p->tok, ";")) {
+			advance(p);
+			return;
+		}
+		if (lex_is(p->str, p->tok, "{")) {
+			skip_balanced(p);
+			return;
+		}
+		if (is_open(p))
+			skip_balanced(p);
+		else
+			advance(p);
 	}
-	regfree(&reg);
-
-	/* char */
-	if (regcomp(&reg, "^char([[:blank:]]+|)$", REG_EXTENDED|REG_NOSUB))
-		ERR("%s", "failed to compile regex");
-	if (!regexec(&reg, type_str, 1, 0, 0)) {
-		free(regex);
-		free(type_str);
-		regfree(&reg);
-		return T_CHR;
+}
+
+/* skip any `__attribute__((...))` style suffixes */
+static inline void skip_attrs(struct decl_parser *restrict p)
+{
+	while (word_in(p->str, p->tok, paren_words)) {
+		advance(p);
+		if (lex_is(p->str, p->tok, "("))
+			skip_balanced(p);
 	}
-	regfree(&reg);
-
-	/* double */
-	if (regcomp(&reg, "(float|float_t|double)", REG_EXTENDED|REG_NOSUB))
-		ERR("%s", "failed to compile regex");
-	if (!regexec(&reg, type_str, 1, 0, 0)) {
-		free(regex);
-		free(type_str);
-		regfree(&reg);
+}
+
+/* classify a `*_t` or library typedef name the way the old regex scanner did */
+static inline enum var_type name_type(char const *restrict str, struct token tok)
+{
+	char const *name = str + tok.off;
+	size_t len = tok.len;
+	if (lex_is_word(str, tok, "float_t") || lex_is_word(str, tok, "double_t"))
 		return T_FLT;
+	if (len < 2 || memcmp(name + len - 2, "_t", 2))
+		return T_OTHER;
+	static char const *const uint_pre[] = {"uint", "char", "wchar", "size", "rsize", NULL};
+	for (size_t i = 0; uint_pre[i]; i++) {
+		if (!strncmp(name, uint_pre[i], strlen(uint_pre[i])))
+			return T_UINT;
 	}
-	regfree(&reg);
-
-	/* unsigned integral */
-	if (regcomp(&reg, "^(_?[Bb]ool|unsigned|char[0-9]+|wchar|uint|r?size)", REG_EXTENDED|REG_NOSUB))
-		ERR("%s", "failed to compile regex");
-	if (!regexec(&reg, type_str, 1, 0, 0)) {
-		free(regex);
-		free(type_str);
-		regfree(&reg);
-		return T_UINT;
-	}
-	regfree(&reg);
-
-	/* signed integral */
-	if (regcomp(&reg, "(short|int|long|ptrdiff|ssize)", REG_EXTENDED|REG_NOSUB))
-		ERR("%s", "failed to compile regex");
-	if (!regexec(&reg, type_str, 1, 0, 0)) {
-		free(regex);
-		free(type_str);
-		regfree(&reg);
-		return T_INT;
+	static char const *const int_sub[] = {"int", "ptrdiff", "ssize", "long", "short", NULL};
+	for (size_t i = 0; int_sub[i]; i++) {
+		size_t sub = strlen(int_sub[i]);
+		for (size_t j = 0; j + sub <= len; j++) {
+			if (!memcmp(name + j, int_sub[i], sub))
+				return T_INT;
+		}
 	}
-	regfree(&reg);
-
-	/* return fallback type */
-	free(regex);
-	free(type_str);
 	return T_OTHER;
 }
 
-size_t extract_id(char const *restrict ln, char **restrict id, size_t *restrict off)
+/* return the tracked type of a typedef name or T_ERR if `tok` isn't one */
+static inline enum var_type find_typedef(struct decl_parser const *restrict p, struct token tok)
 {
-	regex_t reg;
-	regmatch_t matches[5];
-	/* second capture is ignored */
-	char const initial_regex[] =
-		"^[^,(){};&|=]+[^,({;&|=[:alnum:]_]+"
-		"([[:alpha:]_][[:alnum:]_]*)[[:blank:]]*"
-		"(=[^,(){;'\"_=!<>[:alnum:]]+"
-		"|<>{2}=[^,({;'\"_=!<>[:alnum:]]*|[^=,;]+=)";
+	if (p->typedefs) {
+		ptrdiff_t idx = find_id(p->typedef_map, find_len(&str_pool, p->str + tok.off, tok.len));
+		if (idx != -1)
+			return p->typedefs->list[idx].type_spec;
+	}
+	if (word_in(p->str, tok, lib_types))
+		return T_OTHER;
+	if (word_in(p->str, tok, vec_types))
+		return T_VEC;
+	if (tok.len > 2 && !memcmp(p->str + tok.off + tok.len - 2, "_t", 2))
+		return name_type(p->str, tok);
+	return T_ERR;
+}
 
-	/* return early if passed NULL pointers */
-	if (!ln || !id || !off)
-		ERRX("%s", "NULL pointer passed to extract_id()");
+/* parse declaration specifiers, returning false if this isn't a declaration */
+static bool parse_specs(struct decl_parser *restrict p, struct decl_spec *restrict spec)
+{
+	*spec = (struct decl_spec){.name_type = T_ERR};
 
-#ifdef _DEBUG
-	if (strlen(ln))
-		DPRINTF("extract_id(): \"%s\"\n", ln);
-#endif
+	while (p->tok.type == TOK_ID) {
+		struct token tok = p->tok;
+		char const *str = p->str;
+		enum var_type type;
 
-	if (regcomp(&reg, initial_regex, REG_EXTENDED|REG_NEWLINE))
-		ERR("%s", "failed to compile regex");
-	/* non-zero return or -1 value in rm_so means no captures */
-	if (regexec(&reg, ln, 3, matches, 0) || matches[1].rm_so == -1) {
-		/* fallback branch */
-		regfree(&reg);
-		/* first/second/fourth capture is ignored */
-		char const middle_regex[] =
-			"(^|^[^;,]*;+[[:blank:]]*|^[^=,(){};&|'\"]+)"
-			"(struct[^=]+|struct|union[^=]+|union"
-			"|_?[Bb]ool|[rs]?size_t|u?int[0-9]+_t"
-			"|ptrdiff_t|intptr_t|intmax_t|uintmax_t"
-			"|char|char[0-9]+_t|float|float_t|double"
-			"|wchar_t|int|long|short|unsigned|void)"
-			"[^=,(){};&|'\"[:alpha:]]+[[:blank:]]*\\**[[:blank:]]*"
-			"([[:alpha:]_][[:alnum:]_]*)[[:blank:]]*"
-			"([^=,(){};&|'\"[:alnum:][:blank:]]+$|[^;]*,|$|\\[|,)";
-
-		if (regcomp(&reg, middle_regex, REG_EXTENDED|REG_NEWLINE))
-			ERR("%s", "failed to compile regex");
-		if (regexec(&reg, ln, 5, matches, 0) || matches[3].rm_so == -1) {
-			regfree(&reg);
-			/* first/second capture is ignored */
-			char const final_regex[] =
-				"(^[^,;]+\\{[^}]*\\}[^,;]*|[^,(){};|]+)"
-				"(|struct[^=]+|struct|union[^=]+|union"
-				"|_?[Bb]ool|[rs]?size_t|u?int[0-9]+_t"
-				"|ptrdiff_t|intptr_t|intmax_t|uintmax_t"
-				"|char|char[0-9]+_t|float|float_t|double"
-				"|wchar_t|int|long|short|unsigned|void)"
-				",[[:blank:]]*\\**[[:blank:]]*"
-				"([[:alpha:]_][[:alnum:]_]*)";
-
-			if (regcomp(&reg, final_regex, REG_EXTENDED|REG_NEWLINE))
-				ERR("%s", "failed to compile regex");
-			if (regexec(&reg, ln, 4, matches, 0) || matches[3].rm_so == -1) {
-				regfree(&reg);
-				return 0;
+		if (word_in(str, tok, ignored_words)) {
+			advance(p);
+			continue;
+		}
+		if (word_in(str, tok, paren_words)) {
+			skip_attrs(p);
+			continue;
+		}
+		if (word_in(str, tok, stmt_words))
+			return false;
+		if (lex_is_word(str, tok, "typedef")) {
+			spec->is_typedef = true;
+			advance(p);
+			continue;
+		}
+
+		/* `_Atomic(T)` and `typeof(x)` name types we can't see into */
+		if (lex_is_word(str, tok, "_Atomic") || lex_is_word(str, tok, "typeof")
+				|| lex_is_word(str, tok, "__typeof__") || lex_is_word(str, tok, "__typeof")) {
+			advance(p);
+			if (lex_is(str, p->tok, "(")) {
+				skip_balanced(p);
+				spec->name_type = T_OTHER;
+				spec->seen = true;
 			}
+			continue;
+		}
 
-			xcalloc(char, id, 1, matches[3].rm_eo - matches[3].rm_so + 1, "extract_id()");
-			/* set the output parameter and return the offset */
-			memcpy(*id, ln + matches[3].rm_so, matches[3].rm_eo - matches[3].rm_so);
-			regfree(&reg);
-			*off = matches[3].rm_eo;
-#ifdef _DEBUG
-			DPRINTF("regex [3]: %s\n", *id);
-#endif
-			return matches[3].rm_eo;
+		/* tagged types (skipping any body) */
+		if (lex_is_word(str, tok, "struct") || lex_is_word(str, tok, "union") || lex_is_word(str, tok, "enum")) {
+			if (lex_is_word(str, tok, "enum"))
+				spec->ints++;
+			else
+				spec->is_aggr = true;
+			spec->seen = true;
+			advance(p);
+			skip_attrs(p);
+			if (p->tok.type == TOK_ID)
+				advance(p);
+			if (lex_is(str, p->tok, "{"))
+				skip_balanced(p);
+			continue;
 		}
 
-		xcalloc(char, id, 1, matches[3].rm_eo - matches[3].rm_so + 1, "extract_id()");
-		/* set the output parameter and return the offset */
-		memcpy(*id, ln + matches[3].rm_so, matches[3].rm_eo - matches[3].rm_so);
-		regfree(&reg);
-		*off = matches[3].rm_eo;
-#ifdef _DEBUG
-		DPRINTF("regex [2]: %s\n", *id);
-#endif
-		return matches[3].rm_eo;
+		/* basic type keywords */
+		bool *flag = NULL;
+		if (lex_is_word(str, tok, "void"))
+			flag = &spec->is_void;
+		else if (lex_is_word(str, tok, "char"))
+			flag = &spec->is_char;
+		else if (lex_is_word(str, tok, "float") || lex_is_word(str, tok, "double"))
+			flag = &spec->is_float;
+		else if (lex_is_word(str, tok, "_Bool") || lex_is_word(str, tok, "bool"))
+			flag = &spec->is_bool;
+		else if (lex_is_word(str, tok, "signed") || lex_is_word(str, tok, "__signed__"))
+			flag = &spec->is_signed;
+		else if (lex_is_word(str, tok, "unsigned"))
+			flag = &spec->is_unsigned;
+		else if (lex_is_word(str, tok, "_Complex") || lex_is_word(str, tok, "complex"))
+			flag = &spec->is_complex;
+		if (flag || lex_is_word(str, tok, "short") || lex_is_word(str, tok, "int")
+				|| lex_is_word(str, tok, "long") || lex_is_word(str, tok, "__int128")) {
+			if (flag)
+				*flag = true;
+			else
+				spec->ints++;
+			spec->seen = true;
+			advance(p);
+			continue;
+		}
+
+		/* any other identifier after a type is the declarator */
+		if (spec->seen)
+			break;
+		/* typedef names are known or directly followed by another identifier */
+		if ((type = find_typedef(p, tok)) == T_ERR) {
+			if (peek(p).type != TOK_ID)
+				return false;
+			type = T_OTHER;
+		}
+		spec->name_type = type;
+		spec->seen = true;
+		advance(p);
 	}
 
-	xcalloc(char, id, 1, matches[1].rm_eo - matches[1].rm_so + 1, "extract_id()");
-	/* set the output parameter and return the offset */
-	memcpy(*id, ln + matches[1].rm_so, matches[1].rm_eo - matches[1].rm_so);
-	regfree(&reg);
-	*off = matches[1].rm_eo;
-#ifdef _DEBUG
-	DPRINTF("regex [1]: %s\n", *id);
-#endif
-	return matches[1].rm_eo;
+	return spec->seen;
 }
 
-int find_vars(struct program *restrict prog, char const *restrict code)
+/* parse one (possibly nested) declarator */
+static bool parse_declarator(struct decl_parser *restrict p, struct decl_info *restrict decl)
 {
-	size_t off;
-	char *line_tmp[2], *id_tmp = NULL;
+	struct decl_info inner = {.kind = D_BASE};
+	enum decl_kind suffix = D_BASE;
+	unsigned ptrs = 0, dims = 0;
 
-	/* sanity checks */
-	if (!prog || !code)
-		return -1;
-	xcalloc(char, &line_tmp[0], 1, strlen(code) + 1, "find_vars()");
-	line_tmp[1] = line_tmp[0];
-
-	/* initialize lists */
-	if (prog->type_list.list)
-		free(prog->type_list.list);
-	if (prog->id_list.list)
-		free_str_list(&prog->id_list);
-	init_type_list(&prog->type_list);
-	init_str_list(&prog->id_list, NULL);
-	strmv(0, line_tmp[1], code);
-
-	/* extract all identifiers from the line */
-	size_t count = prog->id_list.cnt;
-	while (line_tmp[1] && extract_id(line_tmp[1], &id_tmp, &off) != 0) {
-		append_str(&prog->id_list, id_tmp, 0);
-		free(id_tmp);
-		id_tmp = NULL;
-		line_tmp[1] += off;
-		count++;
+	/* pointers and their qualifiers */
+	for (;;) {
+		if (lex_is(p->str, p->tok, "*"))
+			ptrs++;
+		else if (!word_in(p->str, p->tok, ignored_words))
+			break;
+		advance(p);
 	}
-	if (id_tmp) {
-		free(id_tmp);
-		id_tmp = NULL;
+	skip_attrs(p);
+
+	if (lex_is(p->str, p->tok, "(")) {
+		/* nested declarator like `(*fp)` */
+		advance(p);
+		if (!parse_declarator(p, &inner) || !lex_is(p->str, p->tok, ")"))
+			return false;
+		advance(p);
+	} else if (p->tok.type == TOK_ID) {
+		inner.name = p->tok;
+		advance(p);
+	} else {
+		/* abstract declarators don't declare anything */
+		return false;
 	}
 
-	/* second pass */
-	while (line_tmp[1] && (line_tmp[1] = strpbrk(line_tmp[1], ";"))) {
-		for (line_tmp[1]++; extract_id(line_tmp[1], &id_tmp, &off); count++) {
-			append_str(&prog->id_list, id_tmp, 0);
-			free(id_tmp);
-			id_tmp = NULL;
-			line_tmp[1] += off;
-		}
-		if (id_tmp) {
-			free(id_tmp);
-			id_tmp = NULL;
+	/* array and function suffixes */
+	for (;;) {
+		if (lex_is(p->str, p->tok, "[")) {
+			if (suffix == D_BASE)
+				suffix = D_ARRAY;
+			dims++;
+		} else if (lex_is(p->str, p->tok, "(")) {
+			if (suffix == D_BASE)
+				suffix = D_FUNC;
+		} else {
+			break;
 		}
+		skip_balanced(p);
 	}
 
-	/* return early if nothing to do */
-	if (!count) {
-		free(id_tmp);
-		free(line_tmp[0]);
-		return 0;
+	/* derivations bind tightest inside the parentheses, then suffixes, then pointers */
+	decl->name = inner.name;
+	decl->depth = inner.depth + ptrs + dims;
+	if (inner.kind != D_BASE)
+		decl->kind = inner.kind;
+	else if (suffix != D_BASE)
+		decl->kind = suffix;
+	else
+		decl->kind = ptrs ? D_PTR : D_BASE;
+	return true;
+}
+
+/* map a declaration onto the types `print_vars()` understands */
+static enum var_type decl_type(struct decl_spec const *restrict spec, struct decl_info const *restrict decl)
+{
+	bool is_chr = spec->is_char && !spec->ints && spec->name_type == T_ERR;
+
+	if (decl->kind == D_PTR || decl->kind == D_ARRAY) {
+		/* one level of `char` indirection is a string */
+		if ((is_chr || spec->name_type == T_CHR) && decl->depth == 1)
+			return T_STR;
+		return T_PTR;
 	}
-	if (prog->id_list.cnt < 1)
+	if (spec->name_type != T_ERR)
+		return spec->name_type;
+	if (spec->is_aggr || spec->is_complex)
+		return T_OTHER;
+	if (spec->is_void)
+		return T_ERR;
+	if (spec->is_float)
+		return T_FLT;
+	if (spec->is_bool || spec->is_unsigned)
+		return T_UINT;
+	if (is_chr)
+		return spec->is_signed ? T_INT : T_CHR;
+	return T_INT;
+}
+
+/* parse a single declaration, returning the number of names it declares */
+static size_t parse_decl(struct decl_parser *restrict p, struct id_list *restrict ids, struct type_list *restrict types)
+{
+	struct decl_spec spec;
+	size_t cnt = 0;
+
+	if (!parse_specs(p, &spec))
 		return 0;
 
-	/* get the type of each identifier */
-	line_tmp[1] = line_tmp[0];
-	for (size_t i = 0; i < prog->id_list.cnt; i++) {
-		enum var_type type_tmp;
-		type_tmp = extract_type(line_tmp[1], prog->id_list.list[i]);
-		append_type(&prog->type_list, type_tmp);
+	/* `struct foo { ... };` declares no names */
+	while (p->tok.type != TOK_END && !lex_is(p->str, p->tok, ";")) {
+		struct decl_info decl;
+		if (!parse_declarator(p, &decl))
+			break;
+		skip_attrs(p);
+
+		size_t id = intern_len(&str_pool, p->str + decl.name.off, decl.name.len);
+		enum var_type type = decl_type(&spec, &decl);
+		cnt++;
+		if (spec.is_typedef) {
+			if (p->typedefs) {
+				/* a redefinition shadows the earlier one until its line is undone */
+				push_var_list(p->typedefs, (struct var_entry){
+					.id = id, .line = p->line,
+					.shadow = find_id(p->typedef_map, id), .type_spec = type,
+				});
+				set_id(p->typedef_map, id, p->typedefs->cnt - 1);
+			}
+		} else if (decl.kind != D_FUNC && type != T_ERR) {
+			push_id_list(ids, id);
+			push_type_list(types, type);
+		}
+
+		if (lex_is(p->str, p->tok, "=")) {
+			advance(p);
+			skip_init(p);
+		}
+		if (!lex_is(p->str, p->tok, ","))
+			break;
+		advance(p);
 	}
-	free(id_tmp);
-	free(line_tmp[0]);
 
-	return count;
+	return cnt;
 }
 
-int print_vars(struct program *restrict prog, char *const *restrict cc_args, char **exec_args)
+/* parse every declaration in `str[0..len)` */
+static size_t parse_decls(struct decl_parser *restrict p, struct id_list *restrict ids, struct type_list *restrict types)
+{
+	size_t cnt = 0;
+
+	for (advance(p); p->tok.type != TOK_END; skip_stmt(p))
+		cnt += parse_decl(p, ids, types);
+
+	return cnt;
+}
+
+enum var_type extract_type(char const *restrict ln, size_t len, char const *restrict id)
+{
+	struct id_list ids;
+	struct type_list types;
+	enum var_type type = T_ERR;
+
+	/* return early if passed NULL pointers */
+	if (!ln || !id)
+		ERRX("%s", "NULL pointer passed to extract_type()");
+
+	init_id_list(&ids);
+	init_type_list(&types);
+	parse_decls(&(struct decl_parser){.str = ln, .len = len}, &ids, &types);
+	/* the last declaration wins */
+	size_t handle = find_len(&str_pool, id, strlen(id));
+	for (size_t i = 0; handle && i < ids.cnt; i++) {
+		if (ids.list[i] == handle)
+			type = types.list[i];
+	}
+	free_id_list(&ids);
+	free_type_list(&types);
+
+	return type;
+}
+
+int find_vars(struct program *restrict prog, char const *restrict code, size_t len)
+{
+	/* sanity checks */
+	if (!prog || !code)
+		return -1;
+
+	/* reuse the previous line's storage */
+	truncate_type_list(&prog->type_list, 0);
+	truncate_id_list(&prog->id_list, 0);
+
+	struct decl_parser p = {
+		.str = code, .len = len,
+		.typedefs = &prog->typedef_list, .typedef_map = &prog->typedef_map,
+		.line = prog->src[0].flags.cnt,
+	};
+	int cnt = parse_decls(&p, &prog->id_list, &prog->type_list);
+
+	/*
+	 * remember every tracked or just declared identifier read or written,
+	 * skipping member names; anything else is looked up without being
+	 * interned so keywords, functions, and macros never reach `str_pool`
+	 */
+	struct token prev = {0};
+	for (size_t pos = 0;;) {
+		struct token tok = lex_next(code, len, &pos);
+		if (tok.type == TOK_END)
+			break;
+		if (tok.type == TOK_ID && !lex_is(code, prev, ".") && !lex_is(code, prev, "->")) {
+			size_t id = find_len(&str_pool, code + tok.off, tok.len);
+			bool tracked = id && find_id(&prog->var_map, id) != -1;
+			for (size_t i = 0; id && !tracked && i < prog->id_list.cnt; i++)
+				tracked = prog->id_list.list[i] == id;
+			if (tracked)
+				push_id_list(&prog->touch_list, id);
+		}
+		prev = tok;
+	}
+
+	return cnt;
+}
+
+/* append one value record to `stream` */
+static inline void push_rec(struct char_list *restrict stream, size_t idx, enum var_type type, void const *restrict data, uint64_t len)
+{
+	struct val_rec rec = {.idx = idx, .type = type, .len = len};
+	extend_char_list(stream, (char const *)&rec, sizeof rec);
+	if (len != VAL_NULL)
+		extend_char_list(stream, data, len);
+}
+
+int show_recs(struct program const *restrict prog, FILE *restrict out, char const *restrict buf, size_t len)
 {
-	int status, mem_fd, null_fd;
-	int pipe_cc[2], pipe_ld[2], pipe_exec[2];
-	char *src_tmp;
 	char *term = getenv("TERM");
 	bool has_color = term
 		&& isatty(STDOUT_FILENO)
 		&& isatty(STDERR_FILENO)
 		&& strcmp(term, "")
 		&& strcmp(term, "dumb");
-	char *p_beg = has_color
-		? "\n\tfprintf(stderr, \"" YELLOW "__s = \\\"____\\\", " RST "\", \""
-		: "\n\tfprintf(stderr, \"__s = \\\"____\\\", \",\"";
-	char *pln_beg = has_color
-		? "\n\tfprintf(stderr, \"" YELLOW "__s = \\\"____\\\"\\n" RST "\", \""
-		: "\n\tfprintf(stderr, \"__s = \\\"____\\\"\\n\", \"";
-	char print_beg[strlen(p_beg) + 1], println_beg[strlen(pln_beg) + 1];
-	char print_end[] = ");";
-	/* space for <name>, <name> */
-	size_t psz = sizeof print_beg + sizeof print_end + 16;
-	size_t plnsz = sizeof println_beg + sizeof print_end + 16;
-
-	/* inititalize arrays */
-	strmv(0, print_beg, p_beg);
-	strmv(0, println_beg, pln_beg);
-	/* sanity checks */
-	if (strlen(prog->src[1].total.buf) < 2)
-		ERRX("%s", "empty source string passed to print_prog->var_list()");
-	/* return early if nothing to do */
-	if (!prog->src[1].total.buf || !cc_args || !exec_args || prog->var_list.cnt == 0)
-		return -1;
-	/* bit bucket */
-	if ((null_fd = open("/dev/null", O_WRONLY, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH)) == -1)
-		ERR("%s", "`null_fd` open()");
-	/* copy source buffer */
-	xcalloc(char, &src_tmp, 1, strlen(prog->src[1].total.buf) + 1, "src_tmp realloc()");
-	strmv(0, src_tmp, prog->src[1].total.buf);
-	size_t off = strlen(prog->src[1].total.buf);
-
-	/* build variable tracking source instance */
-	for (size_t i = 0; i < prog->var_list.cnt; i++) {
-		/* skip erroneous types */
-		enum var_type cur_type = prog->var_list.list[i].type_spec;
-		if (cur_type == T_ERR)
-			continue;
+	int cnt = 0;
 
-		/* populate buffers */
-		size_t printf_sz = (i < prog->var_list.cnt - 1) ? psz : plnsz;
-		size_t arr_sz = (i < prog->var_list.cnt - 1) ? sizeof print_beg : sizeof println_beg;
-		size_t cur_sz = strlen(prog->var_list.list[i].id) * 2;
-		char print_tmp[arr_sz];
+	for (size_t off = 0; off < len; cnt++) {
+		struct val_rec rec;
+		if (len - off < sizeof rec)
+			return -1;
+		memcpy(&rec, buf + off, sizeof rec);
+		off += sizeof rec;
+		size_t data_len = (rec.len == VAL_NULL) ? 0 : rec.len;
+		if (rec.idx >= prog->var_list.cnt || data_len > len - off)
+			return -1;
+		char const *data = buf + off;
+		off += data_len;
 
-		/* add newline on last iteration */
-		if (i < prog->var_list.cnt - 1)
-			strmv(0, print_tmp, print_beg);
-		else
-			strmv(0, print_tmp, println_beg);
-		xrealloc(char, &src_tmp, strlen(src_tmp) + cur_sz + printf_sz, "src_tmp realloc()");
-
-		/* build format string */
-		switch (cur_type) {
-		case T_ERR:
-			/* should never hit this branch */
-			ERR("%s", prog->var_list.list[i].id);
-			break;
+		/* values printed as addresses are labeled as such */
+		struct var_entry const *entry = &prog->var_list.list[rec.idx];
+		char const *pre = (rec.type == T_PTR) ? "*" : (rec.type == T_OTHER) ? "&" : "";
+		union { long long i; unsigned long long u; long double f; uintptr_t p; } val = {0};
+		memcpy(&val, data, MIN(data_len, sizeof val));
+		fprintf(out, "%s%s%s = \"", has_color ? "\033[33m" : "", pre, pool_str(&str_pool, entry->id));
+		switch (rec.type) {
 		case T_CHR:
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '-';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = 'c';
-			break;
-		case T_STR:
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '-';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = 's';
+			fprintf(out, "%c", (char)val.i);
 			break;
 		case T_INT:
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = 'l';
-			strchrnul(print_tmp, '_')[0] = 'l';
-			strchrnul(print_tmp, '_')[0] = 'd';
+			fprintf(out, "%lld", val.i);
 			break;
 		case T_UINT:
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = 'l';
-			strchrnul(print_tmp, '_')[0] = 'l';
-			strchrnul(print_tmp, '_')[0] = 'u';
+			fprintf(out, "%llu", val.u);
 			break;
 		case T_FLT:
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = 'L';
-			strchrnul(print_tmp, '_')[0] = 'f';
+			fprintf(out, "%Lf", val.f);
 			break;
-		case T_PTR:
-			strchrnul(print_tmp, '_')[0] = '*';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '-';
-			strchrnul(print_tmp, '_')[0] = '-';
-			strchrnul(print_tmp, '_')[0] = 'p';
+		case REC_TEXT:
+			fwrite(data, 1, data_len, out);
+			break;
+		case T_VEC:
+			/* lane kind and size precede the raw lanes */
+			if (data_len < 2) {
+				fputs("?", out);
+				break;
+			}
+			if (prog->dump_opts.lane_kind
+					&& dump_lanes(out, prog->dump_opts.lane_kind, prog->dump_opts.lane_size, data + 2, data_len - 2))
+				break;
+			if (!dump_lanes(out, data[0], (unsigned char)data[1], data + 2, data_len - 2))
+				dump_lanes(out, 'x', 1, data + 2, data_len - 2);
 			break;
+		case T_STR:
+			if (rec.len == VAL_NULL)
+				fputs("(null)", out);
+			else
+				fprintf(out, "%.*s", (int)data_len, data);
+			break;
+		case T_PTR: /* fallthrough */
 		case T_OTHER: /* fallthrough */
 		default:
-			strchrnul(print_tmp, '_')[0] = '&';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '%';
-			strchrnul(print_tmp, '_')[0] = '-';
-			strchrnul(print_tmp, '_')[0] = '1';
-			strchrnul(print_tmp, '_')[0] = 'p';
+			fprintf(out, "%p", (void *)val.p);
 		}
+		fprintf(out, "\"%s%s", (off < len) ? ", " : "\n", has_color ? "\033[00m" : "");
+	}
+
+	return cnt;
+}
+
+/*
+ * append printers for the shown variables to `src`, which must hold the
+ * session up to the end of its body, returning the fd they write their
+ * records to (inherited by the run) or -1 if there is nothing to show
+ */
+int print_vars(struct program *restrict prog, struct char_list *restrict src)
+{
+	int rec_fd;
+	/* printers write `struct val_rec` headers followed by the raw value */
+	char const prelude[] =
+		"\n\t{"
+		"\n#define CEPL_REC(IDX, TYPE, PTR, LEN) do { "
+			"struct { uint32_t idx, type; uint64_t len; } cepl_rec_ = {(IDX), (TYPE), (LEN)}; "
+			"fwrite(&cepl_rec_, sizeof cepl_rec_, 1, cepl_out_); "
+			"if (cepl_rec_.len != UINT64_MAX) fwrite((PTR), 1, cepl_rec_.len, cepl_out_); "
+		"} while (0)"
+		"\n#define CEPL_VAL(IDX, TYPE, CTYPE, VAL) do { "
+			"CTYPE cepl_val_ = (VAL); CEPL_REC(IDX, TYPE, &cepl_val_, sizeof cepl_val_); "
+		"} while (0)"
+		"\n#define CEPL_VEC(IDX, TYPE, VAR) do { "
+			"unsigned char cepl_vec_[2 + sizeof (VAR)] = {_Generic((VAR)[0], float: 'f', double: 'f', "
+			"unsigned char: 'u', unsigned short: 'u', unsigned: 'u', unsigned long: 'u', unsigned long long: 'u', "
+			"default: 'i'), sizeof (VAR)[0]}; "
+			"memcpy(cepl_vec_ + 2, &(VAR), sizeof (VAR)); CEPL_REC(IDX, TYPE, cepl_vec_, sizeof cepl_vec_); "
+		"} while (0)"
+		"\n#define CEPL_STR(IDX, TYPE, VAL) do { "
+			"char const *cepl_str_ = (VAL); CEPL_REC(IDX, TYPE, cepl_str_, cepl_str_ ? strlen(cepl_str_) : UINT64_MAX); "
+		"} while (0)"
+		"\n\tFILE *cepl_out_ = fdopen(%d, \"w\");"
+		"\n\tif (cepl_out_) {";
+	char const postlude[] =
+		"\n\tfclose(cepl_out_);"
+		"\n\t}"
+		"\n#undef CEPL_REC"
+		"\n#undef CEPL_VAL"
+		"\n#undef CEPL_VEC"
+		"\n#undef CEPL_STR"
+		"\n\t}";
 
-		/* copy format string */
-		strmv(off, src_tmp, print_tmp);
-		off += arr_sz - 1;
-		strmv(off, src_tmp, prog->var_list.list[i].id);
-		off += strlen(prog->var_list.list[i].id);
+	/* return early if nothing to do */
+	if (!prog || !src || prog->var_list.cnt == 0)
+		return -1;
+	/* skip the printers entirely if the line touched nothing tracked */
+	bool shown[prog->var_list.cnt];
+	if (!mark_shown(prog, shown))
+		return -1;
+	/* record channel inherited by the executable */
+	if ((rec_fd = syscall(SYS_memfd_create, "cepl_vals", 0)) == -1)
+		ERR("%s", "error creating rec_fd");
+
+	append_fmt(src, prelude, rec_fd);
+	for (size_t i = 0; i < prog->var_list.cnt; i++) {
+		/* skip untouched, erroneous, and shadowed entries */
+		if (!shown[i])
+			continue;
+		enum var_type cur_type = prog->var_list.list[i].type_spec;
+		char const *cur_id = pool_str(&str_pool, prog->var_list.list[i].id);
 
-		/* handle other variable types */
-		char const *tmp_buf;
 		switch (cur_type) {
-		case T_ERR:
-			/* should never hit this branch */
-			ERR("%s", prog->var_list.list[i].id);
-			break;
+		case T_CHR: /* fallthrough */
 		case T_INT:
-			/* cast integral type to long long */
-			tmp_buf = "\", (long long)";
-			strmv(off, src_tmp, tmp_buf);
-			off += strlen(tmp_buf);
+			append_fmt(src, "\n\tCEPL_VAL(%zu, %d, long long, (long long)(%s));", i, cur_type, cur_id);
+			break;
+		case T_UINT:
+			append_fmt(src, "\n\tCEPL_VAL(%zu, %d, unsigned long long, (unsigned long long)(%s));", i, cur_type, cur_id);
 			break;
 		case T_FLT:
-			/* cast floating type to long double */
-			tmp_buf = "\", (long double)";
-			strmv(off, src_tmp, tmp_buf);
-			off += strlen(tmp_buf);
+			append_fmt(src, "\n\tCEPL_VAL(%zu, %d, long double, (long double)(%s));", i, cur_type, cur_id);
 			break;
-		case T_OTHER:
-			/* take the address of variable if type unknown */
-			tmp_buf = "\", &";
-			strmv(off, src_tmp, tmp_buf);
-			off += strlen(tmp_buf);
+		case T_STR:
+			append_fmt(src, "\n\tCEPL_STR(%zu, %d, %s);", i, cur_type, cur_id);
 			break;
-		case T_CHR: /* fallthrough */
-		case T_STR: /* fallthrough */
-		case T_UINT: /* fallthrough */
-		case T_PTR: /* fallthrough */
+		case T_PTR:
+			append_fmt(src, "\n\tCEPL_VAL(%zu, %d, uintptr_t, (uintptr_t)(%s));", i, cur_type, cur_id);
+			break;
+		case T_VEC:
+			append_fmt(src, "\n\tCEPL_VEC(%zu, %d, %s);", i, cur_type, cur_id);
+			break;
+		case T_OTHER: /* fallthrough */
 		default:
-			tmp_buf = "\", ";
-			strmv(off, src_tmp, tmp_buf);
-			off += strlen(tmp_buf);
+			/* take the address of variable if type unknown */
+			append_fmt(src, "\n\tCEPL_VAL(%zu, %d, uintptr_t, (uintptr_t)&(%s));", i, cur_type, cur_id);
 		}
+	}
+	append_fmt(src, "%s", postlude);
 
-		/* copy final part of printf */
-		strmv(off, src_tmp, prog->var_list.list[i].id);
-		off += strlen(prog->var_list.list[i].id);
-		strmv(off, src_tmp, print_end);
-		off += sizeof print_end - 1;
+	return rec_fd;
+}
+
+void show_vars(struct program const *restrict prog, int rec_fd)
+{
+	struct stat st;
+
+	/* decode whatever records were written before the program finished */
+	if (fstat(rec_fd, &st) == 0 && st.st_size > 0) {
+		char *recs = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, rec_fd, 0);
+		if (recs != MAP_FAILED) {
+			show_recs(prog, stderr, recs, st.st_size);
+			munmap(recs, st.st_size);
+		}
 	}
+	close(rec_fd);
+}
 
-	/* copy final source into buffer */
-	char final[off + strlen(prog_end) + 1], *tok_buf;
-	memset(final, 0, sizeof final);
-	strmv(0, final, src_tmp);
-	strmv(off, final, prog_end);
-	/* remove NULL bytes */
-	while ((tok_buf = memchr(final, 0, sizeof final)))
-		tok_buf[0] = '\n';
-	free(src_tmp);
-
-	/* create pipes */
-	if (pipe2(pipe_cc, O_CLOEXEC) == -1)
-		ERR("%s", "error making pipe_cc pipe");
-	if (pipe2(pipe_ld, O_CLOEXEC) == -1)
-		ERR("%s", "error making pipe_ld pipe");
-	if (pipe2(pipe_exec, O_CLOEXEC) == -1)
-		ERR("%s", "error making pipe_exec pipe");
-
-	/* fork compiler */
-	switch (fork()) {
-	/* error */
-	case -1:
-		close(pipe_cc[0]);
-		close(pipe_cc[1]);
-		close(pipe_ld[0]);
-		close(pipe_ld[1]);
-		close(pipe_exec[0]);
-		close(pipe_exec[1]);
-		ERR("%s", "error forking compiler");
-		break;
 
-	/* child */
-	case 0:
-		dup2(null_fd, STDERR_FILENO);
-		dup2(pipe_ld[1], STDOUT_FILENO);
-		dup2(pipe_cc[0], STDIN_FILENO);
-		execvp(cc_args[0], cc_args);
-		/* execvp() should never return */
-		ERR("%s", "error forking compiler");
-		break;
+/* longest string read out of a traced program */
+#define TRACE_STR_MAX	PAGE_SIZE
+/* widest vector read out of a traced program */
+#define TRACE_VEC_MAX	0x100
 
-	/* parent */
-	default:
-		close(pipe_cc[0]);
-		close(pipe_ld[1]);
-		if (write(pipe_cc[1], final, sizeof final) == -1)
-			ERR("%s", "error writing to pipe_cc[1]");
-		close(pipe_cc[1]);
-		wait(&status);
-		/* convert 255 to -1 since WEXITSTATUS() only returns the low-order 8 bits */
-		if (WIFEXITED(status) && WEXITSTATUS(status)) {
-			/* WARNX("compiler returned non-zero exit code"); */
-			return (WEXITSTATUS(status) != 0xff) ? WEXITSTATUS(status) : -1;
+/* struct definition for a value to read out of a traced program */
+struct trace_val {
+	size_t entry;
+	ptrdiff_t type;
+	uint64_t addr;
+	/* bytes copied into the value buffer */
+	size_t off, len;
+};
+
+VEC_DEFINE(trace_list, struct trace_val, 16, NO_DTOR)
+
+/* copy `len` bytes at `addr` out of `pid`, returning the number copied */
+static inline size_t read_mem(pid_t pid, void *restrict buf, uint64_t addr, size_t len)
+{
+	struct iovec local = {buf, len}, remote = {(void *)(uintptr_t)addr, len};
+	ssize_t ret = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+	return (ret > 0) ? (size_t)ret : 0;
+}
+
+/* struct definition for an object still in the traced program */
+struct trace_obj {
+	pid_t pid;
+	uint64_t addr;
+};
+
+static size_t read_obj(void *ctx, void *buf, uint64_t off, size_t len)
+{
+	struct trace_obj const *obj = ctx;
+	return read_mem(obj->pid, buf, obj->addr + off, len);
+}
+
+/* copy every value with as few `process_vm_readv()` calls as possible */
+static void read_vals(pid_t pid, struct trace_list *restrict vals, char *restrict buf)
+{
+	struct iovec local[IOV_MAX], remote[IOV_MAX];
+
+	for (size_t beg = 0; beg < vals->cnt;) {
+		size_t cnt = 0, want = 0, end = beg;
+		for (; end < vals->cnt && cnt < IOV_MAX; end++) {
+			struct trace_val const *val = &vals->list[end];
+			if (!val->len)
+				continue;
+			local[cnt] = (struct iovec){buf + val->off, val->len};
+			remote[cnt++] = (struct iovec){(void *)(uintptr_t)val->addr, val->len};
+			want += val->len;
+		}
+		/* the batch stops at the first unreadable value so retry it piecewise */
+		if (cnt && process_vm_readv(pid, local, cnt, remote, cnt, 0) != (ssize_t)want) {
+			for (size_t i = beg; i < end; i++) {
+				struct trace_val *val = &vals->list[i];
+				if (val->len)
+					val->len = read_mem(pid, buf + val->off, val->addr, val->len);
+			}
 		}
+		beg = end;
 	}
+}
 
-	/* fork linker */
-	switch (fork()) {
-	/* error */
-	case -1:
-		close(pipe_ld[0]);
-		close(pipe_exec[0]);
-		close(pipe_exec[1]);
-		ERR("%s", "error forking linker");
-		break;
+/* read the string at `addr` a page at a time so an unmapped tail doesn't fail the whole read */
+static bool read_str(pid_t pid, struct char_list *restrict str, uint64_t addr)
+{
+	truncate_char_list(str, 0);
+	while (str->cnt < TRACE_STR_MAX) {
+		size_t want = MIN(PAGE_SIZE - addr % PAGE_SIZE, TRACE_STR_MAX - str->cnt);
+		reserve_char_list(str, str->cnt + want + 1);
+		size_t got = read_mem(pid, str->list + str->cnt, addr, want);
+		if (!got)
+			return false;
+		char *nul = memchr(str->list + str->cnt, 0, got);
+		if (nul) {
+			str->cnt = nul - str->list;
+			return true;
+		}
+		str->cnt += got;
+		addr += got;
+	}
+	return true;
+}
 
-	/* child */
-	case 0:
-		dup2(null_fd, STDERR_FILENO);
-		dup2(pipe_exec[1], STDOUT_FILENO);
-		dup2(pipe_ld[0], STDIN_FILENO);
-		if (ld_list.list)
-			execvp(ld_list.list[0], ld_list.list);
-		/* fallback linker exec */
-		execvp(ld_alt_list[0], ld_alt_list);
-		/* execvp() should never return */
-		ERR("%s", "error forking linker");
-		break;
+/* load bias of a position-independent executable */
+static uint64_t load_bias(pid_t pid, int elf_fd)
+{
+	Elf64_Ehdr ehdr;
+	uint64_t aux[2] = {0}, bias = 0;
+	char path[64];
+	FILE *auxv;
 
-	/* parent */
+	if (pread(elf_fd, &ehdr, sizeof ehdr, 0) != sizeof ehdr)
+		return 0;
+	snprintf(path, sizeof path, "/proc/%d/auxv", (int)pid);
+	if (!(auxv = fopen(path, "rb")))
+		return 0;
+	while (fread(aux, sizeof aux, 1, auxv) == 1 && aux[0] != AT_NULL) {
+		if (aux[0] == AT_ENTRY) {
+			bias = aux[1] - ehdr.e_entry;
+			break;
+		}
+	}
+	fclose(auxv);
+	return bias;
+}
+
+/* normalize one traced value into the record the `print_vars()` printers would write */
+static void encode_val(struct char_list *restrict stream, pid_t pid, struct program const *restrict prog,
+		struct trace_val const *restrict val, char const *restrict buf, struct char_list *restrict str)
+{
+	struct dwarf_info const *info = &prog->dwarf;
+	enum var_type type = prog->var_list.list[val->entry].type_spec;
+	ptrdiff_t strip = dwarf_strip(info, val->type);
+	bool is_arr = strip >= 0 && info->types.list[strip].kind == K_ARRAY;
+	uint64_t raw = 0;
+	long double flt = 0;
+	long long sval;
+	char *text, vec[TRACE_VEC_MAX + 2];
+	size_t text_len;
+	FILE *dump;
+
+	memcpy(&raw, buf + val->off, MIN(val->len, sizeof raw));
+	switch (type) {
+	case T_CHR: /* fallthrough */
+	case T_INT:
+		/* sign extend narrower types */
+		sval = (val->len && val->len < sizeof raw)
+			? (long long)((int64_t)(raw << (64 - val->len * 8)) >> (64 - val->len * 8))
+			: (long long)raw;
+		push_rec(stream, val->entry, type, &sval, sizeof sval);
+		break;
+	case T_UINT:
+		push_rec(stream, val->entry, type, &raw, sizeof raw);
+		break;
+	case T_FLT:
+		if (val->len == sizeof(float)) {
+			float tmp;
+			memcpy(&tmp, buf + val->off, sizeof tmp);
+			flt = tmp;
+		} else if (val->len == sizeof(double)) {
+			double tmp;
+			memcpy(&tmp, buf + val->off, sizeof tmp);
+			flt = tmp;
+		} else if (val->len == sizeof(long double)) {
+			memcpy(&flt, buf + val->off, sizeof flt);
+		}
+		push_rec(stream, val->entry, type, &flt, sizeof flt);
+		break;
+	case T_STR:
+		if (is_arr)
+			push_rec(stream, val->entry, type, buf + val->off, strnlen(buf + val->off, val->len));
+		else if (!raw)
+			push_rec(stream, val->entry, type, NULL, VAL_NULL);
+		else if (read_str(pid, str, raw))
+			push_rec(stream, val->entry, type, str->list, str->cnt);
+		else
+			/* unreadable strings show their address */
+			push_rec(stream, val->entry, T_PTR, &raw, sizeof raw);
+		break;
+	case T_VEC:
+		/* tag the lanes with the declared element type */
+		vec[0] = (strip >= 0) ? dwarf_lane_kind(info, info->types.list[strip].base) : 'x';
+		vec[1] = (strip >= 0) ? dwarf_size(info, info->types.list[strip].base) : 1;
+		memcpy(vec + 2, buf + val->off, val->len);
+		push_rec(stream, val->entry, type, vec, val->len + 2);
+		break;
+	case T_PTR:
+		if (!is_arr) {
+			push_rec(stream, val->entry, type, &raw, sizeof raw);
+			break;
+		}
+		/* arrays are summarized straight out of the traced program */
+		dump = open_memstream(&text, &text_len);
+		if (!dump)
+			ERR("%s", "open_memstream()");
+		dump_array(dump, info, val->type, read_obj, &(struct trace_obj){pid, val->addr}, &prog->dump_opts, 0, true);
+		fclose(dump);
+		push_rec(stream, val->entry, REC_TEXT, text, text_len);
+		free(text);
+		break;
+	case T_OTHER: /* fallthrough */
 	default:
-		close(pipe_ld[0]);
-		close(pipe_exec[1]);
-		wait(&status);
-		/* convert 255 to -1 since WEXITSTATUS() only returns the low-order 8 bits */
-		if (WIFEXITED(status) && WEXITSTATUS(status)) {
-			/* WARNX("linker returned non-zero exit code"); */
-			return (WEXITSTATUS(status) != 0xff) ? WEXITSTATUS(status) : -1;
+		if (!val->len) {
+			push_rec(stream, val->entry, type, &val->addr, sizeof val->addr);
+			break;
 		}
+		/* structs and unions were copied whole */
+		dump = open_memstream(&text, &text_len);
+		if (!dump)
+			ERR("%s", "open_memstream()");
+		dump_value(dump, info, val->type, buf + val->off, val->len, &prog->dump_opts, 0);
+		fclose(dump);
+		push_rec(stream, val->entry, REC_TEXT, text, text_len);
+		free(text);
 	}
+}
+
+int trace_vars(struct program *restrict prog, int elf_fd, char **exec_args, int *restrict status)
+{
+#if !defined(__x86_64__)
+	(void)prog, (void)elf_fd, (void)exec_args, (void)status;
+	return -1;
+#else
+	struct dwarf_info const *info;
+	size_t cnt, buf_sz = 0;
+	struct trace_list vals;
+	struct user_regs_struct regs;
+	struct char_list str, stream;
+	char *buf = NULL;
+	int wstatus, sig = 0;
+	uint64_t trap;
+	pid_t pid;
+
+	/* sanity checks */
+	if (!prog || !exec_args || !status)
+		ERRX("%s", "NULL pointer passed to trace_vars()");
+	info = &prog->dwarf;
+	cnt = prog->var_list.cnt;
+	ptrdiff_t dwarf_idx[cnt + 1];
+	bool shown[cnt + 1];
+	if (!cnt || !mark_shown(prog, shown))
+		memset(shown, 0, sizeof shown);
 
-	/* fork executable */
-	switch (fork()) {
+	/* locals shadow file scope definitions */
+	for (size_t i = 0; i < cnt; i++)
+		dwarf_idx[i] = -1;
+	for (size_t pass = 0; pass < 2; pass++) {
+		for (size_t i = 0; i < info->vars.cnt; i++) {
+			ptrdiff_t idx = find_id(&prog->var_map, info->vars.list[i].id);
+			if (idx >= 0 && info->vars.list[i].is_global == !pass)
+				dwarf_idx[idx] = i;
+		}
+	}
+
+	/* plan the reads, bailing out to the printf path before running anything if one can't be located */
+	init_trace_list(&vals);
+	for (size_t i = 0; i < cnt; i++) {
+		struct var_entry const *entry = &prog->var_list.list[i];
+		if (!shown[i])
+			continue;
+		if (dwarf_idx[i] < 0 || info->vars.list[dwarf_idx[i]].loc_type == LOC_NONE) {
+			free_trace_list(&vals);
+			return -1;
+		}
+		struct dwarf_var const *var = &info->vars.list[dwarf_idx[i]];
+		ptrdiff_t type = dwarf_strip(info, var->type);
+		size_t len = dwarf_size(info, var->type);
+		bool is_arr = type >= 0 && info->types.list[type].kind == K_ARRAY, is_agg;
+		switch (entry->type_spec) {
+		case T_STR:
+			len = is_arr ? MIN(len, TRACE_STR_MAX) : MIN(len, sizeof(uint64_t));
+			break;
+		case T_PTR:
+			len = is_arr ? 0 : MIN(len, sizeof(uint64_t));
+			break;
+		case T_VEC:
+			len = MIN(len, TRACE_VEC_MAX);
+			break;
+		case T_OTHER:
+			/* aggregates are formatted member by member */
+			is_agg = type >= 0 && (info->types.list[type].kind == K_STRUCT || info->types.list[type].kind == K_UNION);
+			len = is_agg ? MIN(len, DUMP_READ_MAX) : 0;
+			break;
+		default:
+			len = MIN(len, sizeof(long double));
+		}
+		push_trace_list(&vals, (struct trace_val){
+			.entry = i, .type = var->type, .addr = var->loc,
+			.off = buf_sz, .len = len,
+		});
+		buf_sz += len;
+	}
+
+	/* without the breakpoint's address a stray trap could be read as it */
+	if (!(trap = find_elf_sym(elf_fd, VAR_TRAP_SYM))) {
+		free_trace_list(&vals);
+		return -1;
+	}
+
+	switch ((pid = fork())) {
 	/* error */
 	case -1:
-		close(pipe_exec[0]);
-		ERR("%s", "error forking executable");
+		ERR("%s", "error forking traced executable");
 		break;
 
 	/* child */
 	case 0:
 		reset_handlers();
-		if ((mem_fd = syscall(SYS_memfd_create, "cepl_memfd", MFD_CLOEXEC)) == -1)
-			ERR("%s", "error creating mem_fd");
-		pipe_fd(pipe_exec[0], mem_fd);
-		/* redirect stdout/stdin to /dev/null */
-		if (!(null_fd = open("/dev/null", O_WRONLY, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH)))
-			ERR("%s", "open()");
-		dup2(null_fd, STDIN_FILENO);
-		dup2(null_fd, STDOUT_FILENO);
-		fexecve(mem_fd, exec_args, environ);
+		if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) == -1)
+			_exit(EXIT_FAILURE);
+		/* this is the line's only run so it keeps the terminal */
+		fexecve(elf_fd, exec_args, environ);
 		/* fexecve() should never return */
-		ERR("%s", "error forking executable");
+		_exit(EXIT_FAILURE);
 		break;
+	}
+	prog->trace_pid = pid;
 
-	/* parent */
-	default:
-		close(pipe_exec[0]);
-		close(null_fd);
-		wait(&status);
-		/* convert 255 to -1 since WEXITSTATUS() only returns the low-order 8 bits */
-		if (WIFEXITED(status) && WEXITSTATUS(status)) {
-			/* WARNX("executable returned non-zero exit code"); */
-			return (WEXITSTATUS(status) != 0xff) ? WEXITSTATUS(status) : -1;
+	/* anything but the stop at exec means nothing ran */
+	if (waitpid(pid, &wstatus, 0) == -1 || !WIFSTOPPED(wstatus)) {
+		prog->trace_pid = 0;
+		free_trace_list(&vals);
+		return -1;
+	}
+	ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)PTRACE_O_EXITKILL);
+
+	/* read the values at the breakpoint and let the program finish, passing every other signal through */
+	init_char_list(&str);
+	init_char_list(&stream);
+	for (bool trapped = false;;) {
+		ptrace(PTRACE_CONT, pid, NULL, (void *)(uintptr_t)sig);
+		if (waitpid(pid, &wstatus, 0) == -1 || !WIFSTOPPED(wstatus))
+			break;
+		sig = WSTOPSIG(wstatus);
+		if (sig != SIGTRAP || trapped)
+			continue;
+		/* `int3` leaves `rip` just past it, and any other trap is the program's own */
+		uint64_t bias = load_bias(pid, elf_fd);
+		if (ptrace(PTRACE_GETREGS, pid, NULL, &regs) == -1 || regs.rip - 1 != bias + trap)
+			continue;
+		trapped = true;
+		sig = 0;
+		if (!vals.cnt)
+			continue;
+		/* `-O0` frames keep `rbp` so the canonical frame address is right above it */
+		uint64_t cfa = regs.rbp + 16;
+		for (size_t i = 0; i < vals.cnt; i++) {
+			struct dwarf_var const *var = &info->vars.list[dwarf_idx[vals.list[i].entry]];
+			vals.list[i].addr = (var->loc_type == LOC_FRAME) ? cfa + var->loc : bias + var->loc;
 		}
+		xmalloc(char, &buf, buf_sz + 1, "trace_vars()");
+		read_vals(pid, &vals, buf);
+		for (size_t i = 0; i < vals.cnt; i++)
+			encode_val(&stream, pid, prog, &vals.list[i], buf, &str);
 	}
+	prog->trace_pid = 0;
 
+	/* convert 255 to -1 since WEXITSTATUS() only returns the low-order 8 bits */
+	*status = 0;
+	if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus)) {
+		WARNX("%s", "executable returned non-zero exit code");
+		*status = (WEXITSTATUS(wstatus) != 0xff) ? WEXITSTATUS(wstatus) : -1;
+	}
+	/* a run that crashed is reported instead of showing what it held at the breakpoint */
+	if (WIFSIGNALED(wstatus)) {
+		WARNX("executable killed by signal %d (%s)", WTERMSIG(wstatus), strsignal(WTERMSIG(wstatus)));
+		*status = -1;
+	} else {
+		show_recs(prog, stderr, stream.list, stream.cnt);
+	}
+
+	free(buf);
+	free_char_list(&str);
+	free_char_list(&stream);
+	free_trace_list(&vals);
 	return 0;
+#endif
 }
@@ -9,74 +9,151 @@
 #define VARS_H 1
 
 #include "compile.h"
+#include "dump.h"
+#include "dwarf.h"
+#include "idmap.h"
+#include "intern.h"
 #include "parseopts.h"
 #include <linux/memfd.h>
-#include <regex.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/ptrace.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/user.h>
 #include <sys/wait.h>
 
 /* prototypes */
-enum var_type extract_type(char const *restrict ln, char const *restrict id);
-size_t extract_id(char const *restrict ln, char **restrict id, size_t *restrict off);
-int find_vars(struct program *restrict prog, char const *restrict code);
-int print_vars(struct program *restrict prog, char *const *restrict cc_args, char **exec_args);
+enum var_type extract_type(char const *restrict ln, size_t len, char const *restrict id);
+int find_vars(struct program *restrict prog, char const *restrict code, size_t len);
+int print_vars(struct program *restrict prog, struct char_list *restrict src);
+void show_vars(struct program const *restrict prog, int rec_fd);
+int trace_vars(struct program *restrict prog, int elf_fd, char **exec_args, int *restrict status);
+int show_recs(struct program const *restrict prog, FILE *restrict out, char const *restrict buf, size_t len);
 
-static inline void init_var_list(struct var_list *restrict var_list)
+/* struct definition for a value record header (followed by `len` raw bytes) */
+struct val_rec {
+	uint32_t idx, type;
+	uint64_t len;
+};
+
+/* record length of a NULL string */
+#define VAL_NULL	UINT64_MAX
+/* record type of a value already formatted as text */
+#define REC_TEXT	0x100
+
+/* breakpoint appended to the end of `main()` in builds run by `trace_vars()`, labeled so other traps can be told apart */
+#define VAR_TRAP_SYM	"cepl_trap_"
+#if defined(__x86_64__)
+#	define VAR_TRAP	"\n\t__asm__ volatile (\"" VAR_TRAP_SYM ": int3\");"
+#else
+#	define VAR_TRAP	""
+#endif
+
+/* kill and reap the child `trace_vars()` is running, if any */
+static inline void kill_trace(struct program *restrict prog)
 {
-	char init_str[] = "FOOBARTHISVALUEDOESNTMATTERTROLLOLOLOL";
-	var_list->cnt = 0;
-	var_list->max = 1;
-	xcalloc(char, &var_list->list, 1, sizeof *var_list->list, "init_prog->var_list()");
-	var_list->cnt++;
-	xcalloc(char, &var_list->list[var_list->cnt - 1].id, 1, strlen(init_str) + 1, "init_prog->var_list");
-	strmv(0, var_list->list[var_list->cnt - 1].id, init_str);
-	var_list->list[var_list->cnt - 1].type_spec = T_ERR;
+	int status;
+	if (!prog->trace_pid)
+		return;
+	kill(prog->trace_pid, SIGKILL);
+	waitpid(prog->trace_pid, &status, 0);
+	prog->trace_pid = 0;
 }
 
-static inline void append_var(struct var_list *restrict var_list, char const *restrict id, enum var_type type_spec)
+/* drop entries of `list` declared after history line `line`, unshadowing what they hid */
+static inline void pop_entries(struct var_list *restrict list, struct id_map *restrict map, size_t line)
 {
-	if (type_spec == T_ERR || !id)
-		return;
-	/* realloc if cnt reaches current size */
-	if (++var_list->cnt >= var_list->max) {
-		var_list->max *= 2;
-		xrealloc(char, &var_list->list, sizeof *var_list->list * var_list->max, "append_var()");
+	size_t cnt = list->cnt;
+	/*
+	 * entries are appended in line order, except ones only debug info
+	 * found, which carry their declaring line and may sit above later
+	 * lines; those are unbound in reverse and what stays is packed down
+	 */
+	for (size_t i = list->cnt; i-- > 0;) {
+		struct var_entry const *cur = &list->list[i];
+		if (cur->line <= line)
+			continue;
+		if (cur->shadow == -1)
+			del_id(map, cur->id);
+		else
+			set_id(map, cur->id, cur->shadow);
+		cnt = i;
+	}
+	for (size_t i = cnt; i < list->cnt; i++) {
+		if (list->list[i].line > line)
+			continue;
+		if (find_id(map, list->list[i].id) == (ptrdiff_t)i)
+			set_id(map, list->list[i].id, cnt);
+		list->list[cnt++] = list->list[i];
 	}
-	xcalloc(char, &var_list->list[var_list->cnt - 1].id, 1, strlen(id) + 1, "append_var()");
-	strmv(0, var_list->list[var_list->cnt - 1].id, id);
-	var_list->list[var_list->cnt - 1].type_spec = type_spec;
+	truncate_var_list(list, cnt);
 }
 
+/* drop variables and typedefs declared after history line `line` */
+static inline void pop_vars(struct program *restrict prog, size_t line)
+{
+	pop_entries(&prog->var_list, &prog->var_map, line);
+	pop_entries(&prog->typedef_list, &prog->typedef_map, line);
+}
+
+/* add the identifiers from the last `find_vars()` call to `prog->var_list` */
 static inline void gen_var_list(struct program *restrict prog)
 {
 	/* sanity checks */
-	if (!prog || !prog->id_list.list || !prog->type_list.list)
+	if (!prog)
 		ERRX("%s", "NULL pointer passed to gen_var_list()");
 	/* nothing to do */
 	if (!prog->id_list.cnt || !prog->type_list.cnt)
 		return;
-	/* don't add duplicate keys to prog->var_list */
+	size_t line = prog->src[0].flags.cnt;
 	for (size_t i = 0; i < prog->id_list.cnt; i++) {
-		for (ptrdiff_t j = prog->var_list.cnt - 1; j >= 0; j--) {
-			/* if type or id don't match then continue */
-			if (prog->type_list.list[i] != prog->var_list.list[j].type_spec)
-				continue;
-			if (strcmp(prog->id_list.list[i], prog->var_list.list[j].id))
-				continue;
-			/* else return if a match is found */
-			return;
+		size_t id = prog->id_list.list[i];
+		enum var_type type_spec = prog->type_list.list[i];
+		if (type_spec == T_ERR || !id)
+			continue;
+		/* redeclaring with the same type is a duplicate */
+		ptrdiff_t prev = find_id(&prog->var_map, id);
+		if (prev != -1 && prog->var_list.list[prev].type_spec == type_spec)
+			continue;
+		/* anything else shadows the earlier declaration */
+		push_var_list(&prog->var_list, (struct var_entry){
+			.id = id, .line = line,
+			.shadow = prev, .type_spec = type_spec,
+		});
+		set_id(&prog->var_map, id, prog->var_list.cnt - 1);
+	}
+}
+
+/* flag the visible entries the current line touched (all of them after `;vars`), returning the count */
+static inline size_t mark_shown(struct program const *restrict prog, bool *restrict shown)
+{
+	size_t cnt = 0;
+	memset(shown, 0, sizeof *shown * prog->var_list.cnt);
+	if (prog->dump_all) {
+		for (size_t i = 0; i < prog->var_list.cnt; i++) {
+			if (find_id(&prog->var_map, prog->var_list.list[i].id) == (ptrdiff_t)i)
+				shown[i] = true;
+		}
+	} else {
+		for (size_t i = 0; i < prog->touch_list.cnt; i++) {
+			ptrdiff_t idx = find_id(&prog->var_map, prog->touch_list.list[i]);
+			if (idx >= 0)
+				shown[idx] = true;
 		}
-		/* no matches found */
-		append_var(&prog->var_list, prog->id_list.list[i], prog->type_list.list[i]);
 	}
+	for (size_t i = 0; i < prog->var_list.cnt; i++) {
+		shown[i] &= prog->var_list.list[i].type_spec != T_ERR;
+		cnt += shown[i];
+	}
+	return cnt;
 }
 
 #endif /* !defined(VARS_H) */
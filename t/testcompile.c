@@ -12,6 +12,7 @@ int main(void)
 {
 	char *argv[] = {"cepl", NULL};
 	char *const src = "int main(void)\n{\nreturn 0;\n}";
+	char *const bad_src = "int main(void)\n{\nreturn nope;\n}";
 	char *const cc_args[] = {
 		"gcc",
 		"-O0", "-pipe",
@@ -23,11 +24,12 @@ int main(void)
 		NULL
 	};
 
-	plan(3);
+	plan(4);
 
 	lives_ok({pipe_fd(-1, -1);}, "test living through pipe_fd() call with invalid fds.");
 	dies_ok({compile(NULL, NULL, argv, true);}, "die passing a NULL pointer to compile().");
 	ok(compile(src, cc_args, argv, true) == 0, "succeed compiling program.");
+	ok(compile(bad_src, cc_args, argv, false) == 1, "succeed returning the compiler's exit status.");
 
 	done_testing();
 }
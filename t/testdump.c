@@ -0,0 +1,99 @@
+/*
+ * t/testdump.c - unit-test for dump.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/dump.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* global string pool */
+struct str_pool str_pool;
+
+/* format an in-memory value and compare the output against `want` */
+static bool dumps(struct dwarf_info const *info, ptrdiff_t type, void const *buf, size_t len,
+		struct dump_opts const *opts, bool is_top, char const *want)
+{
+	char *text;
+	size_t text_len;
+	FILE *out = open_memstream(&text, &text_len);
+	struct dump_mem mem = {buf, len};
+
+	if (!out)
+		BAIL_OUT("open_memstream() failed");
+	if (is_top)
+		dump_array(out, info, type, dump_read_mem, &mem, opts, 0, true);
+	else
+		dump_value(out, info, type, buf, len, opts, 0);
+	fclose(out);
+	bool ret = !strcmp(text, want);
+	if (!ret)
+		diag("got: %s", text);
+	free(text);
+	return ret;
+}
+
+int main(void)
+{
+	struct dwarf_info info = {0};
+	struct dump_opts opts = {.head = 3, .tail = 2, .stride = 1};
+	int ints[10];
+	double dbls[4] = {1.5, NAN, -2, 4};
+	struct { int x; unsigned f: 3; char name[4]; } pts[2] = {{7, 5, "ab"}, {-1, 2, "cd"}};
+
+	for (size_t i = 0; i < ARR_LEN(ints); i++)
+		ints[i] = i * 10;
+	pts[0].f = -3 & 7;
+
+	init_dwarf(&info);
+	/* int, int[10], double, double[4], char, char[4], struct, struct[2], int vector_size(16) */
+	struct dwarf_type types[] = {
+		{.kind = K_BASE, .enc = ATE_SIGNED, .name = intern_str(&info.names, "int"), .size = 4, .base = -1},
+		{.kind = K_ARRAY, .cnt = 10, .base = 0},
+		{.kind = K_BASE, .enc = ATE_FLOAT, .name = intern_str(&info.names, "double"), .size = 8, .base = -1},
+		{.kind = K_ARRAY, .cnt = 4, .base = 2},
+		{.kind = K_BASE, .enc = ATE_SIGNED_CHAR, .name = intern_str(&info.names, "char"), .size = 1, .base = -1},
+		{.kind = K_ARRAY, .cnt = 4, .base = 4},
+		{.kind = K_STRUCT, .size = sizeof pts[0], .base = -1, .memb_off = 0, .memb_cnt = 3},
+		{.kind = K_ARRAY, .cnt = 2, .base = 6},
+		{.kind = K_VECTOR, .cnt = 4, .base = 0},
+	};
+	struct dwarf_member membs[] = {
+		{.name = intern_str(&info.names, "x"), .off = 0, .type = 0},
+		{.name = intern_str(&info.names, "f"), .off = 4, .bit_size = 3, .type = 0},
+		{.name = intern_str(&info.names, "name"), .off = 5, .type = 5},
+	};
+	extend_dwarf_type_list(&info.types, types, ARR_LEN(types));
+	extend_dwarf_memb_list(&info.membs, membs, ARR_LEN(membs));
+
+	plan(9);
+
+	ok(dumps(&info, 1, ints, sizeof ints, &opts, true, "[0, 10, 20, ..., 80, 90] (10 elements, min 0, max 90, sum 450)"),
+			"succeed eliding the middle of a long array.");
+	opts.stride = 3;
+	ok(dumps(&info, 1, ints, sizeof ints, &opts, true, "[0, 30, 60, 90] (10 elements, min 0, max 90, sum 450)"),
+			"succeed stepping by stride without skipping stats.");
+	opts = (struct dump_opts){.head = 2, .tail = 0, .stride = 1};
+	ok(dumps(&info, 1, ints, sizeof ints, &opts, false, "[0, 10, ...]"), "succeed eliding the tail of a nested array.");
+	opts = DUMP_OPTS_DEF_INIT;
+	ok(dumps(&info, 3, dbls, sizeof dbls, &opts, true, "[1.5, nan, -2, 4] (4 elements, min -2, max 4, sum 3.5, 1 nan)"),
+			"succeed counting NaNs apart from the stats.");
+	ok(dumps(&info, 6, pts, sizeof pts[0], &opts, false, "{.x = 7, .f = -3, .name = \"ab\"}"),
+			"succeed printing members, bit-fields, and char arrays.");
+	ok(dumps(&info, 7, pts, sizeof pts, &opts, true, "[{.x = 7, .f = -3, .name = \"ab\"}, {.x = -1, .f = 2, .name = \"cd\"}]"),
+			"succeed printing arrays of structs without stats.");
+	ok(dumps(&info, 6, pts, 4, &opts, false, "{.x = 7, .f = ?, .name = ?}"), "succeed marking members past a short read.");
+	int lanes[4] = {-1, 2, 3, 4};
+	ok(dumps(&info, 8, lanes, sizeof lanes, &opts, false, "i32 {-1, 2, 3, 4}"), "succeed printing vector lanes as declared.");
+	opts.lane_kind = 'x';
+	opts.lane_size = 8;
+	ok(dumps(&info, 8, lanes, sizeof lanes, &opts, false, "x64 {0x2ffffffff, 0x400000003}"), "succeed printing vector lanes in a chosen view.");
+
+	free_dwarf(&info);
+	free_pool(&str_pool);
+
+	done_testing();
+}
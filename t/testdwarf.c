@@ -0,0 +1,103 @@
+/*
+ * t/testdwarf.c - unit-test for dwarf.c
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/dwarf.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* global string pool */
+struct str_pool str_pool;
+
+static struct dwarf_var const *get_var(struct dwarf_info const *info, char const *name)
+{
+	size_t id = find_len(&str_pool, name, strlen(name));
+	for (size_t i = 0; id && i < info->vars.cnt; i++) {
+		if (info->vars.list[i].id == id)
+			return &info->vars.list[i];
+	}
+	return NULL;
+}
+
+static enum var_type var_type(struct dwarf_info const *info, char const *name)
+{
+	struct dwarf_var const *var = get_var(info, name);
+	return var ? dwarf_var_type(info, var->type) : T_ERR;
+}
+
+int main(void)
+{
+	struct dwarf_info info = {0};
+	char elf_file[] = "/tmp/cepl_dwarfXXXXXX";
+	char cmd[0x100];
+	char const src[] =
+		"typedef unsigned long word;\n"
+		"typedef short v8hi __attribute__((vector_size(16)));\n"
+		"struct point { int x; short y; unsigned flag: 3; };\n"
+		"int glob = 1;\n"
+		"int main(void)\n"
+		"{\n"
+		"\tword w = 7;\n"
+		"\tchar name[8] = \"abc\";\n"
+		"\tint grid[2][3] = {{0}};\n"
+		"\tstruct point pt = {0};\n"
+		"\tdouble *dp = 0;\n"
+		"\tsigned char sc = 1;\n"
+		"\tv8hi vec = {0};\n"
+		"\treturn (int)w + name[0] + grid[1][2] + pt.x + !dp + sc + vec[0];\n"
+		"}\n";
+	int elf_fd, null_fd;
+	FILE *cc;
+
+	/* build a debug executable to inspect */
+	if ((elf_fd = mkstemp(elf_file)) == -1)
+		BAIL_OUT("mkstemp() failed");
+	close(elf_fd);
+	snprintf(cmd, sizeof cmd, "gcc -g -O0 -std=c11 -xc - -o %s", elf_file);
+	if (!(cc = popen(cmd, "w")))
+		BAIL_OUT("popen() failed");
+	fputs(src, cc);
+	if (pclose(cc))
+		BAIL_OUT("compiling test program failed");
+	if ((elf_fd = open(elf_file, O_RDONLY)) == -1)
+		BAIL_OUT("open() failed");
+
+	plan(13);
+
+	ok(read_dwarf(&info, elf_fd, "main") == 8, "succeed reading locals and file scope definitions.");
+	ok(var_type(&info, "w") == T_UINT, "succeed resolving typedef to base type.");
+	ok(var_type(&info, "name") == T_STR && dwarf_size(&info, get_var(&info, "name")->type) == 8, "succeed sizing char array.");
+	ok(var_type(&info, "grid") == T_PTR && dwarf_size(&info, get_var(&info, "grid")->type) == 24, "succeed sizing 2-d array.");
+	ok(var_type(&info, "dp") == T_PTR && var_type(&info, "sc") == T_INT, "succeed classifying pointer and signed char.");
+	ok(var_type(&info, "vec") == T_VEC && dwarf_size(&info, get_var(&info, "vec")->type) == 16
+		&& dwarf_lane_kind(&info, info.types.list[dwarf_strip(&info, get_var(&info, "vec")->type)].base) == 'i',
+		"succeed reading vector types.");
+	ok(get_var(&info, "w")->loc_type == LOC_FRAME && get_var(&info, "glob")->is_global, "succeed decoding locations.");
+	ok(get_var(&info, "glob")->line == 4 && get_var(&info, "w")->line == 7, "succeed reading declaration lines.");
+
+	struct dwarf_type const *pt = &info.types.list[dwarf_strip(&info, get_var(&info, "pt")->type)];
+	struct dwarf_member const *membs = info.membs.list + pt->memb_off;
+	ok(var_type(&info, "pt") == T_OTHER && pt->kind == K_STRUCT && pt->memb_cnt == 3, "succeed reading struct members.");
+	ok(membs[1].off == 4 && dwarf_size(&info, membs[1].type) == 2, "succeed reading member offset and size.");
+	ok(membs[2].bit_size == 3 && membs[2].off == 6 && membs[2].bit_off == 0, "succeed reading bit-field position.");
+	ok(!strcmp(pool_str(&info.names, membs[2].name), "flag") && find_len(&info.names, "point", 5)
+			&& !find_len(&str_pool, "flag", 4) && !find_len(&str_pool, "point", 5) && !find_len(&str_pool, "main", 4),
+			"succeed keeping type and member names out of the global pool.");
+	close(elf_fd);
+	unlink(elf_file);
+
+	if ((null_fd = open("/dev/null", O_RDONLY)) == -1)
+		BAIL_OUT("open() failed");
+	ok(read_dwarf(&info, null_fd, "main") == -1, "fail reading a non-ELF file.");
+	close(null_fd);
+
+	free_dwarf(&info);
+	free_pool(&str_pool);
+
+	done_testing();
+}
@@ -0,0 +1,149 @@
+/*
+ * t/testhdrs.c - unit-test for hdrs.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/hdrs.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* global string pool */
+struct str_pool str_pool;
+
+/* whether `name` is indexed once as `kind` with signature `sig` */
+static bool has_hdr(struct hdr_index const *idx, char const *name, enum hdr_kind kind, char const *sig)
+{
+	size_t cnt, beg = find_hdr(idx, name, &cnt);
+	for (size_t i = beg; i < beg + cnt; i++) {
+		struct hdr_ent const *ent = &idx->ents.list[i];
+		if (ent->kind == kind && !strcmp(hdr_str(idx, ent->sig), sig))
+			return true;
+	}
+	if (cnt)
+		diag("%s: %s", name, hdr_str(idx, idx->ents.list[beg].sig));
+	return false;
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/cepl_hdrsXXXXXX";
+	char hdr[sizeof dir + 0x10], cache[sizeof dir + 0x10], home_cache[sizeof dir + 0x10], text[0x1000];
+	struct hdr_index idx = {0}, cached = {0};
+	size_t cnt;
+	FILE *file;
+
+	if (!mkdtemp(dir))
+		BAIL_OUT("mkdtemp() failed");
+	snprintf(hdr, sizeof hdr, "%s/x.h", dir);
+	snprintf(cache, sizeof cache, "%s/cache", dir);
+	snprintf(home_cache, sizeof home_cache, "%s/" HDR_CACHE_NAME, dir);
+	if (!(file = fopen(hdr, "w")))
+		BAIL_OUT("fopen() failed");
+	fputs("/* stand-in header */\n", file);
+	fclose(file);
+	/* what `gcc -E -dD` prints for a prologue including `x.h` */
+	snprintf(text, sizeof text,
+		"# 0 \"/dev/stdin\"\n"
+		"# 0 \"<built-in>\"\n"
+		"#define __STDC__ 1\n"
+		"#define unix 1\n"
+		"# 0 \"<command-line>\"\n"
+		"# 1 \"/dev/stdin\"\n"
+		"# 1 \"%s\" 1\n"
+		"#define _X_H \n"
+		"#define EOF (-1)\n"
+		"#define max(a,b) ((a) > (b) ? (a) : (b))\n"
+		"typedef unsigned long size_t;\n"
+		"typedef struct pt {\n int x, y;\n struct { char c; } in;\n} pt_t;\n"
+		"extern int printf (const char *__restrict __format, ...) __attribute__ ((__nothrow__));\n"
+		"extern void (*signal (int __sig, void (*__handler) (int))) (int);\n"
+		"extern char **environ;\n"
+		"typedef void (*handler_t) (int);\n"
+		"enum color { RED, GREEN = (1 << 2), BLUE };\n"
+		"static __inline int inl (int a) { if (a) { return 1; } return 0; }\n"
+		"extern int __internal (void);\n"
+		"struct fwd;\n"
+		"# 2 \"/dev/stdin\" 2\n"
+		"int prologue_var;\n", hdr);
+
+	plan(11);
+
+	init_hdrs(&idx);
+	parse_hdrs(&idx, text, strlen(text));
+	ok(has_hdr(&idx, "EOF", H_MACRO, "#define EOF (-1)") && has_hdr(&idx, "max", H_MACRO, "#define max(a,b)"),
+			"succeed indexing object-like and function-like macros.");
+	find_hdr(&idx, "unix", &cnt);
+	size_t guard;
+	find_hdr(&idx, "_X_H", &guard);
+	size_t mine;
+	find_hdr(&idx, "prologue_var", &mine);
+	ok(!cnt && !guard && !mine, "succeed skipping built-ins, include guards, and the prologue itself.");
+	ok(has_hdr(&idx, "printf", H_FUNC, "int printf(const char *__restrict __format, ...)")
+			&& has_hdr(&idx, "signal", H_FUNC, "void (*signal(int __sig, void (*__handler)(int)))(int)")
+			&& has_hdr(&idx, "inl", H_FUNC, "int inl(int a)"),
+			"succeed indexing prototypes and definitions without attributes.");
+	ok(has_hdr(&idx, "environ", H_VAR, "char **environ")
+			&& has_hdr(&idx, "size_t", H_TYPEDEF, "typedef unsigned long size_t")
+			&& has_hdr(&idx, "handler_t", H_TYPEDEF, "typedef void (*handler_t)(int)"),
+			"succeed indexing variables and typedefs.");
+	ok(has_hdr(&idx, "x", H_MEMBER, "struct pt: int x, y") && has_hdr(&idx, "y", H_MEMBER, "struct pt: int x, y")
+			&& has_hdr(&idx, "in", H_MEMBER, "struct pt: struct {...} in")
+			&& has_hdr(&idx, "pt_t", H_TYPEDEF, "typedef struct pt {...} pt_t"),
+			"succeed indexing struct members and nested bodies.");
+	find_hdr(&idx, "__internal", &cnt);
+	find_hdr(&idx, "fwd", &guard);
+	ok(has_hdr(&idx, "GREEN", H_ENUM, "enum color: GREEN") && has_hdr(&idx, "BLUE", H_ENUM, "enum color: BLUE")
+			&& !cnt && !guard, "succeed indexing enumerators and skipping reserved names and tags.");
+
+	/* the cache is only reused for the same key and unchanged headers */
+	idx.key = 42;
+	ok(!save_hdr_cache(&idx, cache), "succeed writing the header cache.");
+	init_hdrs(&cached);
+	ok(load_hdr_cache(&cached, cache, 42) && cached.ents.cnt == idx.ents.cnt
+			&& has_hdr(&cached, "printf", H_FUNC, "int printf(const char *__restrict __format, ...)"),
+			"succeed loading the header cache.");
+	free_hdrs(&cached);
+	init_hdrs(&cached);
+	bool other_key = load_hdr_cache(&cached, cache, 43);
+	if (!(file = fopen(hdr, "a")))
+		BAIL_OUT("fopen() failed");
+	fputs("int changed;\n", file);
+	fclose(file);
+	ok(!other_key && !load_hdr_cache(&cached, cache, 42), "succeed rejecting other keys and changed headers.");
+	free_hdrs(&cached);
+	free_hdrs(&idx);
+
+	/* a real preprocessor run, cached under `$HOME` */
+	char *cc_args[] = {"gcc", "-std=c11", "-S", "-xc", "/dev/stdin", "-o", "/dev/stdout", NULL};
+	setenv("HOME", dir, 1);
+	init_hdrs(&idx);
+	set_hdr_args(&idx, cc_args, "#include <stdio.h>\n");
+	bool built = sync_hdrs(&idx) && !sync_hdrs(&idx);
+	ok(built && idx.files.cnt && has_hdr(&idx, "fopen", H_FUNC, "FILE *fopen(const char *__restrict __filename, const char *__restrict __modes)")
+			&& !set_hdr_args(&idx, cc_args, "#include <stdio.h>\n"), "succeed preprocessing the prologue once.");
+
+	/* completions pick up a rebuild once its thread finishes */
+	struct id_list comps;
+	bool started, found = false;
+	init_id_list(&comps);
+	set_hdr_args(&idx, cc_args, "#include <string.h>\n");
+	started = start_hdrs(&idx) && !start_hdrs(&idx);
+	while (!merge_hdrs(&idx, &comps))
+		usleep(1000);
+	for (size_t i = 0; i < comps.cnt; i++)
+		found |= comps.list[i] == find_len(&str_pool, "strlen", 6);
+	ok(started && found && !idx.building && !merge_hdrs(&idx, &comps), "succeed rebuilding the index in the background.");
+	free_id_list(&comps);
+	free_hdrs(&idx);
+
+	unlink(hdr);
+	unlink(cache);
+	unlink(home_cache);
+	rmdir(dir);
+	free_pool(&str_pool);
+
+	done_testing();
+}
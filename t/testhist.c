@@ -13,7 +13,12 @@
 int mkstemp(char *__template);
 
 /* globals */
-struct str_list comp_list;
+struct id_list comp_list;
+struct sym_load sym_load;
+struct hdr_index hdr_index;
+struct sess_comps sess_comps;
+extern struct hist_index hist_index;
+struct str_pool str_pool;
 char *input_src[3];
 /* global completion list struct */
 char *const cc_arg_list[] = {
@@ -40,18 +45,11 @@ char *const warn_list[] = {
 static char asm_error[] = "/a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q/r/s/t/u/v/w/s/y/z";
 static char *argv[] = {"cepl", NULL};
 
-/* print_vars() stub */
-int print_vars(struct program *restrict prog, char *const *restrict cc_args, char **exec_args)
-{
-	(void)prog, (void)cc_args, (void)exec_args;
-	return 0;
-}
-
 int main (void)
 {
 	int saved_fd = dup(STDERR_FILENO);
 	struct program prg = {0};
-	plan(14);
+	plan(16);
 
 	using_history();
 	xcalloc(char, &prg.cur_line, 1, EVAL_LIMIT, "lptr calloc()");
@@ -78,6 +76,25 @@ int main (void)
 	lives_ok({pop_history(&prg);}, "test pop_history().");
 	lives_ok({build_final(&prg, argv);}, "test secondary program build success.");
 
+	/* history read from a file, then lines entered again */
+	char *lines[] = {"int a = 1;", "puts(\"x\");", "int a = 1;", "  puts(\"x\");"}, buf[0x20], *ptr = buf;
+	add_history(lines[0]);
+	add_history(lines[1]);
+	index_history(&hist_index);
+	dedup_history_add(&hist_index, &lines[2]);
+	dedup_history_add(&hist_index, &lines[3]);
+	ok(history_length == 2 && !strcmp(history_get(history_base)->line, lines[0])
+			&& !strcmp(history_get(history_base + 1)->line, lines[1]),
+			"succeed moving re-entered lines to the end of history.");
+	for (size_t i = 0; i < 1000; i++) {
+		snprintf(buf, sizeof buf, "int v%zu;", i * 7 % 100);
+		dedup_history_add(&hist_index, &ptr);
+	}
+	ok(history_length == 102 && !strcmp(history_get(history_base + 101)->line, buf)
+			&& hist_index.search.lines.cnt == 102 && !find_len(&str_pool, buf, strlen(buf)),
+			"succeed keeping one entry per distinct line outside the identifier pool.");
+	clear_history();
+
 	/* cleanup */
 	close(STDERR_FILENO);
 	ok(write_asm(&prg, cc_arg_list) == -1, "test return of -1 on failed `write_asm()`.");
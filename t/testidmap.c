@@ -0,0 +1,47 @@
+/*
+ * t/testvarmap.c - unit-test for idmap.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/idmap.h"
+
+/* whether ids `beg` .. `end` (stepping by `step`) are bound to `id * 2` */
+static bool bound(struct id_map const *map, size_t beg, size_t end, size_t step)
+{
+	for (size_t id = beg; id <= end; id += step) {
+		if (find_id(map, id) != (ptrdiff_t)(id * 2))
+			return false;
+	}
+	return true;
+}
+
+int main(void)
+{
+	struct id_map map;
+
+	plan(5);
+
+	init_id_map(&map);
+	ok(find_id(&map, 1) == -1 && !map.cnt, "succeed finding nothing in an empty map.");
+	for (size_t id = 1; id <= 1000; id++)
+		set_id(&map, id, id * 2);
+	ok(map.cnt == 1000 && map.slots >= 2000 && bound(&map, 1, 1000, 1), "succeed binding ids across growth.");
+	set_id(&map, 7, 0);
+	set_id(&map, 0, 1);
+	ok(map.cnt == 1000 && find_id(&map, 7) == 0 && find_id(&map, 0) == -1, "succeed rebinding an id and ignoring id 0.");
+	set_id(&map, 7, 14);
+
+	/* deletions shift displaced slots back instead of leaving tombstones */
+	for (size_t id = 2; id <= 1000; id += 2)
+		del_id(&map, id);
+	del_id(&map, 2);
+	ok(map.cnt == 500 && find_id(&map, 2) == -1 && find_id(&map, 1000) == -1,
+		"succeed deleting every even id once.");
+	ok(bound(&map, 1, 999, 2), "succeed finding every odd id after the deletions.");
+	free_id_map(&map);
+
+	done_testing();
+}
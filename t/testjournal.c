@@ -0,0 +1,154 @@
+/*
+ * t/testjournal.c - unit-test for journal.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/journal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <readline/history.h>
+
+static char loaded[0x100];
+
+/* stand-in for `add_history()` joining lines with spaces, marking successful ones with `+` */
+static void add_line(char const *restrict line, bool ok)
+{
+	if (ok)
+		strcat(loaded, "+");
+	strncat(loaded, line, sizeof loaded - strlen(loaded) - 3);
+	strcat(loaded, " ");
+}
+
+static void write_file(char const *file, char const *buf)
+{
+	FILE *out = fopen(file, "wb");
+	if (!out || fputs(buf, out) == EOF)
+		BAIL_OUT("writing %s failed", file);
+	fclose(out);
+}
+
+static void read_file(char const *file, char *buf, size_t len)
+{
+	FILE *in = fopen(file, "rb");
+	size_t cnt = in ? fread(buf, 1, len - 1, in) : 0;
+	buf[cnt] = 0;
+	if (in)
+		fclose(in);
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/cepl_journalXXXXXX";
+	char file[sizeof dir + 0x10], buf[0x100];
+	char const text[] = "int a;\nputs(\"b\");\nint a;\n\nint c;";
+	struct hist_journal jrn, other;
+	struct size_list keep;
+
+	if (!mkdtemp(dir))
+		BAIL_OUT("mkdtemp() failed");
+	snprintf(file, sizeof file, "%s/history", dir);
+
+	plan(14);
+
+	init_size_list(&keep);
+	size_t lines = dedup_journal(&keep, text, sizeof text - 1);
+	ok(lines == 5 && keep.cnt == 3 && keep.list[0] == 7 && keep.list[1] == 18 && keep.list[2] == 26,
+			"succeed keeping the last copy of each line in order.");
+	free_size_list(&keep);
+
+	load_journal(&jrn, file, add_line);
+	ok(!jrn.lines && !loaded[0], "succeed loading a missing journal.");
+	append_journal(&jrn, "int a;", false, add_line);
+	append_journal(&jrn, "int b;", false, add_line);
+	append_journal(&jrn, "int a;", false, add_line);
+	finish_journal(&jrn);
+	load_journal(&jrn, file, add_line);
+	ok(jrn.lines == 3 && !strcmp(loaded, "int b; int a; "), "succeed loading appended lines without duplicates.");
+	ok(compact_journal(file, NULL, NULL) == 2, "succeed compacting the journal.");
+	read_file(file, buf, sizeof buf);
+	ok(!strcmp(buf, "int b;\nint a;\n"), "succeed rewriting only the last copies.");
+
+	/* enough repeats to start a background compaction */
+	for (size_t i = 0; i < JOURNAL_COMPACT_MIN; i++)
+		append_journal(&jrn, (i & 1) ? "int a;" : "int b;", false, add_line);
+	maybe_compact_journal(&jrn, 2);
+	bool started = jrn.compacting;
+	poll_journal(&jrn, true);
+	read_file(file, buf, sizeof buf);
+	ok(started && jrn.lines == 2 && !strcmp(buf, "int b;\nint a;\n"), "succeed compacting in the background.");
+	loaded[0] = 0;
+	sync_journal(&jrn, add_line);
+	ok(!loaded[0], "succeed keeping the read offset across our own compaction.");
+	/* the next read can come before the compaction is reaped */
+	for (size_t i = 0; i < JOURNAL_COMPACT_MIN; i++)
+		append_journal(&jrn, (i & 1) ? "int a;" : "int b;", false, add_line);
+	maybe_compact_journal(&jrn, 2);
+	started = jrn.compacting;
+	loaded[0] = 0;
+	sync_journal(&jrn, add_line);
+	ok(started && !jrn.compacting && !loaded[0] && jrn.lines == 2,
+			"succeed reaping our own compaction before merging.");
+
+	/* a second instance sharing the journal */
+	load_journal(&other, file, add_line);
+	loaded[0] = 0;
+	append_journal(&other, "int x;", false, add_line);
+	sync_journal(&jrn, add_line);
+	ok(!strcmp(loaded, "int x; ") && jrn.lines == 3, "succeed merging only lines other instances appended.");
+	loaded[0] = 0;
+	append_journal(&jrn, "int y;", false, add_line);
+	append_journal(&other, "int z;", false, add_line);
+	sync_journal(&other, add_line);
+	read_file(file, buf, sizeof buf);
+	ok(!strcmp(loaded, "int y; ") && other.lines == 5 && !strcmp(buf, "int b;\nint a;\nint x;\nint y;\nint z;\n"),
+			"succeed merging before appending without re-reading our own lines.");
+	compact_journal(file, NULL, NULL);
+	loaded[0] = 0;
+	sync_journal(&jrn, add_line);
+	ok(!strcmp(loaded, "int b; int a; int x; int y; int z; ") && jrn.lines == 5,
+			"succeed starting over after another instance compacts.");
+	finish_journal(&other);
+	finish_journal(&jrn);
+
+	/* a hand-written journal missing its last newline */
+	write_file(file, "int p;");
+	loaded[0] = 0;
+	load_journal(&jrn, file, add_line);
+	append_journal(&jrn, "int q;", false, add_line);
+	read_file(file, buf, sizeof buf);
+	finish_journal(&jrn);
+
+	ok(!strcmp(loaded, "int p; ") && !strcmp(buf, "int p;\nint q;\n"), "succeed terminating the last line before appending.");
+
+	/* the status of the last run wins without splitting the line in two */
+	unlink(file);
+	load_journal(&jrn, file, add_line);
+	append_journal(&jrn, "int r;", true, add_line);
+	append_journal(&jrn, "int s;", true, add_line);
+	append_journal(&jrn, "int r;", false, add_line);
+	append_journal(&jrn, "int s;", false, add_line);
+	append_journal(&jrn, "int s;", true, add_line);
+	finish_journal(&jrn);
+	loaded[0] = 0;
+	load_journal(&jrn, file, add_line);
+	ok(jrn.lines == 5 && !strcmp(loaded, "int r; +int s; ") && compact_journal(file, NULL, NULL) == 2,
+			"succeed keeping the status of each line's last run.");
+	finish_journal(&jrn);
+	/* statuses are timestamp lines readline skips, not bytes in the lines */
+	read_file(file, buf, sizeof buf);
+	char *stamp = strchr(buf, '\n') + 1;
+	using_history();
+	history_comment_char = '#';
+	ok(!strncmp(buf, "int r;\n#", 8) && stamp[strspn(stamp + 1, "0123456789") + 1] == '\n' && !strchr(buf, '\006')
+			&& !read_history(file) && history_length == 2 && !strcmp(history_get(history_base + 1)->line, "int s;"),
+			"succeed keeping statuses readable by read_history().");
+	clear_history();
+
+	unlink(file);
+	rmdir(dir);
+
+	done_testing();
+}
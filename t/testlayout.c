@@ -0,0 +1,71 @@
+/*
+ * t/testlayout.c - unit-test for layout.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/layout.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* global string pool */
+struct str_pool str_pool;
+
+/* print a layout and check that `want` appears in it */
+static bool shows(struct dwarf_info const *info, ptrdiff_t type, char const *want)
+{
+	char *text;
+	size_t text_len;
+	FILE *out = open_memstream(&text, &text_len);
+
+	if (!out)
+		BAIL_OUT("open_memstream() failed");
+	print_layout(out, info, type, "t");
+	fclose(out);
+	bool ret = strstr(text, want);
+	if (!ret)
+		diag("got: %s", text);
+	free(text);
+	return ret;
+}
+
+int main(void)
+{
+	struct dwarf_info info = {0};
+
+	init_dwarf(&info);
+	/* char, int, double, char[60], struct {char c; double d; int i;}, packed struct {char pad[60]; int x;} */
+	struct dwarf_type types[] = {
+		{.kind = K_BASE, .enc = ATE_SIGNED_CHAR, .name = intern_str(&info.names, "char"), .size = 1, .base = -1},
+		{.kind = K_BASE, .enc = ATE_SIGNED, .name = intern_str(&info.names, "int"), .size = 4, .base = -1},
+		{.kind = K_BASE, .enc = ATE_FLOAT, .name = intern_str(&info.names, "double"), .size = 8, .base = -1},
+		{.kind = K_ARRAY, .cnt = 60, .base = 0},
+		{.kind = K_STRUCT, .size = 24, .base = -1, .memb_off = 0, .memb_cnt = 3},
+		{.kind = K_STRUCT, .size = 64, .base = -1, .memb_off = 3, .memb_cnt = 2},
+	};
+	struct dwarf_member membs[] = {
+		{.name = intern_str(&info.names, "c"), .off = 0, .type = 0},
+		{.name = intern_str(&info.names, "d"), .off = 8, .type = 2},
+		{.name = intern_str(&info.names, "i"), .off = 16, .type = 1},
+		{.name = intern_str(&info.names, "pad"), .off = 0, .type = 3},
+		{.name = intern_str(&info.names, "x"), .off = 62, .type = 1},
+	};
+	extend_dwarf_type_list(&info.types, types, ARR_LEN(types));
+	extend_dwarf_memb_list(&info.membs, membs, ARR_LEN(membs));
+
+	plan(6);
+
+	ok(layout_align(&info, 4) == 8 && layout_align(&info, 5) == 1, "succeed computing natural and packed alignment.");
+	ok(shows(&info, 4, "size 24, align 8, 11 padding bytes, 1 cache line"), "succeed summing holes and tail padding.");
+	ok(shows(&info, 4, "\t1\t7\t(hole)\n") && shows(&info, 4, "\t20\t4\t(tail padding)\n"), "succeed listing padding holes.");
+	ok(shows(&info, 4, "suggested order: d, i, c (size 16, saves 8 bytes)"), "succeed suggesting a tighter member order.");
+	ok(shows(&info, 5, "\t62\t4\tx\t(straddles cache lines 0-1)"), "succeed flagging members that straddle cache lines.");
+	ok(print_layout(stderr, &info, 1, "int") == -1, "fail printing the layout of a scalar.");
+
+	free_dwarf(&info);
+	free_pool(&str_pool);
+
+	done_testing();
+}
@@ -0,0 +1,54 @@
+/*
+ * t/testlex.c - unit-test for lex.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/defs.h"
+#include "../src/lex.h"
+
+/* whether the tokens of `str` have types `types` (ending with TOK_END) */
+static bool lexes_as(char const *str, enum tok_type const *types)
+{
+	size_t pos = 0, len = strlen(str);
+	for (size_t i = 0;; i++) {
+		struct token tok = lex_next(str, len, &pos);
+		if (tok.type != types[i])
+			return false;
+		if (tok.type == TOK_END)
+			return true;
+	}
+}
+
+int main(void)
+{
+	struct span_list spans;
+
+	plan(9);
+
+	ok(lexes_as("x->y >>= 1.5e+3;", (enum tok_type const[]){TOK_ID, TOK_PUNCT, TOK_ID, TOK_PUNCT, TOK_NUM, TOK_PUNCT, TOK_END}),
+		"succeed splitting identifiers, numbers and longest punctuators.");
+	ok(lexes_as("L'x' u8\"y\" /* z */ '\\''", (enum tok_type const[]){TOK_CHR, TOK_STR, TOK_CHR, TOK_END}),
+		"succeed keeping prefixes and escapes in literals and skipping comments.");
+	char const punct[] = "a <<= b";
+	size_t pos = 1;
+	struct token tok = lex_next(punct, sizeof punct - 1, &pos);
+	ok(lex_is(punct, tok, "<<=") && !lex_is(punct, tok, "<<") && pos == 5, "succeed matching a whole punctuator.");
+	pos = 0;
+	ok(lex_is_word(punct, lex_next(punct, sizeof punct - 1, &pos), "a"), "succeed matching a word.");
+	ok(lex_skip_literal("\"a\nb\"", 5, 0) == 2, "succeed ending an unterminated literal at the newline.");
+	ok(lex_code_end("int x = 5; // five", 18) == 10, "succeed finding code end before comment.");
+
+	strsplit(&spans, "int x = ';'; { y; }\n  ;char *s = \"a;b\"");
+	ok(spans.cnt == 3, "succeed splitting three statements.");
+	ok(!strncmp("char *s", "int x = ';'; { y; }\n  ;char *s = \"a;b\"" + spans.list[2].off, 7),
+		"succeed pointing span at third statement.");
+	free_span_list(&spans);
+	strsplit(&spans, "int x; /* a; b */ int y; // c; d");
+	ok(spans.cnt == 3, "succeed ignoring separators inside comments.");
+	free_span_list(&spans);
+
+	done_testing();
+}
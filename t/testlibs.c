@@ -0,0 +1,135 @@
+/*
+ * t/testlibs.c - unit-test for libs.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/libs.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* whether the NUL-separated `names` contain `name` */
+static bool has_name(struct char_list const *names, char const *name)
+{
+	for (size_t i = 0; i < names->cnt; i += strlen(names->list + i) + 1) {
+		if (!strcmp(names->list + i, name))
+			return true;
+	}
+	return false;
+}
+
+/* whether some resolved library path ends with `suffix` */
+static bool has_lib(struct str_list const *libs, char const *suffix)
+{
+	for (size_t i = 0; i < libs->cnt && libs->list[i]; i++) {
+		size_t len = strlen(libs->list[i]);
+		if (len >= strlen(suffix) && !strcmp(libs->list[i] + len - strlen(suffix), suffix))
+			return true;
+	}
+	return false;
+}
+
+static void write_file(char const *file, void const *buf, size_t len)
+{
+	FILE *out = fopen(file, "wb");
+	if (!out || fwrite(buf, 1, len, out) != len)
+		BAIL_OUT("writing %s failed", file);
+	fclose(out);
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/cepl_libsXXXXXX";
+	char lib[0x100], stripped[0x100], script[0x100], archive[0x100], cmd[0x200], flag[0x100];
+	char const src[] =
+		"int pub_obj = 1;\n"
+		"static int priv_fn(void) { return 2; }\n"
+		"__attribute__((visibility(\"hidden\"))) int hid_fn(void) { return 3; }\n"
+		"extern int undef_fn(void);\n"
+		"int pub_fn(void) { return priv_fn() + hid_fn() + undef_fn(); }\n";
+	struct char_list names;
+	struct str_list libs;
+	struct lib_map map;
+	FILE *cc;
+
+	if (!mkdtemp(dir))
+		BAIL_OUT("mkdtemp() failed");
+	snprintf(lib, sizeof lib, "%s/libpub.so.1", dir);
+	snprintf(stripped, sizeof stripped, "%s/libstripped.so", dir);
+	snprintf(script, sizeof script, "%s/libgroup.so", dir);
+	snprintf(archive, sizeof archive, "%s/libar.so", dir);
+	snprintf(flag, sizeof flag, "-L%s", dir);
+	char *ld_args[] = {flag, NULL};
+
+	/* build a shared library to inspect */
+	snprintf(cmd, sizeof cmd, "gcc -shared -fPIC -Wl,--hash-style=gnu -xc - -o %s", lib);
+	if (!(cc = popen(cmd, "w")))
+		BAIL_OUT("popen() failed");
+	fputs(src, cc);
+	if (pclose(cc))
+		BAIL_OUT("compiling test library failed");
+	/* the same library with its section headers dropped */
+	if (!map_lib(&map, lib))
+		BAIL_OUT("map_lib() failed");
+	unsigned char copy[map.len];
+	memcpy(copy, map.buf, map.len);
+	((ElfW(Ehdr) *)copy)->e_shoff = 0;
+	((ElfW(Ehdr) *)copy)->e_shnum = 0;
+	write_file(stripped, copy, map.len);
+	unmap_lib(&map);
+	snprintf(cmd, sizeof cmd, "/* GNU ld script */\nOUTPUT_FORMAT(elf64-x86-64)\nGROUP ( %s AS_NEEDED ( -lstripped ) )\n", lib);
+	write_file(script, cmd, strlen(cmd));
+	write_file(archive, "!<arch>\n", 8);
+
+	plan(8);
+
+	init_char_list(&names);
+	read_lib_syms(&names, lib);
+	ok(has_name(&names, "pub_fn") && has_name(&names, "pub_obj"), "succeed reading exported functions and objects.");
+	ok(!has_name(&names, "priv_fn") && !has_name(&names, "hid_fn") && !has_name(&names, "undef_fn"),
+			"succeed skipping local, hidden, and undefined symbols.");
+	free_char_list(&names);
+	init_char_list(&names);
+	read_lib_syms(&names, stripped);
+	ok(has_name(&names, "pub_fn") && has_name(&names, "pub_obj") && !has_name(&names, "undef_fn"),
+			"succeed counting symbols through .gnu.hash without section headers.");
+	free_char_list(&names);
+
+	char *group[] = {"-lgroup", NULL};
+	resolve_libs(&libs, group, ld_args);
+	ok(libs.cnt == 3 && has_lib(&libs, "/libpub.so.1") && has_lib(&libs, "/libstripped.so"),
+			"succeed following linker scripts and -L directories.");
+	free_str_list(&libs);
+	char *skipped[] = {"-lar", "-lcepl_no_such_lib", "-Wl,--as-needed", NULL};
+	resolve_libs(&libs, skipped, ld_args);
+	ok(libs.cnt == 1, "succeed skipping archives and missing libraries.");
+	free_str_list(&libs);
+	char *exact[] = {"-l:libpub.so.1", lib, NULL};
+	resolve_libs(&libs, exact, ld_args);
+	ok(libs.cnt == 2 && has_lib(&libs, "/libpub.so.1"), "succeed resolving -l:file names without duplicates.");
+	free_str_list(&libs);
+
+	/* glibc ships `libc.so` as a linker script and `libc.so.6` in `ld.so.cache` */
+	char *libc[] = {"-lc", NULL};
+	resolve_libs(&libs, libc, NULL);
+	skip(access(LD_CACHE_FILE, R_OK) && !libs.list[0], 1, "no libc to resolve");
+	ok(has_lib(&libs, "/libc.so.6"), "succeed resolving libc through its script or ld.so.cache.");
+	end_skip;
+	free_str_list(&libs);
+	init_str_list(&libs);
+	find_ld_cache(&libs, "libc.so");
+	skip(access(LD_CACHE_FILE, R_OK), 1, "no " LD_CACHE_FILE);
+	ok(has_lib(&libs, "/libc.so.6") && !has_lib(&libs, "/libcrypt.so.1"), "succeed looking up sonames in ld.so.cache.");
+	end_skip;
+	free_str_list(&libs);
+
+	unlink(lib);
+	unlink(stripped);
+	unlink(script);
+	unlink(archive);
+	rmdir(dir);
+
+	done_testing();
+}
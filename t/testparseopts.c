@@ -7,6 +7,7 @@
 
 #include "tap.h"
 #include "../src/parseopts.h"
+#include "../src/readline.h"
 
 /* silence linter */
 int mkstemp(char *__template);
@@ -14,7 +15,17 @@ int mkstemp(char *__template);
 /* global completion list */
 char *comp_arg_list[1];
 /* global linker flags and completions structs */
-struct str_list comp_list;
+struct id_list comp_list;
+/* global background library symbol loader */
+struct sym_load sym_load;
+/* global index of the prologue headers */
+struct hdr_index hdr_index;
+/* global completions defined by the session */
+struct sess_comps sess_comps;
+/* global history deduplication index */
+struct hist_index hist_index;
+/* global string pool */
+struct str_pool str_pool;
 /* source file includes template */
 char const *prologue =
 	"#undef _BSD_SOURCE\n"
@@ -134,7 +145,8 @@ int main (void)
 	int argc = sizeof argv / sizeof argv[0] - 1;
 	/* print argument strings */
 	result = parse_opts(&prg, argc, argv, optstring);
-	init_str_list(&prg.sym_list, "cepl");
+	init_id_list(&prg.sym_list);
+	push_id_list(&prg.sym_list, intern_str(&str_pool, "cepl"));
 	printf("%s\n%s", "# generated compiler string: ", "# ");
 	for (int i = 0; result[i]; i++)
 		printf("%s ", result[i]);
@@ -148,12 +160,12 @@ int main (void)
 	like(result[0], "^(gcc|clang)$", "test generation of compiler string.");
 	lives_ok({read_syms(&prg.sym_list, NULL);}, "test passing read_syms() empty filename.");
 	lives_ok({parse_libs(&prg.sym_list, libs);}, "test shared library parsing.");
-	ok((ret = free_str_list(&prg.sym_list)) != -1, "test free_str_list() doesn't return -1.");
-	ok(ret == 1, "test free_str_list() return is exactly 1.");
-	ok(free_str_list(&prg.sym_list) == -1, "test free_str_list() on empty pointer returns -1.");
+	ok((ret = free_id_list(&prg.sym_list)) != -1, "test free_id_list() doesn't return -1.");
+	ok(ret == 1, "test free_id_list() return is exactly 1.");
+	ok(free_id_list(&prg.sym_list) == -1, "test free_id_list() on empty pointer returns -1.");
 
 	/* cleanup */
-	free_argv(&result);
+	free_str_list(&prg.cc_list);
 	close(tmp_fd[0]);
 	close(tmp_fd[1]);
 	if (remove(out_tmp) == -1)
@@ -162,6 +174,7 @@ int main (void)
 		WARN("%s", "remove() asm_tmp");
 	free(out_filename);
 	free(asm_filename);
+	free_pool(&str_pool);
 
 	done_testing();
 }
@@ -9,12 +9,58 @@
 #include "../src/errs.h"
 #include "../src/readline.h"
 
+extern struct id_list comp_list;
+
+/* collect every completion `generator()` returns for `text` into `buf` */
+static size_t complete(char const *text, char *buf, size_t len)
+{
+	size_t cnt = 0;
+	buf[0] = 0;
+	for (char *match; (match = generator(text, cnt)); cnt++) {
+		if (cnt)
+			strncat(buf, " ", len - strlen(buf) - 1);
+		strncat(buf, match, len - strlen(buf) - 1);
+		free(match);
+	}
+	return cnt;
+}
+
 int main (void)
 {
 	FILE *bitbucket;
-	char *ln;
+	char *ln, buf[0x100];
+	char const *syms[] = {"strlen", "printf", "strcat", "puts", "strlen", "str", "strtok", "printf", "sprintf"};
+
+	plan(7);
+
+	ok(complete(";la", buf, sizeof buf) == 1 && !strcmp(buf, ";layout"), "succeed completing from the default list.");
+	for (size_t i = 0; i < ARR_LEN(syms); i++)
+		push_id_list(&comp_list, intern_str(&str_pool, syms[i]));
+	index_comps(&comp_list);
+	ok(comp_list.cnt == 7, "succeed deduplicating completions.");
+	ok(complete("str", buf, sizeof buf) == 4 && !strcmp(buf, "str strcat strlen strtok"),
+			"succeed completing a prefix range in sorted order.");
+	ok(complete("zz", buf, sizeof buf) == 0 && complete("", buf, sizeof buf) == 7,
+			"succeed completing empty and missing prefixes.");
 
-	plan(1);
+	/* session names come and go with the lines that define them */
+	struct sess_comps sess = {0};
+	struct var_list vars = {0};
+	push_var_list(&vars, (struct var_entry){.id = intern_str(&str_pool, "strval"), .line = 1});
+	add_var_comps(&sess, &comp_list, &vars);
+	add_sess_comp(&sess, &comp_list, intern_str(&str_pool, "strlen"), 2);
+	add_sess_comp(&sess, &comp_list, intern_str(&str_pool, "stra"), 2);
+	ok(complete("str", buf, sizeof buf) == 6 && !strcmp(buf, "str stra strcat strlen strtok strval"),
+			"succeed inserting session names in sorted order.");
+	pop_sess_comps(&sess, &comp_list, 1, vars.cnt);
+	bool kept = complete("str", buf, sizeof buf) == 5 && !strcmp(buf, "str strcat strlen strtok strval");
+	pop_sess_comps(&sess, &comp_list, 0, 0);
+	ok(kept && complete("str", buf, sizeof buf) == 4 && !sess.names.cnt && !sess.var_cnt,
+			"succeed removing only the names undone lines added.");
+	free_sess_comps(&sess);
+	free_var_list(&vars);
+	free_id_list(&comp_list);
+	free_pool(&str_pool);
 
 	if (!(bitbucket = fopen("/dev/null", "r+b")))
 		WARN("%s", "read_line() fopen()");
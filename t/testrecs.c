@@ -0,0 +1,86 @@
+/*
+ * t/testrecs.c - unit-test for the value records decoded by vars.c
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/vars.h"
+
+/* global string pool */
+struct str_pool str_pool;
+
+/* append a record the way the printers write it */
+static void push_rec(struct char_list *stream, uint32_t idx, uint32_t type, void const *data, uint64_t len)
+{
+	struct val_rec rec = {.idx = idx, .type = type, .len = len};
+	extend_char_list(stream, (char const *)&rec, sizeof rec);
+	if (len != VAL_NULL)
+		extend_char_list(stream, data, len);
+}
+
+/* decode `stream` into a string, returning the record count from `show_recs()` */
+static int decode(struct program const *prog, struct char_list const *stream, char **out)
+{
+	size_t out_len = 0;
+	FILE *out_file = open_memstream(out, &out_len);
+	if (!out_file)
+		BAIL_OUT("open_memstream() failed");
+	int cnt = show_recs(prog, out_file, stream->list, stream->cnt);
+	fclose(out_file);
+	return cnt;
+}
+
+int main(void)
+{
+	struct program recs = {0};
+	struct char_list stream;
+	long long neg = -42;
+	char const hello[] = "hello";
+	int32_t lanes[] = {-1, 2};
+	char vec[2 + sizeof lanes] = {'i', sizeof *lanes}, *out = NULL;
+	char const *const names[] = {"n", "s", "np", "t", "v"};
+	enum var_type const types[] = {T_INT, T_STR, T_STR, T_OTHER, T_VEC};
+
+	plan(6);
+
+	unsetenv("TERM");
+	for (size_t i = 0; i < ARR_LEN(names); i++)
+		push_var_list(&recs.var_list, (struct var_entry){.id = intern_str(&str_pool, names[i]), .shadow = -1, .type_spec = types[i]});
+	init_char_list(&stream);
+	push_rec(&stream, 0, T_INT, &neg, sizeof neg);
+	push_rec(&stream, 1, T_STR, hello, sizeof hello - 1);
+	push_rec(&stream, 2, T_STR, NULL, VAL_NULL);
+	ok(decode(&recs, &stream, &out) == 3, "succeed decoding three value records.");
+	ok(out && !strcmp(out, "n = \"-42\", s = \"hello\", np = \"(null)\"\n"), "succeed formatting decoded values.");
+	free(out);
+
+	/* aggregates arrive already formatted */
+	truncate_char_list(&stream, 0);
+	push_rec(&stream, 3, REC_TEXT, "{.a = 1}", 8);
+	ok(decode(&recs, &stream, &out) == 1 && !strcmp(out, "t = \"{.a = 1}\"\n"), "succeed printing preformatted text.");
+	free(out);
+
+	/* vectors carry their lane kind and size */
+	truncate_char_list(&stream, 0);
+	memcpy(vec + 2, lanes, sizeof lanes);
+	push_rec(&stream, 4, T_VEC, vec, sizeof vec);
+	ok(decode(&recs, &stream, &out) == 1 && !strcmp(out, "v = \"i32 {-1, 2}\"\n"), "succeed formatting vector lanes.");
+	free(out);
+
+	/* damaged streams are rejected instead of read past */
+	stream.cnt -= 4;
+	ok(decode(&recs, &stream, &out) == -1, "fail decoding a truncated record.");
+	free(out);
+	truncate_char_list(&stream, 0);
+	push_rec(&stream, ARR_LEN(names), T_INT, &neg, sizeof neg);
+	ok(decode(&recs, &stream, &out) == -1, "fail decoding a record for an unknown variable.");
+	free(out);
+
+	free_char_list(&stream);
+	free_var_list(&recs.var_list);
+	free_pool(&str_pool);
+
+	done_testing();
+}
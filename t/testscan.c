@@ -0,0 +1,49 @@
+/*
+ * t/testscan.c - unit-test for scan.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/scan.h"
+#include <stdlib.h>
+
+/* check a kernel against strcspn() at every start offset of `buf` */
+static bool agrees(scan_fn *kernel, char const *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (kernel(buf + i, len - i) != strcspn(buf + i, SCAN_SPLIT_SET))
+			return false;
+	}
+	return true;
+}
+
+int main(void)
+{
+	char buf[0x200];
+	size_t const len = sizeof buf - 1;
+
+	/* mostly filler with a sparse sprinkling of splitter bytes */
+	srand(0xcee1);
+	for (size_t i = 0; i < len; i++)
+		buf[i] = (rand() % 23) ? "abcd =+*()[]<>,.01 \t"[rand() % 20] : SCAN_SPLIT_SET[rand() % (sizeof SCAN_SPLIT_SET - 1)];
+	buf[len] = 0;
+
+	plan(6);
+
+	ok(scan_split_scalar("int x = 5", 9) == 9, "succeed returning length when nothing matches.");
+	ok(scan_split_scalar("int x = '5'", 11) == 8, "succeed stopping at quote.");
+	ok(agrees(scan_split_scalar, buf, len), "succeed agreeing with strcspn() (scalar).");
+	ok(agrees(scan_split, buf, len), "succeed agreeing with strcspn() (dispatch).");
+#if defined(SCAN_SIMD)
+	ok(agrees(scan_split_sse2, buf, len), "succeed agreeing with strcspn() (sse2).");
+	skip(!__builtin_cpu_supports("avx2"), 1, "avx2 not supported");
+	ok(agrees(scan_split_avx2, buf, len), "succeed agreeing with strcspn() (avx2).");
+	end_skip;
+#else
+	tap_skip(2, "no vector kernels on this target");
+#endif
+
+	done_testing();
+}
@@ -0,0 +1,84 @@
+/*
+ * t/testsearch.c - unit-test for search.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/search.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* whether searching for `query` finds exactly `want`, space-separated and newest first */
+static bool finds(struct hist_search *search, char const *query, bool ok_only, char const *want)
+{
+	struct search_line_list found;
+	char got[0x200] = {0};
+	search_hist(search, query, ok_only, SEARCH_SHOWN, &found);
+	for (size_t i = 0; i < found.cnt; i++) {
+		if (i)
+			strcat(got, " ");
+		strncat(got, pool_str(&search->text, found.list[i].id), sizeof got - strlen(got) - 2);
+	}
+	free_search_line_list(&found);
+	if (strcmp(got, want))
+		diag("%s: \"%s\"", query, got);
+	return !strcmp(got, want);
+}
+
+int main(void)
+{
+	struct hist_search search = {0};
+	char line[0x40];
+
+	plan(9);
+
+	add_search_line(&search, "int abc;");
+	add_search_line(&search, "puts(abc);");
+	size_t twice = add_search_line(&search, "aaaaaa;");
+	add_search_line(&search, "xabcx;");
+	post_search_lines(&search);
+	ok(search.lines.cnt == 4 && search.tris.list[find_id(&search.tri_map, search_tri("aaa"))].cnt == 1,
+			"succeed posting a repeated trigram once per line.");
+	ok(finds(&search, "abc", false, "xabcx; puts(abc); int abc;"), "succeed finding substrings newest first.");
+	ok(add_search_line(&search, "int abc;") == 0 && search.lines.cnt == 4 && search.pending.cnt == 1
+			&& finds(&search, "abc", false, "int abc; xabcx; puts(abc);") && !search.pending.cnt,
+			"succeed moving re-entered lines to the front once.");
+	ok(finds(&search, "c;", false, "int abc;") && finds(&search, "(abc)", false, "puts(abc);"),
+			"succeed searching with queries shorter and longer than a trigram.");
+	ok(finds(&search, "abd", false, "") && finds(&search, "bcx;z", false, ""), "succeed ruling out missing trigrams.");
+	search.lines.list[twice].ok = true;
+	search.lines.list[0].ok = true;
+	ok(finds(&search, "a", true, "int abc; aaaaaa;"), "succeed keeping only lines that ran successfully.");
+	free_hist_search(&search);
+
+	/* lines are posted on the first search, which only checks the chain of the rarest trigram */
+	for (size_t i = 0; i < 10000; i++) {
+		snprintf(line, sizeof line, "printf(\"%%d\\n\", v%zu);", i);
+		add_search_line(&search, line);
+	}
+	ok(!search.posts.cnt && finds(&search, "v9999)", false, "printf(\"%d\\n\", v9999);")
+			&& search.tris.list[find_id(&search.tri_map, search_tri("999"))].cnt == 19,
+			"succeed narrowing many lines to the rarest trigram.");
+	free_hist_search(&search);
+
+	/* lines entered again over and over leave stale postings behind */
+	for (size_t round = 0; round < 0x100; round++) {
+		for (size_t i = 0; i < 64; i += round ? 2 : 1) {
+			snprintf(line, sizeof line, "int w%zu = %zu;", i, i);
+			add_search_line(&search, line);
+		}
+		post_search_lines(&search);
+	}
+	ok(search.tris.list[find_id(&search.tri_map, search_tri("int"))].cnt == 64
+			&& search.tris.list[find_id(&search.tri_map, search_tri("w10"))].cnt == 1,
+			"succeed counting only live postings.");
+	ok(search.posts.cnt < 2 * SEARCH_COMPACT_MIN && search.stale < search.posts.cnt
+			&& finds(&search, "w10 ", false, "int w10 = 10;")
+			&& finds(&search, "= 6", false, "int w62 = 62; int w60 = 60; int w6 = 6; int w63 = 63; int w61 = 61;"),
+			"succeed reclaiming stale postings without losing lines.");
+	free_hist_search(&search);
+
+	done_testing();
+}
@@ -0,0 +1,112 @@
+/*
+ * t/testsymcache.c - unit-test for symcache.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/symcache.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* global string pool */
+struct str_pool str_pool;
+
+static size_t reads;
+
+/* stand-in for `read_syms()` treating each line of a file as a symbol */
+static void read_lines(struct char_list *restrict names, char const *restrict lib)
+{
+	char buf[0x100];
+	FILE *file = fopen(lib, "r");
+	reads++;
+	if (!file)
+		return;
+	while (fgets(buf, sizeof buf, file)) {
+		buf[strcspn(buf, "\n")] = 0;
+		extend_char_list(names, buf, strlen(buf) + 1);
+	}
+	fclose(file);
+}
+
+static void write_lib(char const *lib, char const *text)
+{
+	FILE *file = fopen(lib, "w");
+	if (!file)
+		BAIL_OUT("fopen() failed");
+	fputs(text, file);
+	fclose(file);
+}
+
+/* load `libs` through the cache and check the joined symbols and read count */
+static bool loads(char const *cache, char **libs, size_t want_reads, char const *want)
+{
+	struct id_list syms = {0};
+	char buf[0x100] = {0};
+	init_id_list(&syms);
+	reads = 0;
+	cache_syms(&syms, libs, cache, read_lines);
+	for (size_t i = 0; i < syms.cnt; i++) {
+		strncat(buf, pool_str(&str_pool, syms.list[i]), sizeof buf - strlen(buf) - 2);
+		strcat(buf, " ");
+	}
+	free_id_list(&syms);
+	bool ret = reads == want_reads && !strcmp(buf, want);
+	if (!ret)
+		diag("got %zu reads: \"%s\"", reads, buf);
+	return ret;
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/cepl_symcacheXXXXXX";
+	char cache[sizeof dir + 0x10], lib_a[sizeof dir + 0x10], lib_b[sizeof dir + 0x10], lib_c[sizeof dir + 0x10];
+
+	if (!mkdtemp(dir))
+		BAIL_OUT("mkdtemp() failed");
+	snprintf(cache, sizeof cache, "%s/cache", dir);
+	snprintf(lib_a, sizeof lib_a, "%s/liba.so", dir);
+	snprintf(lib_b, sizeof lib_b, "%s/libb.so", dir);
+	snprintf(lib_c, sizeof lib_c, "%s/libc.so", dir);
+	write_lib(lib_a, "foo\nbar\n");
+	write_lib(lib_b, "baz\n");
+	write_lib(lib_c, "quux\n");
+	char *ab[] = {lib_a, lib_b, NULL}, *a[] = {lib_a, NULL}, *bc[] = {lib_b, lib_c, NULL};
+
+	plan(8);
+
+	ok(loads(cache, ab, 2, "foo bar baz "), "succeed reading uncached libraries.");
+	ok(loads(cache, ab, 0, "foo bar baz "), "succeed loading unchanged libraries from the cache.");
+	write_lib(lib_b, "baz\nblip\n");
+	ok(loads(cache, ab, 1, "foo bar baz blip "), "succeed re-reading only a changed library.");
+	ok(loads(cache, bc, 1, "baz blip quux ") && loads(cache, a, 0, "foo bar "),
+			"succeed keeping entries for libraries outside the current set.");
+	if (truncate(cache, 12))
+		BAIL_OUT("truncate() failed");
+	ok(loads(cache, ab, 2, "foo bar baz blip ") && loads(cache, ab, 0, "foo bar baz blip "),
+			"succeed rebuilding a truncated cache.");
+	unlink(lib_c);
+	ok(loads(cache, bc, 1, "baz blip "), "succeed skipping missing libraries.");
+
+	/* background load polled until every library is merged */
+	struct sym_load load;
+	struct id_list syms = {0};
+	char *many[] = {lib_a, lib_b, lib_a, lib_b, lib_a, lib_b, NULL};
+	init_id_list(&syms);
+	start_sym_load(&load, many, cache, read_lines, SYM_LOAD_THREADS);
+	while (load.merged < load.cnt)
+		poll_sym_load(&load, &syms);
+	ok(syms.cnt == 12 && !load.map && !load.thread_cnt, "succeed merging libraries loaded by worker threads.");
+	ok(same_sym_load(&load, many) && !same_sym_load(&load, ab), "succeed matching a finished load to its library set.");
+	stop_sym_load(&load);
+	free_id_list(&syms);
+
+	unlink(lib_a);
+	unlink(lib_b);
+	unlink(cache);
+	rmdir(dir);
+	free_pool(&str_pool);
+
+	done_testing();
+}
@@ -0,0 +1,129 @@
+/*
+ * t/testtimeit.c - unit-test for timeit.h
+ *
+ * AUTHOR: Joey Pabalinas <joeypabalinas@gmail.com>
+ * See LICENSE.md file for copyright and license details.
+ */
+
+#include "tap.h"
+#include "../src/timeit.h"
+#include <linux/memfd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+
+/* the test's session: a few locals ahead of the timing block */
+static void build_session(struct char_list *src, char const *stmt, bool expr, char const *const *opaque, int fd)
+{
+	append_fmt(src, "%s", "#define _GNU_SOURCE\n#include <math.h>\n#include <stdint.h>\n#include <stdio.h>\n#include <string.h>\n"
+			"#include <time.h>\n#include <unistd.h>\nint main(void)\n{\n\tchar buf[64] = \"hello\";\n\tdouble d = 2.0;");
+	build_timeit(src, stmt, expr, opaque, fd);
+	append_fmt(src, "%s", "\n\treturn 0;\n}\n");
+}
+
+/* build and run a timing block for `stmt`, reading back its samples */
+static int run_timeit(char const *stmt, bool expr, struct timeit_stats *stats)
+{
+	char elf_file[] = "/tmp/cepl_timeitXXXXXX", cmd[0x80];
+	struct char_list src = {0};
+	int elf_fd, rec_fd, ret = -1;
+	FILE *cc;
+
+	if ((rec_fd = syscall(SYS_memfd_create, "cepl_bench", 0)) == -1)
+		BAIL_OUT("memfd_create() failed");
+	build_session(&src, stmt, expr, NULL, rec_fd);
+	if ((elf_fd = mkstemp(elf_file)) == -1)
+		BAIL_OUT("mkstemp() failed");
+	close(elf_fd);
+	snprintf(cmd, sizeof cmd, "gcc -O2 -std=c11 -xc - -o %s -lm 2>/dev/null", elf_file);
+	if (!(cc = popen(cmd, "w")))
+		BAIL_OUT("popen() failed");
+	fputs(src.list, cc);
+	/* the executable inherits `rec_fd` */
+	if (!pclose(cc) && !system(elf_file))
+		ret = read_timeit(rec_fd, stats);
+	unlink(elf_file);
+	free_char_list(&src);
+	close(rec_fd);
+	return ret;
+}
+
+/* whether the optimized assembly of a timing block for `stmt` still mentions `insn` */
+static bool keeps_insn(char const *stmt, char const *const *opaque, char const *insn)
+{
+	char asm_file[] = "/tmp/cepl_timeitXXXXXX", cmd[0x80], text[0x10000];
+	struct char_list src = {0};
+	int asm_fd;
+	FILE *cc;
+	ssize_t len;
+
+	build_session(&src, stmt, true, opaque, 9);
+	if ((asm_fd = mkstemp(asm_file)) == -1)
+		BAIL_OUT("mkstemp() failed");
+	snprintf(cmd, sizeof cmd, "gcc -O2 -std=c11 -S -xc - -o %s 2>/dev/null", asm_file);
+	if (!(cc = popen(cmd, "w")))
+		BAIL_OUT("popen() failed");
+	fputs(src.list, cc);
+	len = pclose(cc) ? -1 : read(asm_fd, text, sizeof text - 1);
+	text[(len > 0) ? len : 0] = 0;
+	close(asm_fd);
+	unlink(asm_file);
+	free_char_list(&src);
+	return strstr(text, insn);
+}
+
+static bool near(double got, double want)
+{
+	return fabs(got - want) < 1e-9;
+}
+
+int main(void)
+{
+	struct timeit_stats stats;
+	struct char_list src = {0};
+	double ns[100];
+	char *text;
+	size_t text_len;
+
+	plan(7);
+
+	/* 100 .. 1 so sorting is needed */
+	for (size_t i = 0; i < ARR_LEN(ns); i++)
+		ns[i] = ARR_LEN(ns) - i;
+	timeit_stats(&stats, ns, ARR_LEN(ns));
+	ok(near(stats.mean, 50.5) && near(stats.min, 1) && near(stats.median, 50.5) && near(stats.p99, 99)
+			&& stats.stddev > 29.01 && stats.stddev < 29.02, "succeed summarizing samples.");
+	ns[0] = 7;
+	timeit_stats(&stats, ns, 1);
+	ok(near(stats.mean, 7) && near(stats.stddev, 0) && near(stats.median, 7) && near(stats.p99, 7),
+			"succeed summarizing a single sample.");
+
+	FILE *out = open_memstream(&text, &text_len);
+	if (!out)
+		BAIL_OUT("open_memstream() failed");
+	stats = (struct timeit_stats){.mean = 12.5, .stddev = 0.25, .min = 999, .median = 1500, .p99 = 2.5e6, .cnt = 100, .iters = 64};
+	print_timeit(out, "f(x)", &stats);
+	fclose(out);
+	char const want[] = "f(x): 12.50 ns/op +/- 0.25 ns (min 999.00 ns, median 1.50 us, p99 2.50 ms) [100 x 64 iterations]\n";
+	if (strcmp(text, want))
+		diag("got: %s", text);
+	ok(!strcmp(text, want), "succeed scaling each time to its unit.");
+	free(text);
+
+	build_timeit(&src, "strlen(buf) ;", true, (char const *[]){"buf", NULL}, 9);
+	ok(strstr(src.list, "__typeof__(strlen(buf)) cepl_val_ = (strlen(buf));") && strstr(src.list, "write(9,")
+			&& strstr(src.list, "\"r\"(&(buf))"), "succeed keeping the value of an expression and hiding its operands.");
+	free_char_list(&src);
+	/* `sqrt(2.0) * 2.0` is a constant unless `d` is hidden */
+	ok(!keeps_insn("sqrt(d) * d", NULL, "sqrt") && keeps_insn("sqrt(d) * d", (char const *[]){"d", NULL}, "sqrt"),
+			"succeed keeping work on session variables from being folded.");
+
+	ok(!run_timeit("strlen(buf)", true, &stats) && stats.cnt >= TIMEIT_MIN_SAMPLES && stats.iters > 1
+			&& stats.min > 0 && stats.min <= stats.median && stats.median <= stats.p99,
+			"succeed timing an expression in a calibrated loop.");
+	ok(!run_timeit("memset(buf, 1, sizeof buf)", false, &stats) && stats.cnt >= TIMEIT_MIN_SAMPLES
+			&& stats.iters * stats.mean >= TIMEIT_BATCH_NS * 0.5,
+			"succeed timing a statement in batches outlasting the clock.");
+
+	done_testing();
+}
@@ -8,8 +8,8 @@
 #include "tap.h"
 #include "../src/vars.h"
 
-/* global linker arguments struct */
-struct str_list ld_list = {0};
+/* global string pool */
+struct str_pool str_pool;
 
 /* compiler pre-program */
 char const *prog_start =
@@ -25,6 +25,66 @@ char const *prog_end =
 		"\n\treturn 0;\n"
 	"}\n";
 
+/* send stderr to a temporary file until `end_capture()`, returning the saved stderr */
+static int begin_capture(FILE **file)
+{
+	if (!(*file = tmpfile()))
+		BAIL_OUT("tmpfile() failed");
+	fflush(stderr);
+	int saved = dup(STDERR_FILENO);
+	dup2(fileno(*file), STDERR_FILENO);
+	return saved;
+}
+
+/* restore stderr and check that the captured text is `want` */
+static bool end_capture(FILE *file, int saved, char const *want)
+{
+	char got[0x100] = {0};
+	fflush(stderr);
+	dup2(saved, STDERR_FILENO);
+	close(saved);
+	rewind(file);
+	if (!fgets(got, sizeof got, file))
+		got[0] = 0;
+	fclose(file);
+	if (strcmp(got, want))
+		diag("got: %s", got);
+	return !strcmp(got, want);
+}
+
+/* restore stderr and check that the captured text contains `want` */
+static bool end_capture_has(FILE *file, int saved, char const *want)
+{
+	char got[0x400] = {0};
+	fflush(stderr);
+	dup2(saved, STDERR_FILENO);
+	close(saved);
+	rewind(file);
+	got[fread(got, 1, sizeof got - 1, file)] = 0;
+	fclose(file);
+	if (!strstr(got, want))
+		diag("got: %s", got);
+	return !!strstr(got, want);
+}
+
+/* build `src` with debug info into a fresh file named by `elf_file`, returning it opened */
+static int build_traced(char *elf_file, char const *src)
+{
+	char cmd[0x80];
+	int elf_fd;
+	FILE *cc;
+	if ((elf_fd = mkstemp(elf_file)) == -1)
+		BAIL_OUT("mkstemp() failed");
+	close(elf_fd);
+	snprintf(cmd, sizeof cmd, "gcc -g -O0 -std=c11 -xc - -o %s", elf_file);
+	if (!(cc = popen(cmd, "w")))
+		BAIL_OUT("popen() failed");
+	fputs(src, cc);
+	if (pclose(cc) || (elf_fd = open(elf_file, O_RDONLY)) == -1)
+		BAIL_OUT("building traced program failed");
+	return elf_fd;
+}
+
 int main(void)
 {
 	struct program prg = {0};
@@ -40,37 +100,208 @@ int main(void)
 		"int plonk[5] = {1,2,3,4,5}, vroom[5] = {0};"
 		"struct foo { int boop; } kabonk = {0}, *klakow = &kabonk;";
 
-	plan(20);
+	size_t const len = sizeof src - 1;
+
+	plan(40);
 
 	/* initialize lists */
-	init_str_list(&prg.id_list, NULL);
+	init_id_list(&prg.id_list);
 	init_type_list(&prg.type_list);
 
-	printf("%d", find_vars(&prg, src));
-	ok(find_vars(&prg, src) == 19, "succeed finding nineteen objects.");
-	ok(extract_type(src, "a") == T_UINT, "succeed extracting unsigned type from `a`.");
-	ok(extract_type(src, "b") == T_PTR, "succeed extracting pointer type from `b`.");
-	ok(extract_type(src, "c") == T_INT, "succeed extracting signed type from `c`.");
-	ok(extract_type(src, "d") == T_INT, "succeed extracting signed type from `d`.");
-	ok(extract_type(src, "e") == T_PTR, "succeed extracting pointer type from `e`.");
-	ok(extract_type(src, "f") == T_PTR, "succeed extracting pointer type from `f`.");
-	ok(extract_type(src, "wark") == T_STR, "succeed extracting string type from `wark`.");
-	ok(extract_type(src, "ptr") == T_STR, "succeed extracting string type from `ptr`.");
-	ok(extract_type(src, "foo") == T_INT, "succeed extracting signed type from `foo`.");
-	ok(extract_type(src, "bar") == T_INT, "succeed extracting signed type from `bar`.");
-	ok(extract_type(src, "baz") == T_INT, "succeed extracting signed type from `baz`.");
-	ok(extract_type(src, "quix") == T_PTR, "succeed extracting pointer type from `quix`.");
-	ok(extract_type(src, "res") == T_FLT, "succeed extracting floating type from `res`.");
-	ok(extract_type(src, "boop") == T_INT, "succeed extracting signed type from `boop`.");
-	ok(extract_type(src, "florp") == T_UINT, "succeed extracting unsigned type from `florp`.");
-	ok(extract_type(src, "plonk") == T_PTR, "succeed extracting pointer type from `plonk`.");
-	ok(extract_type(src, "vroom") == T_PTR, "succeed extracting pointer type from `vroom`.");
-	ok(extract_type(src, "kabonk") == T_OTHER, "succeed extracting other type from `kabonk`.");
-	ok(extract_type(src, "klakow") == T_OTHER, "succeed extracting other type from `klakow`.");
+	printf("%d", find_vars(&prg, src, len));
+	ok(find_vars(&prg, src, len) == 19, "succeed finding nineteen objects.");
+	ok(extract_type(src, len, "a") == T_UINT, "succeed extracting unsigned type from `a`.");
+	ok(extract_type(src, len, "b") == T_PTR, "succeed extracting pointer type from `b`.");
+	ok(extract_type(src, len, "c") == T_INT, "succeed extracting signed type from `c`.");
+	ok(extract_type(src, len, "d") == T_INT, "succeed extracting signed type from `d`.");
+	ok(extract_type(src, len, "e") == T_PTR, "succeed extracting pointer type from `e`.");
+	ok(extract_type(src, len, "f") == T_PTR, "succeed extracting pointer type from `f`.");
+	ok(extract_type(src, len, "wark") == T_STR, "succeed extracting string type from `wark`.");
+	ok(extract_type(src, len, "ptr") == T_STR, "succeed extracting string type from `ptr`.");
+	ok(extract_type(src, len, "foo") == T_INT, "succeed extracting signed type from `foo`.");
+	ok(extract_type(src, len, "bar") == T_INT, "succeed extracting signed type from `bar`.");
+	ok(extract_type(src, len, "baz") == T_INT, "succeed extracting signed type from `baz`.");
+	ok(extract_type(src, len, "quix") == T_PTR, "succeed extracting pointer type from `quix`.");
+	ok(extract_type(src, len, "res") == T_FLT, "succeed extracting floating type from `res`.");
+	ok(extract_type(src, len, "boop") == T_INT, "succeed extracting signed type from `boop`.");
+	ok(extract_type(src, len, "florp") == T_UINT, "succeed extracting unsigned type from `florp`.");
+	ok(extract_type(src, len, "plonk") == T_PTR, "succeed extracting pointer type from `plonk`.");
+	ok(extract_type(src, len, "vroom") == T_PTR, "succeed extracting pointer type from `vroom`.");
+	ok(extract_type(src, len, "kabonk") == T_OTHER, "succeed extracting other type from `kabonk`.");
+	ok(extract_type(src, len, "klakow") == T_PTR, "succeed extracting pointer type from `klakow`.");
+
+	/* duplicates are skipped without dropping the identifiers after them */
+	char const dup_decl[] = "long foo = 2, zorp = 3";
+	gen_var_list(&prg);
+	find_vars(&prg, dup_decl, sizeof dup_decl - 1);
+	gen_var_list(&prg);
+	ok(prg.var_list.cnt == 20, "succeed skipping duplicate `foo` but keeping `zorp`.");
+	/* a new type shadows the earlier declaration */
+	char const shadow[] = "double foo = 1.5";
+	size_t foo = find_len(&str_pool, "foo", 3);
+	ptrdiff_t old_foo = find_id(&prg.var_map, foo);
+	find_vars(&prg, shadow, sizeof shadow - 1);
+	gen_var_list(&prg);
+	ok(find_id(&prg.var_map, foo) == 20, "succeed shadowing `foo` with new entry.");
+	ok(prg.var_list.list[20].shadow == old_foo, "succeed linking shadowed `foo` entry.");
+
+	/* undoing a line only drops what it declared */
+	char const redecl[] = "char *zorp = 0; int fresh = 1";
+	size_t zorp = find_len(&str_pool, "zorp", 4);
+	push_flag_list(&prg.src[0].flags, IN_MAIN);
+	find_vars(&prg, redecl, sizeof redecl - 1);
+	gen_var_list(&prg);
+	ok(prg.var_list.cnt == 23 && find_id(&prg.var_map, zorp) == 21, "succeed shadowing `zorp` on a new line.");
+	pop_vars(&prg, --prg.src[0].flags.cnt);
+	ok(prg.var_list.cnt == 21 && find_id(&prg.var_map, zorp) == 19
+		&& find_id(&prg.var_map, find_len(&str_pool, "fresh", 5)) == -1,
+		"succeed restoring `zorp` and dropping `fresh` on undo.");
+	/* typedefs from an undone line are forgotten too */
+	char const old_td[] = "typedef char *name_td;", new_td[] = "typedef int name_td; name_td num = 1;";
+	push_flag_list(&prg.src[0].flags, IN_MAIN);
+	find_vars(&prg, old_td, sizeof old_td - 1);
+	pop_vars(&prg, --prg.src[0].flags.cnt);
+	size_t td_cnt = prg.typedef_list.cnt;
+	find_vars(&prg, new_td, sizeof new_td - 1);
+	ok(prg.type_list.cnt == 1 && prg.type_list.list[0] == T_INT && prg.typedef_list.cnt == td_cnt + 1,
+		"succeed resolving a typedef redefined after undo.");
+
+	/* undoing a line restores what its entries shadowed */
+	struct id_map pe_map;
+	struct var_list pe_list;
+	init_id_map(&pe_map);
+	init_var_list(&pe_list);
+	push_var_list(&pe_list, (struct var_entry){.id = 10, .line = 0, .shadow = -1});
+	set_id(&pe_map, 10, 0);
+	push_var_list(&pe_list, (struct var_entry){.id = 10, .line = 1, .shadow = 0});
+	set_id(&pe_map, 10, 1);
+	push_var_list(&pe_list, (struct var_entry){.id = 20, .line = 1, .shadow = -1});
+	set_id(&pe_map, 20, 2);
+	/* found by debug info later but declared on the first line */
+	push_var_list(&pe_list, (struct var_entry){.id = 30, .line = 0, .shadow = -1});
+	set_id(&pe_map, 30, 3);
+	pop_entries(&pe_list, &pe_map, 1);
+	ok(pe_list.cnt == 4 && find_id(&pe_map, 10) == 1, "succeed keeping entries up to the line.");
+	pop_entries(&pe_list, &pe_map, 0);
+	ok(pe_list.cnt == 2 && find_id(&pe_map, 10) == 0 && find_id(&pe_map, 20) == -1 && pe_map.cnt == 2,
+		"succeed unshadowing and dropping entries after the line.");
+	ok(pe_list.list[1].id == 30 && find_id(&pe_map, 30) == 1, "succeed keeping an earlier declaration found out of order.");
+	free_var_list(&pe_list);
+	free_id_map(&pe_map);
+
+	/* declarators the regex scanner couldn't handle */
+	char const decls[] =
+		"int (*cmp)(void const *, void const *), *vals[4], sum(int);"
+		"typedef unsigned long word; word w = 1; FILE *fp = 0;"
+		"x = sizeof(int); for (int i = 0; i < 3; i++) { int inner = i; }";
+	ok(find_vars(&prg, decls, sizeof decls - 1) == 6 && prg.id_list.cnt == 4,
+		"succeed skipping functions, typedefs and statements.");
+	ok(prg.type_list.list[0] == T_PTR && prg.type_list.list[1] == T_PTR,
+		"succeed extracting pointer types from `cmp` and `vals`.");
+	ok(prg.type_list.list[2] == T_UINT && prg.type_list.list[3] == T_PTR,
+		"succeed extracting types through typedef `word` and `FILE`.");
+	char const vec[] = "__m256i *vp, v;";
+	find_vars(&prg, vec, sizeof vec - 1);
+	ok(prg.type_list.list[0] == T_PTR && prg.type_list.list[1] == T_VEC, "succeed extracting vector types.");
+
+	/* only the variables a line mentions get dumped */
+	char const touch[] = "zorp += kabonk.boop + klakow->boop + c";
+	bool shown[prg.var_list.cnt];
+	ptrdiff_t boop = find_id(&prg.var_map, find_len(&str_pool, "boop", 4));
+	truncate_id_list(&prg.touch_list, 0);
+	find_vars(&prg, touch, sizeof touch - 1);
+	ok(mark_shown(&prg, shown) == 4 && shown[find_id(&prg.var_map, zorp)] && !shown[boop],
+		"succeed marking touched variables but not member names.");
+	char const untracked[] = "zorp = untracked_fn(never_declared, zorp);";
+	size_t pool_cnt = str_pool.cnt;
+	truncate_id_list(&prg.touch_list, 0);
+	find_vars(&prg, untracked, sizeof untracked - 1);
+	ok(str_pool.cnt == pool_cnt && prg.touch_list.cnt == 2, "succeed touching only tracked names without interning the rest.");
+	truncate_id_list(&prg.touch_list, 0);
+	prg.dump_all = true;
+	ok(mark_shown(&prg, shown) > 4 && shown[boop], "succeed marking every variable for `;vars`.");
+	prg.dump_all = false;
+
+	/* read values out of a known debug build stopped at its trap, then through the printf fallback */
+	struct program trc = {0};
+	char const trc_body[] = "int main(void)\n{\n\tlong n = -42;\n\tchar const *s = \"hello\";\n\tdouble d = 1.5;";
+	char const trc_want[] = "n = \"-42\", s = \"hello\", d = \"1.500000\"\n";
+	char const *const trc_names[] = {"n", "s", "d"};
+	enum var_type const trc_types[] = {T_INT, T_STR, T_FLT};
+	char *const cc_args[] = {"gcc", "-O0", "-pipe", "-fPIC", "-std=c11", "-S", "-xc", "/dev/stdin", "-o", "/dev/stdout", NULL};
+	char elf_file[] = "/tmp/cepl_traceXXXXXX";
+	char trc_src[sizeof trc_body + 0x100];
+	struct char_list pv_src;
+	int elf_fd, err_fd, rec_fd, mem_fd, trc_ret, trc_status = -1;
+	FILE *err_file;
+	snprintf(trc_src, sizeof trc_src, "%s%s\n\treturn (int)n + 42;\n}\n", trc_body, VAR_TRAP);
+	elf_fd = build_traced(elf_file, trc_src);
+	if (read_dwarf(&trc.dwarf, elf_fd, "main") == -1)
+		BAIL_OUT("reading traced program failed");
+	for (size_t i = 0; i < ARR_LEN(trc_names); i++) {
+		size_t id = intern_str(&str_pool, trc_names[i]);
+		push_var_list(&trc.var_list, (struct var_entry){.id = id, .shadow = -1, .type_spec = trc_types[i]});
+		set_id(&trc.var_map, id, i);
+	}
+	trc.dump_all = true;
+	err_fd = begin_capture(&err_file);
+	trc_ret = trace_vars(&trc, elf_fd, (char *[]){elf_file, NULL}, &trc_status);
+	ok(end_capture(err_file, err_fd, trc_want) && !trc_ret && !trc_status && !trc.trace_pid,
+		"succeed reading values out of a traced run.");
+	close(elf_fd);
+	unlink(elf_file);
+
+	/* a trap the program raises itself isn't the breakpoint */
+	char const stray_body[] = "\n\tsignal(SIGTRAP, SIG_IGN);\n\traise(SIGTRAP);\n\tn = 7;";
+	strcpy(elf_file, "/tmp/cepl_traceXXXXXX");
+	snprintf(trc_src, sizeof trc_src, "#include <signal.h>\n%s%s%s\n\treturn 0;\n}\n", trc_body, stray_body, VAR_TRAP);
+	elf_fd = build_traced(elf_file, trc_src);
+	if (read_dwarf(&trc.dwarf, elf_fd, "main") == -1)
+		BAIL_OUT("reading traced program failed");
+	err_fd = begin_capture(&err_file);
+	trc_ret = trace_vars(&trc, elf_fd, (char *[]){elf_file, NULL}, &trc_status);
+	ok(end_capture(err_file, err_fd, "n = \"7\", s = \"hello\", d = \"1.500000\"\n") && !trc_ret && !trc_status,
+		"succeed passing through a trap raised before the breakpoint.");
+	close(elf_fd);
+	unlink(elf_file);
+	/* nor does a run that crashes after it show anything */
+	strcpy(elf_file, "/tmp/cepl_traceXXXXXX");
+	snprintf(trc_src, sizeof trc_src, "#include <stdlib.h>\n%s%s\n\tabort();\n}\n", trc_body, VAR_TRAP);
+	elf_fd = build_traced(elf_file, trc_src);
+	if (read_dwarf(&trc.dwarf, elf_fd, "main") == -1)
+		BAIL_OUT("reading traced program failed");
+	err_fd = begin_capture(&err_file);
+	trc_ret = trace_vars(&trc, elf_fd, (char *[]){elf_file, NULL}, &trc_status);
+	ok(end_capture_has(err_file, err_fd, "killed by signal") && !trc_ret && trc_status == -1,
+		"succeed reporting a run that crashed past the breakpoint.");
+	close(elf_fd);
+	unlink(elf_file);
+	init_char_list(&pv_src);
+	append_fmt(&pv_src, "#define _GNU_SOURCE\n#include <stdint.h>\n#include <stdio.h>\n#include <string.h>\n%s", trc_body);
+	if ((rec_fd = print_vars(&trc, &pv_src)) == -1)
+		BAIL_OUT("print_vars() failed");
+	append_fmt(&pv_src, "%s", "\n\treturn 0;\n}\n");
+	if ((mem_fd = build_elf(pv_src.list, cc_args, false)) == -1)
+		BAIL_OUT("building printers failed");
+	trc_status = exec_elf(mem_fd, (char *[]){"print_vars", NULL}, -1, false);
+	err_fd = begin_capture(&err_file);
+	show_vars(&trc, rec_fd);
+	ok(end_capture(err_file, err_fd, trc_want) && !trc_status, "succeed printing values from a build of their own.");
+	free_char_list(&pv_src);
+	free_var_list(&trc.var_list);
+	free_id_map(&trc.var_map);
+	free_dwarf(&trc.dwarf);
 
 	/* cleanup */
-	free_str_list(&prg.id_list);
-	free(prg.type_list.list);
+	free_id_list(&prg.id_list);
+	free_id_list(&prg.touch_list);
+	free_type_list(&prg.type_list);
+	free_var_list(&prg.var_list);
+	free_id_map(&prg.var_map);
+	free_var_list(&prg.typedef_list);
+	free_id_map(&prg.typedef_map);
+	free_flag_list(&prg.src[0].flags);
+	free_pool(&str_pool);
 
 	done_testing();
 }